@@ -199,7 +199,7 @@ void Cue::trackedUpdate(Cue::changedParams& oldVals, Rig* rig) {
 
         // If the param is the same as in oldVal, update it in the keyframe
         if (LumiverseTypeUtils::equals(keyframe.val.get(), params->second.get())) {
-          LumiverseTypeUtils::copyByVal(rig->getDevice(it->first)->getParam(params->first), keyframe.val.get());
+          LumiverseTypeUtils::copyByVal(rig->getDevice(it->first)->readParam(params->first), keyframe.val.get());
           ++params;
         }
         // Otherwise stop.
@@ -255,7 +255,7 @@ void Cue::insertKeyframe(float time, DeviceSet devices, bool uct) {
   for (auto d : devices.getDevices()) {
     // For each parameter
     for (auto p : d->getRawParameters()) {
-      insertKeyframe(d->getId(), p.first, d->getParam(p.first), time, uct);
+      insertKeyframe(d->getId(), p.first, d->readParam(p.first), time, uct);
     }
   }
 
@@ -329,7 +329,7 @@ void Cue::updateParams(Device* d, map<string, shared_ptr<Lumiverse::LumiverseTyp
         // If the old value is the same as in this keyframe, update this keyframe.
         // This allows tracking even with autogenerated delay keyframes.
         if (LumiverseTypeUtils::equals(changed[p.first].get(), k.val.get())) {
-          LumiverseTypeUtils::copyByVal(d->getParam(p.first), k.val.get());
+          LumiverseTypeUtils::copyByVal(d->readParam(p.first), k.val.get());
         }
         // If they're not equal, we've got some special internal keyframes, so remove
         // the changed value from the returned map to prevent accidental tracking
@@ -339,11 +339,11 @@ void Cue::updateParams(Device* d, map<string, shared_ptr<Lumiverse::LumiverseTyp
       }
 
       // If parameter data is new, replace this cue's data with the new data.
-      if (!LumiverseTypeUtils::equals(d->getParam(p.first), k.val.get())) {
+      if (!LumiverseTypeUtils::equals(d->readParam(p.first), k.val.get())) {
         // Make a full copy of the old data before overwriting old data.
         changed[p.first] = shared_ptr<Lumiverse::LumiverseType>(LumiverseTypeUtils::copy(k.val.get()));
 
-        LumiverseTypeUtils::copyByVal(d->getParam(p.first), k.val.get());
+        LumiverseTypeUtils::copyByVal(d->readParam(p.first), k.val.get());
       }
     }
     
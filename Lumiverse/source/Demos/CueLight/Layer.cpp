@@ -279,8 +279,7 @@ namespace Lumiverse {
               // Otherwise, do a lerp between keyframes.
               // First need to convert the cueTime to a position from 0-1
               float t = (cueTime - current.t) / (next.t - current.t);
-              shared_ptr<Lumiverse::LumiverseType> lerped = LumiverseTypeUtils::lerp(current.val.get(), next.val.get(), t);
-              LumiverseTypeUtils::copyByVal(lerped.get(), param.second);
+              LumiverseTypeUtils::lerpInto(param.second, current.val.get(), next.val.get(), t);
             }
           }
         }
@@ -350,8 +349,7 @@ namespace Lumiverse {
               // Otherwise, do a lerp between keyframes.
               // First need to convert the cueTime to a position from 0-1
               float t = (cueTime - first.t) / (next.t - first.t);
-              shared_ptr<Lumiverse::LumiverseType> lerped = LumiverseTypeUtils::lerp(first.val.get(), next.val.get(), t);
-              LumiverseTypeUtils::copyByVal(lerped.get(), m_layerState[devices->first]->getParam(parameters->first));
+              LumiverseTypeUtils::lerpInto(m_layerState[devices->first]->getParam(parameters->first), first.val.get(), next.val.get(), t);
               ++parameters;
             }
           }
@@ -427,8 +425,7 @@ namespace Lumiverse {
 
             // Generic alpha blending formula is res = src * opacity + dest * (1 - opacity)
             // Looks an awful lot like a lerp no?
-            shared_ptr<LumiverseType> res = LumiverseTypeUtils::lerp(dest, src, m_opacity);
-            LumiverseTypeUtils::copyByVal(res.get(), dest);
+            LumiverseTypeUtils::lerpInto(dest, dest, src, m_opacity);
           }
         }
       }
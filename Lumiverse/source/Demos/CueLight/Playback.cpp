@@ -10,6 +10,7 @@ namespace Lumiverse {
       // Copy and reset to defaults
       m_state[d->getId()] = new Device(*d);
       m_state[d->getId()]->reset();
+      m_stateBatch.addDevice(m_state[d->getId()]);
     }
 
     m_funcId = -1;
@@ -26,6 +27,7 @@ namespace Lumiverse {
       // Copy and reset to defaults
       m_state[d->getId()] = new Device(*d);
       m_state[d->getId()]->reset();
+      m_stateBatch.addDevice(m_state[d->getId()]);
     }
 
     m_funcId = -1;
@@ -98,7 +100,7 @@ namespace Lumiverse {
       m_prog->blend(m_state);
 
       // Write state to rig.
-      m_rig->setAllDevices(m_state);
+      m_rig->applyState(m_stateBatch);
 
       // For now I'm locking this to the update loop in rig
       // We'll see how it goes
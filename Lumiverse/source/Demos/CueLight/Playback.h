@@ -189,6 +189,9 @@ namespace Lumiverse {
     /*! \brief Copy of all devices in the rig. Current state of the playback. */
     map<string, Device*> m_state;
 
+    /*! \brief Points at every parameter in m_state. Written to the rig each update. */
+    StateBatch m_stateBatch;
+
     // Does the updating of the rig while running.
     // unique_ptr<thread> m_updateLoop;
 
@@ -246,10 +246,11 @@ void AnimationComponent::onRenderingFinished() {
 void AnimationComponent::triggleFirstFrame() const {
     // To triggle param changed (doesn't really change param),
     // so the first frame can be stored.
-    if (m_rig->getDeviceRaw().size() > 0) {
-        auto i = m_rig->getDeviceRaw().begin();
+    set<Device*> devices = m_rig->getDeviceRaw();
+    if (devices.size() > 0) {
+        auto i = devices.begin();
         for (auto p : (*i)->getRawParameters()) {
-            if (p.second->getTypeName() == "float") {
+            if (p.second->getTypeTag() == LumiverseType::FLOAT) {
                 (*i)->setParam(p.first, p.second);
                 break;
             }
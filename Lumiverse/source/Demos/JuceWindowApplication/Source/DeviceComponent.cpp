@@ -156,7 +156,7 @@ int DeviceComponent::parseParameters() {
     
     for (auto param : m_device->getRawParameters()) {
         LumiverseType *val = (LumiverseType*)param.second;
-        if (val->getTypeName() == "float") {
+        if (val->getTypeTag() == LumiverseType::FLOAT) {
             LumiverseFloat *val_float = (LumiverseFloat*)val;
             // Param label
             Label *param_label = new Label (TRANS(param.first) + TRANS(" label"), TRANS(param.first));
@@ -181,7 +181,7 @@ int DeviceComponent::parseParameters() {
             counter++;
             last_pos += m_padding + m_component_height;
         }
-        else if (val->getTypeName() == "color") {
+        else if (val->getTypeTag() == LumiverseType::COLOR) {
             LumiverseColor *color = (LumiverseColor*)val;
             map<string, double> channels = color->getColorParams();
             
@@ -0,0 +1,506 @@
+// Microbenchmarks for the core hot paths.
+//
+// Usage: lumiverse_bench [--filter text] [--min-time ms] [--rig-time ms]
+//
+// Each benchmark is run repeatedly until it takes at least --min-time
+// (default 200ms), and one JSON object per line is written to stdout:
+//   {"bench":"<function>","case":"<variant>","iterations":N,"ns_per_op":X}
+// Rig::update is measured by running a rig with a null DMX interface for
+// --rig-time (default 2000ms) and reading the rig's frame timing histogram.
+// --filter only runs benchmarks whose "bench/case" name contains the text.
+
+#include "LumiverseCore.h"
+#include "Layer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Lumiverse;
+
+// Number of devices in the generated rig.
+static const unsigned int numDevices = 1000;
+
+static string filterText;
+static double minTimeMs = 200;
+static double rigTimeMs = 2000;
+
+// Results are written here so the compiler can't drop the work.
+static volatile double sink;
+
+// DMX interface that drops everything. Keeps network time out of the numbers.
+class NullInterface : public DMXInterface {
+public:
+  NullInterface(string id) { m_ifaceId = id; m_ifaceName = id; }
+  virtual void init() { }
+  virtual void sendDMX(unsigned char* data, unsigned int /*universe*/) { sink = data[0]; }
+  virtual void closeInt() { }
+  virtual void reset() { }
+  virtual JSONNode toJSON() { return JSONNode(); }
+  virtual string getInterfaceType() { return "NullInterface"; }
+};
+
+static bool selected(string bench, string variant) {
+  return filterText.empty() || (bench + "/" + variant).find(filterText) != string::npos;
+}
+
+// Runs fn until it takes at least minTimeMs and prints the time per call.
+template <typename Function>
+static void run(string bench, string variant, Function fn) {
+  if (!selected(bench, variant))
+    return;
+
+  // Warm up caches and lazily built state.
+  fn();
+
+  uint64_t iterations = 1;
+  double ms = 0;
+
+  while (true) {
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+      fn();
+    }
+    ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    if (ms >= minTimeMs)
+      break;
+
+    iterations *= (ms < minTimeMs / 10) ? 10 : 2;
+  }
+
+  printf("{\"bench\":\"%s\",\"case\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f}\n",
+    bench.c_str(), variant.c_str(), (unsigned long long)iterations, ms * 1e6 / iterations);
+  fflush(stdout);
+}
+
+static map<string, Eigen::Vector3d> rgbBasis() {
+  map<string, Eigen::Vector3d> basis;
+  basis["Red"] = Eigen::Vector3d(0.4124, 0.2126, 0.0193);
+  basis["Green"] = Eigen::Vector3d(0.3576, 0.7152, 0.1192);
+  basis["Blue"] = Eigen::Vector3d(0.1805, 0.0722, 0.9505);
+  return basis;
+}
+
+static map<string, Eigen::Vector3d> rgbwBasis() {
+  map<string, Eigen::Vector3d> basis = rgbBasis();
+  basis["White"] = Eigen::Vector3d(0.9505, 1.0, 1.089);
+  return basis;
+}
+
+// More emitters than ChromaSolver::MaxDense, so matching runs CLP.
+static map<string, Eigen::Vector3d> wideBasis() {
+  map<string, Eigen::Vector3d> basis = rgbwBasis();
+  basis["Amber"] = Eigen::Vector3d(0.5471, 0.4013, 0.0120);
+  basis["Cyan"] = Eigen::Vector3d(0.1567, 0.3210, 0.5814);
+  basis["Lime"] = Eigen::Vector3d(0.4212, 0.7408, 0.0650);
+  basis["Indigo"] = Eigen::Vector3d(0.1190, 0.0340, 0.6305);
+  return basis;
+}
+
+// Additive color with a channel for each basis vector.
+static LumiverseColor* makeColor(map<string, Eigen::Vector3d> basis) {
+  map<string, double> channels;
+  for (const auto& b : basis) {
+    channels[b.first] = 0;
+  }
+
+  return new LumiverseColor(channels, basis, ADDITIVE, 1);
+}
+
+static map<string, int> goboKeys() {
+  map<string, int> gobos;
+  gobos["Open"] = 0;
+  gobos["Breakup"] = 64;
+  gobos["Dots"] = 128;
+  return gobos;
+}
+
+// Device with one parameter for each DMX conversion type.
+static Device* makeDevice(unsigned int i) {
+  stringstream id;
+  id << "fixture" << i;
+
+  Device* d = new Device(id.str(), i + 1, "Benchmark Fixture");
+  d->setParam("intensity", (LumiverseType*)new LumiverseFloat((i % 100) / 100.0f));
+  d->setParam("pan", (LumiverseType*)new LumiverseFloat(0.5f, 0.5f));
+  d->setParam("gobo", (LumiverseType*)new LumiverseEnum(goboKeys(), LumiverseEnum::CENTER, 255, "Open"));
+  d->setParam("color", (LumiverseType*)makeColor(rgbBasis()));
+  d->setParam("colorRGBW", (LumiverseType*)makeColor(rgbwBasis()));
+  d->setColorRGBRaw("color", 0.2, 0.4, 0.6);
+  d->setColorChannel("colorRGBW", "White", 0.5);
+  d->setMetadata("area", (i % 2 == 0) ? "left" : "right");
+  d->setMetadata("position", "electric" + to_string(i % 8));
+
+  return d;
+}
+
+// DMX map using every conversion type. 1 + 2 + 1 + 3 + 4 = 11 channels per device.
+static map<string, patchData> makeDMXMap() {
+  map<string, patchData> dmxMap;
+  dmxMap["intensity"] = patchData(0, FLOAT_TO_SINGLE);
+  dmxMap["pan"] = patchData(1, FLOAT_TO_FINE);
+  dmxMap["gobo"] = patchData(3, ENUM);
+  dmxMap["color"] = patchData(4, COLOR_RGB);
+  dmxMap["colorRGBW"] = patchData(7, COLOR_RGBW);
+  return dmxMap;
+}
+
+static void benchRigUpdate() {
+  const unsigned int channelsPerDevice = 11;
+  const unsigned int devicesPerUniverse = 512 / channelsPerDevice;
+
+  for (string variant : { "idle", "all_changed" }) {
+    if (!selected("Rig::update", variant))
+      continue;
+
+    Rig rig;
+    DMXPatch* patch = new DMXPatch();
+    patch->addDeviceMap("fixture", makeDMXMap());
+
+    for (unsigned int i = 0; i < numDevices; i++) {
+      Device* d = makeDevice(i);
+      rig.addDevice(d);
+
+      unsigned int universe = i / devicesPerUniverse;
+      patch->patchDevice(d, new DMXDevicePatch("fixture", (i % devicesPerUniverse) * channelsPerDevice, universe));
+    }
+
+    for (unsigned int u = 0; u <= (numDevices - 1) / devicesPerUniverse; u++) {
+      patch->assignInterface(new NullInterface("null" + to_string(u)), u);
+    }
+
+    rig.addPatch("dmx", patch);
+    rig.init();
+
+    if (variant == "all_changed") {
+      // Touches every device every frame, so every device is re-encoded.
+      set<Device*> rigDevices = rig.getDeviceRaw();
+      vector<Device*> devices(rigDevices.begin(), rigDevices.end());
+      float val = 0;
+      rig.addFunction(1, [devices, val]() mutable {
+        val = (val >= 1) ? 0 : val + 0.01f;
+        for (auto d : devices) {
+          d->setParam("intensity", val);
+        }
+      });
+    }
+
+    rig.setRefreshRate(100);
+    rig.run();
+    this_thread::sleep_for(chrono::milliseconds(200));
+    rig.resetTimings();
+    this_thread::sleep_for(chrono::milliseconds((long long)rigTimeMs));
+    rig.stop();
+
+    const TimingHistogram& frames = rig.getFrameTiming();
+    printf("{\"bench\":\"Rig::update\",\"case\":\"%s\",\"frames\":%llu,\"overruns\":%llu,"
+      "\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}\n",
+      variant.c_str(), (unsigned long long)frames.getCount(), (unsigned long long)frames.getOverruns(),
+      frames.getMean(), frames.getPercentile(0.5f), frames.getPercentile(0.99f), frames.getMax());
+    fflush(stdout);
+  }
+}
+
+static void benchUpdateDMX() {
+  Device* d = makeDevice(0);
+  vector<unsigned char> universe(512, 0);
+  DMXDevicePatch devicePatch("fixture", 0, 0);
+
+  const char* names[] = { "FLOAT_TO_SINGLE", "FLOAT_TO_FINE", "ENUM", "RGB_REPEAT2",
+    "RGB_REPEAT3", "RGB_REPEAT4", "COLOR_RGB", "COLOR_RGBW" };
+  const char* params[] = { "intensity", "pan", "gobo", "intensity",
+    "intensity", "intensity", "color", "colorRGBW" };
+
+  for (int t = 0; t <= COLOR_RGBW; t++) {
+    map<string, patchData> dmxMap;
+    dmxMap[params[t]] = patchData(0, (conversionType)t);
+    dmxMap[params[t]].param = getParamHandle(params[t]);
+
+    run("DMXDevicePatch::updateDMX", names[t], [&]() {
+      devicePatch.updateDMX(&universe.front(), d, dmxMap);
+      sink = universe[0];
+    });
+  }
+
+  delete d;
+}
+
+static void benchSelect() {
+  Rig rig;
+  for (unsigned int i = 0; i < numDevices; i++) {
+    rig.addDevice(makeDevice(i));
+  }
+
+  const char* cases[][2] = {
+    { "id", "fixture500" },
+    { "channel", "#500" },
+    { "channel_range", "#100-600" },
+    { "parameter", "@intensity>0.5f" },
+    { "metadata", "$area=left" },
+    { "metadata_prefix", "$position^=electric3" },
+    { "metadata_contains", "$position*=electric3" },
+    { "or", "#1-100|#900-1000" },
+    { "filter", "#1-1000[$area=left]" }
+  };
+
+  for (auto& c : cases) {
+    string query = c[1];
+    run("DeviceSet::select", c[0], [&]() {
+      sink = (double)rig.query(query).size();
+    });
+  }
+
+  // Same query as "parameter", read from a view instead of run again.
+  shared_ptr<LiveView> view = rig.createView("@intensity>0.5f");
+  run("LiveView::getDevices", "parameter", [&]() {
+    sink = (double)view->getDevices().size();
+  });
+
+  // Same query as "parameter", scanned from the parameter store's columns.
+  rig.setParameterStore(true);
+  run("DeviceSet::select", "parameter_store", [&]() {
+    sink = (double)rig.query("@intensity>0.5f").size();
+  });
+}
+
+static void benchTypeUtils() {
+  LumiverseFloat floatA(0.2f), floatB(0.8f), floatTarget;
+  map<string, int> gobos = goboKeys();
+  LumiverseEnum enumA(gobos, LumiverseEnum::CENTER, 255, "Open");
+  LumiverseEnum enumB(gobos, LumiverseEnum::CENTER, 255, "Dots");
+  LumiverseEnum enumTarget(gobos, LumiverseEnum::CENTER, 255, "Open");
+  unique_ptr<LumiverseColor> colorA(makeColor(rgbBasis()));
+  unique_ptr<LumiverseColor> colorB(makeColor(rgbBasis()));
+  unique_ptr<LumiverseColor> colorTarget(makeColor(rgbBasis()));
+  colorA->setRGBRaw(1, 0, 0);
+  colorB->setRGBRaw(0, 0, 1);
+
+  LumiverseType* as[] = { (LumiverseType*)&floatA, (LumiverseType*)&enumA, (LumiverseType*)colorA.get() };
+  LumiverseType* bs[] = { (LumiverseType*)&floatB, (LumiverseType*)&enumB, (LumiverseType*)colorB.get() };
+  LumiverseType* targets[] = { (LumiverseType*)&floatTarget, (LumiverseType*)&enumTarget, (LumiverseType*)colorTarget.get() };
+  const char* names[] = { "float", "enum", "color" };
+
+  for (int i = 0; i < 3; i++) {
+    float t = 0;
+    run("LumiverseTypeUtils::lerp", names[i], [&]() {
+      t = (t >= 1) ? 0 : t + 0.001f;
+      shared_ptr<LumiverseType> res = LumiverseTypeUtils::lerp(as[i], bs[i], t);
+      sink = (double)(size_t)res.get();
+    });
+  }
+
+  for (int i = 0; i < 3; i++) {
+    float t = 0;
+    run("LumiverseTypeUtils::lerpInto", names[i], [&]() {
+      t = (t >= 1) ? 0 : t + 0.001f;
+      sink = LumiverseTypeUtils::lerpInto(targets[i], as[i], bs[i], t);
+    });
+  }
+
+  for (int i = 0; i < 3; i++) {
+    bool flip = false;
+    run("LumiverseTypeUtils::copyByVal", names[i], [&]() {
+      // Alternate sources so the copy is never skipped as a no-op.
+      flip = !flip;
+      LumiverseTypeUtils::copyByVal(flip ? as[i] : bs[i], targets[i]);
+    });
+  }
+}
+
+static void benchColor() {
+  unique_ptr<LumiverseColor> basic(new LumiverseColor(BASIC_RGB));
+  unique_ptr<LumiverseColor> rgb(makeColor(rgbBasis()));
+  unique_ptr<LumiverseColor> rgbw(makeColor(rgbwBasis()));
+  unique_ptr<LumiverseColor> wide(makeColor(wideBasis()));
+
+  LumiverseColor* colors[] = { basic.get(), rgb.get(), rgbw.get(), wide.get() };
+  const char* names[] = { "basic_rgb", "additive_rgb", "additive_rgbw", "additive_wide" };
+
+  for (int i = 0; i < 4; i++) {
+    double r = 0;
+    run("LumiverseColor::setRGB", names[i], [&]() {
+      r = (r >= 1) ? 0 : r + 0.001;
+      colors[i]->setRGB(r, 0.5, 0.25);
+    });
+  }
+
+  // Same sweep, interpolated from the xy lookup table.
+  ChromaSolver::setLookupResolution(128);
+  {
+    double r = 0;
+    run("LumiverseColor::setRGB", "additive_wide_lookup", [&]() {
+      r = (r >= 1) ? 0 : r + 0.001;
+      wide->setRGB(r, 0.5, 0.25);
+    });
+  }
+  ChromaSolver::setLookupResolution(0);
+
+  for (int i = 1; i < 4; i++) {
+    double x = 0.3;
+    run("LumiverseColor::setxyY", names[i], [&]() {
+      x = (x >= 0.35) ? 0.3 : x + 0.0001;
+      colors[i]->setxyY(x, 0.32, 0.2);
+    });
+  }
+
+  for (int i = 0; i < 4; i++) {
+    colors[i]->setRGB(0.7, 0.5, 0.25);
+    run("LumiverseColor::getRGB", names[i], [&]() {
+      sink = colors[i]->getRGB()[0];
+    });
+  }
+
+  // A rig's worth of RGBW colors, converted one at a time and as a batch.
+  vector<unique_ptr<LumiverseColor>> many;
+  vector<LumiverseColor*> manyPtrs;
+  for (int i = 0; i < 1000; i++) {
+    many.push_back(unique_ptr<LumiverseColor>(makeColor(rgbwBasis())));
+    many.back()->setRGB(i / 1000.0, 0.5, 0.25);
+    manyPtrs.push_back(many.back().get());
+  }
+  vector<Eigen::Vector3d> manyOut(many.size());
+
+  run("LumiverseColor::getLab", "additive_rgbw_x1000", [&]() {
+    for (size_t i = 0; i < manyPtrs.size(); i++) {
+      manyOut[i] = manyPtrs[i]->getLab(D65);
+    }
+    sink = manyOut[0][0];
+  });
+
+  run("ColorConversion::XYZToLab", "additive_rgbw_x1000", [&]() {
+    ColorConversion::getXYZ(&manyPtrs[0], &manyOut[0], manyPtrs.size());
+    ColorConversion::XYZToLab(&manyOut[0], &manyOut[0], manyOut.size(), D65);
+    sink = manyOut[0][0];
+  });
+
+  // Changing the weight clears the cached XYZ, so every color is summed again.
+  run("ColorConversion::XYZToLab", "additive_rgbw_x1000_changed", [&]() {
+    for (size_t i = 0; i < manyPtrs.size(); i++) {
+      manyPtrs[i]->setWeight((manyPtrs[i]->getWeight() > 0.5) ? 0.25 : 1);
+    }
+    ColorConversion::getXYZ(&manyPtrs[0], &manyOut[0], manyPtrs.size());
+    ColorConversion::XYZToLab(&manyOut[0], &manyOut[0], manyOut.size(), D65);
+    sink = manyOut[0][0];
+  });
+}
+
+static void benchLayer() {
+  Rig rig;
+  for (unsigned int i = 0; i < numDevices; i++) {
+    rig.addDevice(makeDevice(i));
+  }
+
+  // Two cues with every device changing, and a fade long enough that the
+  // layer is always interpolating while we measure.
+  shared_ptr<CueList> list(new CueList("list"));
+  Cue first(&rig, 1000, 1000);
+  list->storeCue(1, first);
+  rig.getAllDevices().setParam("intensity", 1.0f);
+  for (auto d : rig.getDeviceRaw()) {
+    d->setColorRGBRaw("color", 1, 0, 0);
+  }
+  Cue second(&rig, 1000, 1000);
+  list->storeCue(2, second);
+
+  Layer layer(&rig, "layer", 1, Layer::BLEND_OPAQUE);
+  layer.setCueList(list);
+  layer.goToCue(2, 1000, 1000, 0);
+
+  if (selected("Layer::update", "fade")) {
+    auto start = chrono::high_resolution_clock::now();
+    uint64_t frame = 0;
+    run("Layer::update", "fade", [&]() {
+      frame++;
+      layer.update(start + chrono::milliseconds(frame % 100000));
+    });
+  }
+
+  // State to blend into, like Playback keeps.
+  map<string, Device*> state;
+  for (auto d : rig.getDeviceRaw()) {
+    state[d->getId()] = new Device(*d);
+  }
+
+  layer.setOpacity(0.5f);
+  run("Layer::blend", "opaque_half", [&]() {
+    layer.blend(state);
+  });
+
+  for (auto& s : state) {
+    delete s.second;
+  }
+}
+
+static void benchApplyState() {
+  Rig rig;
+  map<string, Device*> state;
+  StateBatch batch;
+
+  for (unsigned int i = 0; i < numDevices; i++) {
+    Device* d = makeDevice(i);
+    rig.addDevice(d);
+    state[d->getId()] = new Device(*d);
+    batch.addDevice(state[d->getId()]);
+  }
+
+  // Alternates between two intensities so every device changes on every call.
+  float val = 0;
+  auto change = [&]() {
+    val = (val == 0) ? 1.0f : 0;
+    for (auto& s : state) {
+      s.second->setParam("intensity", val);
+    }
+  };
+
+  run("Rig::setAllDevices", "all_changed", [&]() {
+    change();
+    rig.setAllDevices(state);
+  });
+
+  run("Rig::applyState", "all_changed", [&]() {
+    change();
+    rig.applyState(batch);
+  });
+
+  run("Rig::applyState", "unchanged", [&]() {
+    rig.applyState(batch);
+  });
+
+  for (auto& s : state) {
+    delete s.second;
+  }
+}
+
+int main(int argc, char** argv) {
+  // Log output goes to stdout too, and an unoptimized build warns about
+  // every slow frame.
+  Logger::setLogLevel(ERR);
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filterText = argv[++i];
+    }
+    else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      minTimeMs = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--rig-time") == 0 && i + 1 < argc) {
+      rigTimeMs = atof(argv[++i]);
+    }
+    else {
+      fprintf(stderr, "Usage: %s [--filter text] [--min-time ms] [--rig-time ms]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  benchUpdateDMX();
+  benchSelect();
+  benchTypeUtils();
+  benchColor();
+  benchLayer();
+  benchApplyState();
+  benchRigUpdate();
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+// Measures how long it takes to load generated rigs of various sizes.
+//
+// Usage: lumiverse_load_bench [device counts...]
+// Defaults to 1000 10000 100000 devices. One JSON object per line is written
+// to stdout for each rig size and format so results can be compared across
+// builds. The binary snapshot is also checked against the JSON load, and the
+// exit code is 1 if any device differs.
+
+#include "LumiverseCore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Lumiverse;
+
+static const int repetitions = 3;
+
+// Writes a rig with the given number of devices to filename.
+// Devices look like a typical moving light: intensity, pan, tilt, a gobo wheel and an RGB color.
+static void generateRig(unsigned int numDevices, string filename) {
+  map<string, Eigen::Vector3d> basis;
+  basis["Red"] = Eigen::Vector3d(0.4124, 0.2126, 0.0193);
+  basis["Green"] = Eigen::Vector3d(0.3576, 0.7152, 0.1192);
+  basis["Blue"] = Eigen::Vector3d(0.1805, 0.0722, 0.9505);
+
+  map<string, int> gobos;
+  gobos["Open"] = 0;
+  gobos["Breakup"] = 64;
+  gobos["Dots"] = 128;
+
+  Rig rig;
+  for (unsigned int i = 0; i < numDevices; i++) {
+    stringstream id;
+    id << "fixture" << i;
+
+    Device* d = new Device(id.str(), i + 1, "Generated RGB Fixture");
+    d->setParam("intensity", (LumiverseType*)new LumiverseFloat((i % 100) / 100.0f));
+    d->setParam("pan", (LumiverseType*)new LumiverseFloat(0.5f, 0.5f));
+    d->setParam("tilt", (LumiverseType*)new LumiverseFloat(0.5f, 0.5f));
+    d->setParam("gobo", (LumiverseType*)new LumiverseEnum(gobos, LumiverseEnum::CENTER, 255, "Open"));
+    d->setParam("color", (LumiverseType*)new LumiverseColor(basis));
+    d->setMetadata("area", (i % 2 == 0) ? "stage left" : "stage right");
+    d->setMetadata("position", "electric " + to_string(i % 8));
+
+    rig.addDevice(d);
+  }
+
+  rig.save(filename, true);
+}
+
+static double msSince(chrono::steady_clock::time_point start) {
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// True if every device in a is in b with the same JSON.
+static bool sameDevices(Rig& a, Rig& b) {
+  if (a.getDeviceRaw().size() != b.getDeviceRaw().size())
+    return false;
+
+  for (auto d : a.getDeviceRaw()) {
+    Device* other = b.getDevice(d->getId());
+    if (other == nullptr || other->toJSON().write() != d->toJSON().write())
+      return false;
+  }
+
+  return true;
+}
+
+// Loads the file repeatedly with the given load function and prints the timing.
+template <typename LoadFunction>
+static void timeLoad(string bench, unsigned int size, LoadFunction load) {
+  double best = 0;
+  double total = 0;
+  unsigned int loaded = 0;
+
+  for (int r = 0; r < repetitions; r++) {
+    Rig rig;
+
+    auto start = chrono::steady_clock::now();
+    load(rig);
+    double ms = msSince(start);
+
+    loaded = (unsigned int)rig.getDeviceRaw().size();
+    total += ms;
+    best = (r == 0 || ms < best) ? ms : best;
+  }
+
+  printf("{\"bench\":\"%s\",\"devices\":%u,\"loaded\":%u,\"best_ms\":%.3f,\"mean_ms\":%.3f}\n",
+    bench.c_str(), size, loaded, best, total / repetitions);
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  vector<unsigned int> sizes;
+  for (int i = 1; i < argc; i++) {
+    sizes.push_back((unsigned int)atoi(argv[i]));
+  }
+
+  if (sizes.empty())
+    sizes = { 1000, 10000, 100000 };
+
+  int ret = 0;
+
+  for (auto size : sizes) {
+    string filename = "lumiverse_load_bench_" + to_string(size) + ".rig.json";
+    string binFilename = "lumiverse_load_bench_" + to_string(size) + ".rig.bin";
+    generateRig(size, filename);
+
+    timeLoad("rig_load", size, [&](Rig& rig) { rig.load(filename); });
+
+    Rig jsonRig(filename);
+    jsonRig.saveBinary(binFilename, true);
+
+    timeLoad("rig_load_binary", size, [&](Rig& rig) { rig.loadBinary(binFilename); });
+
+    Rig binRig;
+    binRig.loadBinary(binFilename);
+    bool roundTrip = sameDevices(jsonRig, binRig);
+
+    printf("{\"bench\":\"rig_binary_roundtrip\",\"devices\":%u,\"match\":%s}\n",
+      size, roundTrip ? "true" : "false");
+    fflush(stdout);
+
+    if (!roundTrip)
+      ret = 1;
+
+    remove(filename.c_str());
+    remove(binFilename.c_str());
+  }
+
+  return ret;
+}
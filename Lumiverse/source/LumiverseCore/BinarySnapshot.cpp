@@ -0,0 +1,425 @@
+#include "BinarySnapshot.h"
+#include "types/LumiverseOrientation.h"
+
+#include <fstream>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Lumiverse {
+
+static const char magic[4] = { 'L', 'M', 'V', 'B' };
+static const uint32_t byteOrderTag = 0x01020304;
+
+enum BinaryParamType {
+  BINARY_FLOAT = 0,
+  BINARY_ENUM = 1,
+  BINARY_COLOR = 2,
+  BINARY_ORIENTATION = 3
+};
+
+// Appends values to a buffer in host byte order.
+class BinaryWriter {
+public:
+  template <typename T>
+  void write(T val) {
+    m_data.append((const char*)&val, sizeof(T));
+  }
+
+  void writeString(const string& val) {
+    write((uint32_t)val.size());
+    m_data.append(val);
+  }
+
+  void writeRaw(const string& bytes) {
+    m_data.append(bytes);
+  }
+
+  const string& data() { return m_data; }
+
+private:
+  string m_data;
+};
+
+// Reads values out of a block of memory. Once a read runs past the end,
+// every read after it returns 0 and ok() is false.
+class BinaryReader {
+public:
+  BinaryReader(const char* data, size_t size) : m_pos(data), m_end(data + size), m_ok(true) { }
+
+  template <typename T>
+  T read() {
+    T val = T();
+
+    if (m_ok && (size_t)(m_end - m_pos) >= sizeof(T)) {
+      memcpy(&val, m_pos, sizeof(T));
+      m_pos += sizeof(T);
+    }
+    else {
+      m_ok = false;
+    }
+
+    return val;
+  }
+
+  string readString() {
+    uint32_t size = read<uint32_t>();
+
+    if (!m_ok || (size_t)(m_end - m_pos) < size) {
+      m_ok = false;
+      return "";
+    }
+
+    string val(m_pos, size);
+    m_pos += size;
+    return val;
+  }
+
+  bool ok() { return m_ok; }
+
+private:
+  const char* m_pos;
+  const char* m_end;
+  bool m_ok;
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+  MappedFile(string filename) : m_data(nullptr), m_size(0) {
+#ifdef _WIN32
+    m_mapping = NULL;
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+      return;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+      return;
+
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mapping == NULL)
+      return;
+
+    m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data != nullptr)
+      m_size = (size_t)size.QuadPart;
+#else
+    m_fd = open(filename.c_str(), O_RDONLY);
+    if (m_fd < 0)
+      return;
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+      return;
+
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED)
+      return;
+
+    m_data = (const char*)data;
+    m_size = (size_t)st.st_size;
+#endif
+  }
+
+  ~MappedFile() {
+#ifdef _WIN32
+    if (m_data != nullptr)
+      UnmapViewOfFile(m_data);
+    if (m_mapping != NULL)
+      CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+      CloseHandle(m_file);
+#else
+    if (m_data != nullptr)
+      munmap((void*)m_data, m_size);
+    if (m_fd >= 0)
+      close(m_fd);
+#endif
+  }
+
+  const char* data() { return m_data; }
+  size_t size() { return m_size; }
+
+private:
+  const char* m_data;
+  size_t m_size;
+
+#ifdef _WIN32
+  HANDLE m_file;
+  HANDLE m_mapping;
+#else
+  int m_fd;
+#endif
+};
+
+static void writeParam(BinaryWriter& out, const string& name, LumiverseType* param) {
+  LumiverseType::TypeTag type = param->getTypeTag();
+
+  if (type == LumiverseType::FLOAT) {
+    LumiverseFloat* val = (LumiverseFloat*)param;
+
+    out.writeString(name);
+    out.write((uint8_t)BINARY_FLOAT);
+    out.write(val->getVal());
+    out.write(val->getDefault());
+    out.write(val->getMax());
+    out.write(val->getMin());
+  }
+  else if (type == LumiverseType::ENUM) {
+    LumiverseEnum* val = (LumiverseEnum*)param;
+
+    out.writeString(name);
+    out.write((uint8_t)BINARY_ENUM);
+    out.write((uint32_t)val->getValsToStart().size());
+    for (const auto& k : val->getValsToStart()) {
+      out.writeString(k.first);
+      out.write((int32_t)k.second);
+    }
+    out.write((uint8_t)val->getMode());
+    out.write((uint8_t)val->getInterpMode());
+    out.write((int32_t)val->getRangeMax());
+    out.writeString(val->getDefault());
+    out.writeString(val->getVal());
+    out.write(val->getTweak());
+  }
+  else if (type == LumiverseType::COLOR) {
+    LumiverseColor* val = (LumiverseColor*)param;
+    map<string, double> channels = val->getColorParams();
+
+    out.writeString(name);
+    out.write((uint8_t)BINARY_COLOR);
+    out.write((uint32_t)val->getMode());
+    out.write(val->getWeight());
+    out.write((uint32_t)channels.size());
+    for (const auto& c : channels) {
+      out.writeString(c.first);
+      out.write(c.second);
+    }
+    out.write((uint32_t)val->getBasisVectors().size());
+    for (const auto& b : val->getBasisVectors()) {
+      out.writeString(b.first);
+      out.write(b.second[0]);
+      out.write(b.second[1]);
+      out.write(b.second[2]);
+    }
+  }
+  else if (type == LumiverseType::ORIENTATION) {
+    LumiverseOrientation* val = (LumiverseOrientation*)param;
+
+    out.writeString(name);
+    out.write((uint8_t)BINARY_ORIENTATION);
+    out.writeString(val->getUnit());
+    out.write(val->getVal());
+    out.write(val->getDefault());
+    out.write(val->getMax());
+    out.write(val->getMin());
+  }
+  else {
+    stringstream ss;
+    ss << "Parameter " << name << " has type " << param->getTypeName() << " which can't be saved in a binary snapshot. Parameter not saved.";
+    Logger::log(WARN, ss.str());
+  }
+}
+
+static LumiverseType* readParam(BinaryReader& in, uint8_t type) {
+  switch (type) {
+    case BINARY_FLOAT: {
+      float val = in.read<float>();
+      float def = in.read<float>();
+      float max = in.read<float>();
+      float min = in.read<float>();
+      return (LumiverseType*)new LumiverseFloat(val, def, max, min);
+    }
+    case BINARY_ENUM: {
+      map<string, int> keys;
+      uint32_t numKeys = in.read<uint32_t>();
+      for (uint32_t i = 0; i < numKeys && in.ok(); i++) {
+        string key = in.readString();
+        keys[key] = in.read<int32_t>();
+      }
+
+      LumiverseEnum::Mode mode = (LumiverseEnum::Mode)in.read<uint8_t>();
+      LumiverseEnum::InterpolationMode interpMode = (LumiverseEnum::InterpolationMode)in.read<uint8_t>();
+      int rangeMax = in.read<int32_t>();
+      string def = in.readString();
+      string active = in.readString();
+      float tweak = in.read<float>();
+
+      LumiverseEnum* param = new LumiverseEnum(keys, mode, rangeMax, def, interpMode);
+      param->setVal(active);
+      param->setTweak(tweak);
+      return (LumiverseType*)param;
+    }
+    case BINARY_COLOR: {
+      ColorMode mode = (ColorMode)in.read<uint32_t>();
+      double weight = in.read<double>();
+
+      map<string, double> channels;
+      uint32_t numChannels = in.read<uint32_t>();
+      for (uint32_t i = 0; i < numChannels && in.ok(); i++) {
+        string channel = in.readString();
+        channels[channel] = in.read<double>();
+      }
+
+      map<string, Eigen::Vector3d> basis;
+      uint32_t numBasis = in.read<uint32_t>();
+      for (uint32_t i = 0; i < numBasis && in.ok(); i++) {
+        string channel = in.readString();
+        double x = in.read<double>();
+        double y = in.read<double>();
+        double z = in.read<double>();
+        basis[channel] = Eigen::Vector3d(x, y, z);
+      }
+
+      return (LumiverseType*)new LumiverseColor(channels, basis, mode, weight);
+    }
+    case BINARY_ORIENTATION: {
+      string unit = in.readString();
+      float val = in.read<float>();
+      float def = in.read<float>();
+      float max = in.read<float>();
+      float min = in.read<float>();
+      return (LumiverseType*)new LumiverseOrientation(val, unit, def, max, min);
+    }
+    default:
+      return nullptr;
+  }
+}
+
+bool BinarySnapshot::save(string filename, const set<Device*>& devices, string patches, unsigned int refreshRate) {
+  BinaryWriter out;
+
+  for (char c : magic) {
+    out.write(c);
+  }
+  out.write(Version);
+  out.write(byteOrderTag);
+  out.write((uint32_t)refreshRate);
+  out.write((uint32_t)devices.size());
+
+  for (auto d : devices) {
+    out.writeString(d->getId());
+    out.write((uint32_t)d->getChannel());
+    out.writeString(d->getType());
+
+    // Params of unknown types are skipped, so the count is patched in after.
+    vector<string> names = d->getParamNames();
+    BinaryWriter params;
+    uint32_t numParams = 0;
+    for (const auto& name : names) {
+      size_t before = params.data().size();
+      writeParam(params, name, d->readParam(name));
+      if (params.data().size() > before)
+        numParams++;
+    }
+    out.write(numParams);
+    out.writeRaw(params.data());
+
+    vector<string> keys = d->getMetadataKeyNames();
+    out.write((uint32_t)keys.size());
+    for (const auto& key : keys) {
+      string val;
+      d->getMetadata(key, val);
+      out.writeString(key);
+      out.writeString(val);
+    }
+  }
+
+  out.writeString(patches);
+
+  ofstream file;
+  file.open(filename, ios::out | ios::trunc | ios::binary);
+  if (!file.is_open())
+    return false;
+
+  file.write(out.data().data(), out.data().size());
+  return file.good();
+}
+
+bool BinarySnapshot::load(string filename, vector<Device*>& devices, string& patches, unsigned int& refreshRate) {
+  MappedFile file(filename);
+  if (file.data() == nullptr) {
+    stringstream ss;
+    ss << "Error opening " << filename;
+    Logger::log(ERR, ss.str());
+    return false;
+  }
+
+  BinaryReader in(file.data(), file.size());
+
+  char fileMagic[4];
+  for (char& c : fileMagic) {
+    c = in.read<char>();
+  }
+  uint32_t version = in.read<uint32_t>();
+  uint32_t order = in.read<uint32_t>();
+
+  if (!in.ok() || memcmp(fileMagic, magic, 4) != 0 || version != Version || order != byteOrderTag) {
+    stringstream ss;
+    ss << filename << " is not a version " << Version << " binary snapshot for this platform.";
+    Logger::log(ERR, ss.str());
+    return false;
+  }
+
+  uint32_t rate = in.read<uint32_t>();
+  uint32_t numDevices = in.read<uint32_t>();
+
+  vector<Device*> loaded;
+  bool ok = true;
+  for (uint32_t i = 0; i < numDevices && in.ok() && ok; i++) {
+    string id = in.readString();
+    unsigned int channel = in.read<uint32_t>();
+    string type = in.readString();
+
+    Device* d = new Device(id, channel, type);
+    loaded.push_back(d);
+
+    uint32_t numParams = in.read<uint32_t>();
+    for (uint32_t p = 0; p < numParams && in.ok(); p++) {
+      string name = in.readString();
+      LumiverseType* param = readParam(in, in.read<uint8_t>());
+
+      if (param == nullptr) {
+        ok = false;
+        break;
+      }
+      d->setParam(name, param);
+    }
+
+    uint32_t numMeta = in.read<uint32_t>();
+    for (uint32_t m = 0; m < numMeta && in.ok(); m++) {
+      string key = in.readString();
+      d->setMetadata(key, in.readString());
+    }
+  }
+
+  string patchJSON = in.readString();
+
+  if (!in.ok() || !ok) {
+    for (auto d : loaded) {
+      delete d;
+    }
+
+    stringstream ss;
+    ss << filename << " is truncated or corrupt. Nothing loaded.";
+    Logger::log(ERR, ss.str());
+    return false;
+  }
+
+  devices.swap(loaded);
+  patches = patchJSON;
+  refreshRate = rate;
+
+  return true;
+}
+
+}
@@ -0,0 +1,79 @@
+/*! \file BinarySnapshot.h
+* \brief Binary file format for saving and loading rigs.
+*/
+#ifndef _BINARYSNAPSHOT_H_
+#define _BINARYSNAPSHOT_H_
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdint>
+
+#include "Device.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Reads and writes rig snapshots in a binary format.
+  *
+  * A snapshot holds the same information as the JSON rig file, but devices
+  * are stored as length-prefixed strings and raw numbers, so they are read
+  * by walking the memory mapped file instead of parsing text. Only the
+  * parsing is skipped. Every device is still built on the heap with its own
+  * parameter objects, because the rig and patches update and read those
+  * objects in place and they can't live in a read-only mapping. The patches,
+  * DMX tables included, are kept as embedded JSON and parsed on load.
+  * Layout, with all numbers in host byte order:
+  *
+  *     header   "LMVB", uint32 version, uint32 byte order tag (0x01020304),
+  *              uint32 refresh rate, uint32 device count
+  *     device   string id, uint32 channel, string type,
+  *              uint32 param count, params, uint32 metadata count, (string key, string value)...
+  *     param    string name, uint8 type, then by type
+  *              float:       float val, default, max, min
+  *              enum:        uint32 key count, (string key, int32 start)..., uint8 mode,
+  *                           uint8 interp mode, int32 range max, string default,
+  *                           string active, float tweak
+  *              color:       uint32 mode, double weight, uint32 channel count,
+  *                           (string channel, double value)..., uint32 basis count,
+  *                           (string channel, double x, y, z)...
+  *              orientation: string unit, float val, default, max, min
+  *     patches  string holding the JSON of the rig's patches
+  *
+  * Strings are a uint32 length followed by the bytes. Files with a different
+  * version or byte order are rejected.
+  * \sa Rig::saveBinary(), Rig::loadBinary()
+  */
+  class BinarySnapshot
+  {
+  public:
+    /*! \brief Current version of the format. */
+    static const uint32_t Version = 1;
+
+    /*!
+    * \brief Writes a snapshot to a file.
+    * \param filename File to write.
+    * \param devices Devices to save.
+    * \param patches JSON of the patches, as written by Rig::toJSON().
+    * \param refreshRate Rig refresh rate.
+    * \return False if the file can't be written.
+    */
+    static bool save(string filename, const set<Device*>& devices, string patches, unsigned int refreshRate);
+
+    /*!
+    * \brief Reads a snapshot from a file.
+    *
+    * Nothing is returned unless the whole file reads correctly.
+    * \param filename File to read.
+    * \param[out] devices Newly created devices. The caller owns them.
+    * \param[out] patches JSON of the patches.
+    * \param[out] refreshRate Rig refresh rate.
+    * \return False if the file can't be read or isn't a valid snapshot.
+    */
+    static bool load(string filename, vector<Device*>& devices, string& patches, unsigned int& refreshRate);
+  };
+}
+#endif
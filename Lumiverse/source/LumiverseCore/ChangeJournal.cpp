@@ -0,0 +1,102 @@
+#include "ChangeJournal.h"
+
+#include <cstring>
+
+namespace Lumiverse {
+
+// Smallest power of two that's at least n.
+static size_t roundUpPow2(size_t n) {
+  size_t size = 1;
+  while (size < n)
+    size *= 2;
+
+  return size;
+}
+
+ChangeJournal::ChangeJournal(size_t capacity) : m_slots(roundUpPow2(capacity)), m_head(0) {
+  m_mask = m_slots.size() - 1;
+
+  for (auto& s : m_slots) {
+    s.seq.store(0, memory_order_relaxed);
+    s.handles.store(0, memory_order_relaxed);
+    s.value.store(0, memory_order_relaxed);
+    s.timestamp.store(0, memory_order_relaxed);
+  }
+}
+
+ChangeJournal::Cursor ChangeJournal::getCursor() const {
+  Cursor c;
+  c.position = m_head.load(memory_order_acquire);
+  return c;
+}
+
+void ChangeJournal::write(const Record& record) {
+  uint64_t index = m_head.load(memory_order_relaxed);
+  Slot& s = m_slots[index & m_mask];
+
+  uint32_t valueBits;
+  memcpy(&valueBits, &record.value, sizeof(valueBits));
+
+  s.seq.store(2 * index + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  s.handles.store(((uint64_t)record.device << 32) | record.param, memory_order_relaxed);
+  s.value.store(valueBits, memory_order_relaxed);
+  s.timestamp.store(record.timestamp, memory_order_relaxed);
+
+  s.seq.store(2 * (index + 1), memory_order_release);
+  m_head.store(index + 1, memory_order_release);
+}
+
+bool ChangeJournal::read(Cursor& cursor, vector<Record>& records, uint64_t* lost) const {
+  uint64_t capacity = m_slots.size();
+  uint64_t head = m_head.load(memory_order_acquire);
+  uint64_t missed = 0;
+
+  // Anything older than a full ring ago is gone.
+  if (head - cursor.position > capacity) {
+    missed += head - capacity - cursor.position;
+    cursor.position = head - capacity;
+  }
+
+  while (cursor.position < head) {
+    const Slot& s = m_slots[cursor.position & m_mask];
+    uint64_t expected = 2 * (cursor.position + 1);
+
+    uint64_t before = s.seq.load(memory_order_acquire);
+    uint64_t handles = s.handles.load(memory_order_relaxed);
+    uint32_t valueBits = (uint32_t)s.value.load(memory_order_relaxed);
+    uint64_t timestamp = s.timestamp.load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t after = s.seq.load(memory_order_relaxed);
+
+    if (before != expected || after != expected) {
+      // The writer lapped us while we were reading. Skip to the oldest
+      // record that can't be overwritten by the write in progress.
+      uint64_t now = m_head.load(memory_order_acquire);
+      uint64_t oldest = (now + 1 > capacity) ? now + 1 - capacity : 0;
+      if (oldest <= cursor.position)
+        oldest = cursor.position + 1;
+
+      missed += oldest - cursor.position;
+      cursor.position = oldest;
+      continue;
+    }
+
+    Record r;
+    r.device = (DeviceHandle)(handles >> 32);
+    r.param = (ParamHandle)(handles & 0xffffffff);
+    memcpy(&r.value, &valueBits, sizeof(r.value));
+    r.timestamp = timestamp;
+    records.push_back(r);
+
+    cursor.position++;
+  }
+
+  if (lost != nullptr)
+    *lost = missed;
+
+  return missed == 0;
+}
+
+}
@@ -0,0 +1,123 @@
+/*! \file ChangeJournal.h
+* \brief Bounded log of parameter changes that any number of readers can follow.
+*/
+#ifndef _CHANGEJOURNAL_H_
+#define _CHANGEJOURNAL_H_
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "Interner.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Ring buffer of parameter change records.
+  *
+  * The Rig update loop appends a record for every parameter that changed in a
+  * frame. Readers keep their own Cursor and call read() whenever they want the
+  * changes since their last read, so there can be any number of readers and
+  * they never affect each other or the writer. Nothing takes a lock.
+  *
+  * The buffer holds a fixed number of records. A reader that falls more than
+  * that far behind loses the oldest records, and read() reports how many.
+  * There must only be one writer.
+  * \sa Rig::setChangeJournal()
+  */
+  class ChangeJournal
+  {
+  public:
+    /*! \brief One parameter change. */
+    struct Record {
+      DeviceHandle device;
+      ParamHandle param;
+
+      /*!
+      * \brief New value of float and orientation parameters.
+      *
+      * NaN for other types, read the device for those.
+      */
+      float value;
+
+      /*! \brief Time of the frame the change was seen in, in steady_clock nanoseconds. */
+      uint64_t timestamp;
+    };
+
+    /*!
+    * \brief Position of a reader in the journal.
+    *
+    * Cursors belong to their reader and are only changed by read().
+    */
+    struct Cursor {
+      uint64_t position;
+    };
+
+    /*!
+    * \brief Makes an empty journal.
+    * \param capacity Number of records kept. Rounded up to a power of two.
+    */
+    ChangeJournal(size_t capacity);
+
+    /*! \brief Gets the number of records kept. */
+    size_t getCapacity() const { return m_slots.size(); }
+
+    /*! \brief Gets the total number of records ever written. */
+    uint64_t getHead() const { return m_head.load(memory_order_acquire); }
+
+    /*!
+    * \brief Gets a cursor positioned after the newest record.
+    *
+    * Reading from it returns only records written after this call.
+    */
+    Cursor getCursor() const;
+
+    /*!
+    * \brief Appends a record. Only one thread may write.
+    */
+    void write(const Record& record);
+
+    /*!
+    * \brief Reads the records written since the cursor's last read.
+    *
+    * Records are appended to records in the order they were written, and the
+    * cursor is moved past them.
+    * \param cursor Reader's cursor.
+    * \param[out] records Records are appended to this.
+    * \param[out] lost If not nullptr, set to the number of records that were
+    * overwritten before they could be read.
+    * \return False if records were lost.
+    */
+    bool read(Cursor& cursor, vector<Record>& records, uint64_t* lost = nullptr) const;
+
+  private:
+    /*!
+    * \brief Storage for one record.
+    *
+    * seq is odd while the record is being written, and 2 * (index + 1) once
+    * record index is complete, so readers can tell if a slot was
+    * overwritten while they read it. The record is packed in atomics so
+    * those reads aren't data races.
+    */
+    struct Slot {
+      atomic<uint64_t> seq;
+      atomic<uint64_t> handles;
+      atomic<uint64_t> value;
+      atomic<uint64_t> timestamp;
+    };
+
+    /*! \brief Ring of records. Size is a power of two. */
+    vector<Slot> m_slots;
+
+    /*! \brief m_slots.size() - 1 */
+    uint64_t m_mask;
+
+    /*! \brief Index of the next record to write. */
+    atomic<uint64_t> m_head;
+  };
+}
+#endif
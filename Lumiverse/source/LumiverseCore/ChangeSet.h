@@ -0,0 +1,52 @@
+/*! \file ChangeSet.h
+* \brief List of everything that changed in a Rig during one frame.
+*/
+#ifndef _CHANGESET_H_
+#define _CHANGESET_H_
+
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "Interner.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  /*! \brief A parameter that changed. */
+  struct ParamChange {
+    DeviceHandle device;
+    ParamHandle param;
+  };
+
+  /*!
+  * \brief Devices and parameters that changed since the previous frame.
+  *
+  * Built by the Rig update loop and handed to change callbacks once per frame.
+  * A device can be in devices with no entries in params if only its metadata
+  * changed. Devices that have given out raw parameter access, and devices new
+  * to the rig, list all of their parameters.
+  * \sa Rig::addChangeCallback()
+  */
+  struct ChangeSet {
+    /*! \brief Handles of the devices that changed. */
+    vector<DeviceHandle> devices;
+
+    /*! \brief Parameters that changed, grouped by device in the same order as devices. */
+    vector<ParamChange> params;
+
+    /*! \brief Empties the set, keeping the allocated memory. */
+    void clear() {
+      devices.clear();
+      params.clear();
+    }
+
+    /*! \brief True if nothing changed. */
+    bool empty() const { return devices.empty(); }
+  };
+
+  /*! \brief Signature of the functions that receive a frame's ChangeSet. */
+  typedef function<void(const ChangeSet&)> ChangeCallbackFunction;
+}
+#endif
@@ -12,10 +12,15 @@ DMXDevicePatch::~DMXDevicePatch() {
   // Empty for now
 }
 
-void DMXDevicePatch::updateDMX(unsigned char* data, Device* device, map<string, patchData> dmxMap) {
+void DMXDevicePatch::updateDMX(unsigned char* data, Device* device, const map<string, patchData>& dmxMap) {
   for (auto& instr : dmxMap) {
+    // Maps that didn't go through a DMXPatch haven't resolved their handles.
+    ParamHandle param = instr.second.param;
+    if (param == InvalidHandle)
+      param = findParamHandle(instr.first);
+
     // Validation checks.
-    if (!device->paramExists(instr.first)) {
+    if (!device->paramExists(param)) {
       // DMX mapping has a parameter that the device does not have.
       ostringstream ss;
       ss << "Device does not have a parameter named " << instr.first << "\n";
@@ -28,49 +33,49 @@ void DMXDevicePatch::updateDMX(unsigned char* data, Device* device, map<string,
     switch (instr.second.type) {
       case (FLOAT_TO_SINGLE):
       {
-        LumiverseFloat* val = (LumiverseFloat*) device->getParam(instr.first);
+        LumiverseFloat* val = (LumiverseFloat*) device->readParam(param);
         floatToSingle(data, instr.second.startAddress, val);
         break;
       }
       case (FLOAT_TO_FINE):
       {
-        LumiverseFloat* val = (LumiverseFloat*)device->getParam(instr.first);
+        LumiverseFloat* val = (LumiverseFloat*)device->readParam(param);
         floatToFine(data, instr.second.startAddress, val);
         break;
       }
       case (ENUM) :
       {
-        LumiverseEnum* val = (LumiverseEnum*)device->getParam(instr.first);
+        LumiverseEnum* val = (LumiverseEnum*)device->readParam(param);
         toEnum(data, instr.second.startAddress, val);
         break;
       }
       case (RGB_REPEAT2) :
       {
-        LumiverseFloat* val = (LumiverseFloat*)device->getParam(instr.first);
+        LumiverseFloat* val = (LumiverseFloat*)device->readParam(param);
         RGBRepeat(data, instr.second.startAddress, val, 2);
         break;
       }
       case (RGB_REPEAT3) :
       {
-        LumiverseFloat* val = (LumiverseFloat*)device->getParam(instr.first);
+        LumiverseFloat* val = (LumiverseFloat*)device->readParam(param);
         RGBRepeat(data, instr.second.startAddress, val, 3);
         break;
       }
       case (RGB_REPEAT4) :
       {
-        LumiverseFloat* val = (LumiverseFloat*)device->getParam(instr.first);
+        LumiverseFloat* val = (LumiverseFloat*)device->readParam(param);
         RGBRepeat(data, instr.second.startAddress, val, 4);
         break;
       }
       case(COLOR_RGB) :
       {
-        LumiverseColor* val = (LumiverseColor*)device->getParam(instr.first);
+        LumiverseColor* val = (LumiverseColor*)device->readParam(param);
         ColorToRGB(data, instr.second.startAddress, val);
         break;
       }
       case (COLOR_RGBW) :
       {
-        LumiverseColor* val = (LumiverseColor*)device->getParam(instr.first);
+        LumiverseColor* val = (LumiverseColor*)device->readParam(param);
         ColorToRGBW(data, instr.second.startAddress, val);
         break;
       }
@@ -118,9 +123,10 @@ void DMXDevicePatch::RGBRepeat(unsigned char* data, unsigned int address, Lumive
 
 void DMXDevicePatch::ColorToRGB(unsigned char* data, unsigned int address, LumiverseColor* val) {
   // Missing parameters will just kinda end up undefined.
-  unsigned char r = (unsigned char)(255 * val->getColorChannel("Red"));
-  unsigned char g = (unsigned char)(255 * val->getColorChannel("Green"));
-  unsigned char b = (unsigned char)(255 * val->getColorChannel("Blue"));
+  const ColorLayout& layout = val->getLayout();
+  unsigned char r = (unsigned char)(255 * val->getColorChannelAt(layout.getRed()));
+  unsigned char g = (unsigned char)(255 * val->getColorChannelAt(layout.getGreen()));
+  unsigned char b = (unsigned char)(255 * val->getColorChannelAt(layout.getBlue()));
 
   setDMXVal(data, address, r);
   setDMXVal(data, address + 1, g);
@@ -128,10 +134,11 @@ void DMXDevicePatch::ColorToRGB(unsigned char* data, unsigned int address, Lumiv
 }
 
 void DMXDevicePatch::ColorToRGBW(unsigned char* data, unsigned int address, LumiverseColor* val) {
-  unsigned char r = (unsigned char)(255 * val->getColorChannel("Red"));
-  unsigned char g = (unsigned char)(255 * val->getColorChannel("Green"));
-  unsigned char b = (unsigned char)(255 * val->getColorChannel("Blue"));;
-  unsigned char w = (unsigned char)(255 * val->getColorChannel("White"));;
+  const ColorLayout& layout = val->getLayout();
+  unsigned char r = (unsigned char)(255 * val->getColorChannelAt(layout.getRed()));
+  unsigned char g = (unsigned char)(255 * val->getColorChannelAt(layout.getGreen()));
+  unsigned char b = (unsigned char)(255 * val->getColorChannelAt(layout.getBlue()));
+  unsigned char w = (unsigned char)(255 * val->getColorChannelAt(layout.getWhite()));
 
   setDMXVal(data, address, r);
   setDMXVal(data, address + 1, g);
@@ -46,24 +46,32 @@ namespace Lumiverse {
     */
     conversionType type;
 
+    /*!
+    * \brief Handle of the parameter this entry maps.
+    *
+    * Resolved when the entry is added to a DMXPatch so updates don't look up the
+    * parameter name. InvalidHandle until then.
+    */
+    ParamHandle param;
+
     /*! \brief Constructs a default patch entry. 
     *
     * Default assumes a starting address of 0 and a floating point to single DMX byte conversion.
     */
-    patchData() : startAddress(0), type(FLOAT_TO_SINGLE) { }
+    patchData() : startAddress(0), type(FLOAT_TO_SINGLE), param(InvalidHandle) { }
 
     /*! \brief Constructs a patch entry
     *
     * \param addr Starting address for the parameter
     * \param t Conversion method for the parameter
     */
-    patchData(unsigned int addr, conversionType t) : startAddress(addr), type(t) { }
+    patchData(unsigned int addr, conversionType t) : startAddress(addr), type(t), param(InvalidHandle) { }
 
     /*! \brief Constructs a patch entry from a string conversionType
     * \param addr Starting address
     * \param t Conversion method as a string.
     */
-    patchData(unsigned int addr, string t) : startAddress(addr) {
+    patchData(unsigned int addr, string t) : startAddress(addr), param(InvalidHandle) {
       // Note to self: make a static dictionary with this instead.
       if (t == "FLOAT_TO_SINGLE") { type = FLOAT_TO_SINGLE; }
       else if (t == "FLOAT_TO_FINE") { type = FLOAT_TO_FINE; }
@@ -113,7 +121,7 @@ namespace Lumiverse {
     * \param device The Device to pull data from
     * \param dmxMap Table to DMX Maps to tell this function how to interpret the Device's data.
     */
-    void updateDMX(unsigned char* data, Device* device, map<string, patchData> dmxMap);
+    void updateDMX(unsigned char* data, Device* device, const map<string, patchData>& dmxMap);
 
     /*! \brief Gets the universe the device is patched to.
     * \return The Device's universe */
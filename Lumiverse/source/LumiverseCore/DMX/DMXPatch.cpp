@@ -3,10 +3,11 @@
 namespace Lumiverse {
 
 DMXPatch::DMXPatch() {
-  // Empty for now
+  m_fullUpdate = true;
 }
 
 DMXPatch::DMXPatch(const JSONNode data) {
+  m_fullUpdate = true;
   loadJSON(data);
 }
 
@@ -168,22 +169,44 @@ DMXPatch::~DMXPatch() {
 }
 
 void DMXPatch::update(set<Device *> devices) {
+  encodeDevices(devices);
+  sendUniverses();
+}
+
+void DMXPatch::updateChanged(const set<Device *>& devices, const set<Device *>& changed) {
+  // Universe buffers hold on to the last encoded values, so only devices
+  // that changed need to be written again.
+  if (m_fullUpdate) {
+    encodeDevices(devices);
+    m_fullUpdate = false;
+  }
+  else {
+    encodeDevices(changed);
+  }
+
+  sendUniverses();
+}
+
+void DMXPatch::encodeDevices(const set<Device *>& devices) {
   for (Device* d : devices) {
     // Skip if there is no DMX patch for the device stored
-    if (m_patch.count(d->getId()) == 0)
+    auto it = m_patch.find(d->getId());
+    if (it == m_patch.end())
       continue;
     
     // For each device, find the device patch stored.
-    DMXDevicePatch devPatch = *(m_patch)[d->getId()];
-    unsigned int uni = devPatch.getUniverse();
+    DMXDevicePatch* devPatch = it->second;
+    unsigned int uni = devPatch->getUniverse();
     
     // Skip if universes aren't allocated because the interface doesn't exist.
     if (uni >= m_universes.size())
       continue;
     
-    devPatch.updateDMX(&m_universes[uni].front(), d, m_deviceMaps[devPatch.getDMXMapKey()]);
+    devPatch->updateDMX(&m_universes[uni].front(), d, m_deviceMaps[devPatch->getDMXMapKey()]);
   }
+}
 
+void DMXPatch::sendUniverses() {
   // Send updated data to interfaces
   for (auto& i : m_ifacePatch) {
     m_interfaces[i.first]->sendDMX(&m_universes[i.second].front(), i.second);
@@ -280,6 +303,7 @@ void DMXPatch::assignInterface(DMXInterface* iface, unsigned int universe) {
   }
 
   m_ifacePatch.insert(make_pair(id, universe));
+  m_fullUpdate = true;
 
   // Update universe vector size.
   if (universe + 1 > m_universes.size()) {
@@ -316,18 +340,28 @@ void DMXPatch::moveInterface(string id, unsigned int universeFrom, unsigned int
 
 void DMXPatch::patchDevice(Device* device, DMXDevicePatch* patch) {
   m_patch[device->getId()] = patch;
+  m_fullUpdate = true;
 }
 
 void DMXPatch::patchDevice(string id, DMXDevicePatch* patch) {
   m_patch[id] = patch;
+  m_fullUpdate = true;
 }
 
 void DMXPatch::addDeviceMap(string id, map<string, patchData> deviceMap) {
+  for (auto& entry : deviceMap) {
+    entry.second.param = getParamHandle(entry.first);
+  }
+
   m_deviceMaps[id] = deviceMap; // Replaces existing maps.
+  m_fullUpdate = true;
 }
 
 void DMXPatch::addParameter(string mapId, string paramId, unsigned int address, conversionType type) {
-  m_deviceMaps[mapId][paramId] = patchData(address, type);
+  patchData& entry = m_deviceMaps[mapId][paramId];
+  entry = patchData(address, type);
+  entry.param = getParamHandle(paramId);
+  m_fullUpdate = true;
 }
 
 void DMXPatch::dumpUniverses() {
@@ -353,11 +387,10 @@ bool DMXPatch::setRawData(unsigned int universe, vector<unsigned char> univData)
   }
 
   m_universes[universe] = univData;
+  sendUniverses();
 
-  // Send updated data to interfaces
-  for (auto& i : m_ifacePatch) {
-    m_interfaces[i.first]->sendDMX(&m_universes[i.second].front(), i.second);
-  }
+  // Device values take over again on the next update.
+  m_fullUpdate = true;
 
   return true;
 }
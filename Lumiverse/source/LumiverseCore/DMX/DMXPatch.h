@@ -80,6 +80,16 @@ namespace Lumiverse {
     */
     virtual void update(set<Device *> devices);
 
+    /*!
+    * \brief Updates the values sent to the DMX network, only re-encoding
+    * the devices that changed.
+    *
+    * All devices are re-encoded on the first update and whenever the patch
+    * configuration changes.
+    * \sa Patch::updateChanged()
+    */
+    virtual void updateChanged(const set<Device *>& devices, const set<Device *>& changed);
+
     /*!
     * \brief Initializes connections and other network settings for the patch.
     *
@@ -251,6 +261,17 @@ namespace Lumiverse {
     */
     string conversionTypeToString(conversionType t);
 
+    /*!
+    * \brief Writes the values of the given devices into the universe buffers.
+    * \param devices Devices to encode. Unpatched devices are skipped.
+    */
+    void encodeDevices(const set<Device *>& devices);
+
+    /*!
+    * \brief Sends the universe buffers to the interfaces.
+    */
+    void sendUniverses();
+
     /*!
     * \brief Stores the state of the DMX universes.
     *
@@ -287,6 +308,13 @@ namespace Lumiverse {
     * devices. Key is the device map name.
     */
     map<string, map<string, patchData> > m_deviceMaps;
+
+    /*!
+    * \brief When true, the next call to updateChanged() re-encodes every device.
+    *
+    * Set whenever the patch configuration changes.
+    */
+    bool m_fullUpdate;
   };
 }
 
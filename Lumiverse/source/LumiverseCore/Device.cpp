@@ -1,17 +1,30 @@
 #include "Device.h"
+
 namespace Lumiverse {
 
 Device::Device(string id, unsigned int channel, string type) {
   this->m_id = id;
   this->m_channel = channel;
   this->m_type = type;
+  m_handle = acquireDeviceHandle(id);
+  m_generation = 0;
+  m_rawAccess = false;
+  m_writeSeq = 0;
+  m_writers = 0;
+  m_store = nullptr;
 
   // Might auto-load parameters from device type file at some point.
   // Right now we just leave the maps empty and stuff.
 }
 
-Device::Device(string id, const JSONNode data) {
+Device::Device(string id, const JSONNode& data) {
   m_id = id;
+  m_handle = acquireDeviceHandle(id);
+  m_generation = 0;
+  m_rawAccess = false;
+  m_writeSeq = 0;
+  m_writers = 0;
+  m_store = nullptr;
   loadJSON(data);
 }
 
@@ -19,10 +32,17 @@ Device::Device(const Device& other) {
   m_id = other.m_id;
   m_channel = other.m_channel;
   m_type = other.m_type;
+  m_handle = acquireDeviceHandle(m_id);
+  m_generation = 0;
+  m_rawAccess = false;
+  m_writeSeq = 0;
+  m_writers = 0;
+  m_store = nullptr;
 
   // Need to do a deep copy of the parameters
   for (auto kvp : other.m_parameters) {
     m_parameters[kvp.first] = LumiverseTypeUtils::copy(kvp.second);
+    indexParam(kvp.first, m_parameters[kvp.first]);
   }
 
   m_metadata = other.m_metadata;
@@ -32,24 +52,43 @@ Device::Device(Device* other) {
   m_id = other->m_id;
   m_channel = other->m_channel;
   m_type = other->m_type;
+  m_handle = acquireDeviceHandle(m_id);
+  m_generation = 0;
+  m_rawAccess = false;
+  m_writeSeq = 0;
+  m_writers = 0;
+  m_store = nullptr;
 
   // Need to do a deep copy of the parameters
   for (auto kvp : other->m_parameters) {
     m_parameters[kvp.first] = LumiverseTypeUtils::copy(kvp.second);
+    indexParam(kvp.first, m_parameters[kvp.first]);
   }
 
   m_metadata = other->m_metadata;
 }
 
 Device::~Device() {
+  // Clears the device out of the store's bookkeeping too.
+  if (m_store != nullptr)
+    bindStore(nullptr);
+
   for (auto& kv : m_parameters) {
     delete kv.second;
   }
+
+  releaseDeviceHandle(m_handle);
 }
 
 bool Device::getParam(string param, float& val) {
-  if (m_parameters.count(param) > 0) {
-    val = ((LumiverseFloat*)m_parameters[param])->getVal();;
+  return getParam(findParamHandle(param), val);
+}
+
+bool Device::getParam(ParamHandle param, float& val) {
+  LumiverseType* data = readParam(param);
+
+  if (data != nullptr) {
+    val = ((LumiverseFloat*)data)->getVal();
     return true;
   }
 
@@ -57,31 +96,196 @@ bool Device::getParam(string param, float& val) {
 }
 
 LumiverseType* Device::getParam(string param) {
-  if (m_parameters.count(param) > 0) {
-    return m_parameters[param];
+  return getParam(findParamHandle(param));
+}
+
+LumiverseType* Device::getParam(ParamHandle param) {
+  LumiverseType* data = readParam(param);
+
+  if (data != nullptr) {
+    m_rawAccess = true;
   }
 
-  return nullptr;
+  return data;
+}
+
+LumiverseType* Device::readParam(string param) {
+  return readParam(findParamHandle(param));
 }
 
 LumiverseColor* Device::getColor(string param) {
-  if (m_parameters.count(param) > 0) {
-      if (m_parameters[param]->getTypeName() == "color") {
-          return (LumiverseColor*)(m_parameters[param]);
-      }
+  LumiverseType* data = readParam(param);
+
+  if (data != nullptr && data->getTypeTag() == LumiverseType::COLOR) {
+    m_rawAccess = true;
+    return (LumiverseColor*)data;
   }
 
   return nullptr;
 }
 
-bool Device::setParam(string param, LumiverseType* val) {
-  bool ret = true;
+uint64_t Device::getParamGeneration(string param) {
+  return getParamGeneration(findParamHandle(param));
+}
 
-  if (m_parameters.count(param) == 0) {
-    ret = false;
+uint64_t Device::getParamGeneration(ParamHandle param) {
+  return (param < m_paramGenerations.size()) ? m_paramGenerations[param] : 0;
+}
+
+void Device::getChangedParams(uint64_t since, vector<ParamHandle>& changed) {
+  // Keeps new parameters from resizing the slots while they're scanned.
+  lock_guard<mutex> lock(m_dataLock);
+  size_t start = changed.size();
+
+  while (true) {
+    uint64_t seq = m_writeSeq.load();
+
+    if (m_writers.load() > 0) {
+      this_thread::yield();
+      continue;
+    }
+
+    for (ParamHandle h = 0; h < m_paramsByHandle.size(); h++) {
+      if (m_paramsByHandle[h] != nullptr && (since == 0 || m_paramGenerations[h] > since))
+        changed.push_back(h);
+    }
+
+    // A write started while reading, try again.
+    if (m_writeSeq.load() == seq)
+      return;
+
+    changed.resize(start);
+  }
+}
+
+ParamHandle Device::indexParam(const string& param, LumiverseType* val) {
+  ParamHandle handle = getParamHandle(param);
+
+  if (handle >= m_paramsByHandle.size()) {
+    m_paramsByHandle.resize(handle + 1, nullptr);
+    m_paramGenerations.resize(handle + 1, 0);
+  }
+
+  LumiverseType* old = m_paramsByHandle[handle];
+  m_paramsByHandle[handle] = val;
+
+  if (m_store != nullptr) {
+    // The store has one slot per parameter of a device, so a float or color
+    // being replaced takes its values back before the new one gets the slot.
+    if (old != nullptr && old != val)
+      bindParam(old, nullptr, handle);
+
+    bool isFloat = (val != nullptr && val->getTypeTag() == LumiverseType::FLOAT);
+    if (val != nullptr)
+      bindParam(val, m_store, handle);
+
+    m_store->setNonFloat(handle, m_handle, val != nullptr && !isFloat);
+  }
+
+  return handle;
+}
+
+void Device::bindStore(ParameterStore* store) {
+  beginWrite();
+
+  for (ParamHandle h = 0; h < m_paramsByHandle.size(); h++) {
+    LumiverseType* p = m_paramsByHandle[h];
+    if (p == nullptr)
+      continue;
+
+    bindParam(p, store, h);
+
+    if (p->getTypeTag() != LumiverseType::FLOAT) {
+      if (m_store != nullptr)
+        m_store->setNonFloat(h, m_handle, false);
+      if (store != nullptr)
+        store->setNonFloat(h, m_handle, true);
+    }
+  }
+
+  m_store = store;
+  endWrite();
+}
+
+void Device::bindParam(LumiverseType* param, ParameterStore* store, ParamHandle handle) {
+  if (param->getTypeTag() == LumiverseType::FLOAT)
+    ((LumiverseFloat*)param)->bind(store, handle, m_handle);
+  else if (param->getTypeTag() == LumiverseType::COLOR)
+    ((LumiverseColor*)param)->bind(store, handle, m_handle);
+}
+
+void Device::markChanged(ParamHandle param) {
+  m_paramGenerations[param] = ++m_generation;
+}
+
+void Device::beginWrite() {
+  m_writers++;
+  m_writeSeq++;
+}
+
+void Device::endWrite() {
+  m_writeSeq++;
+  m_writers--;
+}
+
+Device* Device::snapshot(Device* target) {
+  // Writers that could free memory under the copy are held off entirely.
+  // Float writers aren't, they're caught by the sequence check below.
+  lock_guard<mutex> lock(m_dataLock);
+
+  while (true) {
+    uint64_t seq = m_writeSeq.load();
+
+    if (m_writers.load() > 0) {
+      this_thread::yield();
+      continue;
+    }
+
+    // Reuse the target if it has the same parameters, otherwise start over.
+    bool sameLayout = (target != nullptr && target->m_parameters.size() == m_parameters.size());
+    if (sameLayout) {
+      auto t = target->m_parameters.begin();
+      for (auto& p : m_parameters) {
+        if (t->first != p.first || !LumiverseTypeUtils::areSameType(t->second, p.second)) {
+          sameLayout = false;
+          break;
+        }
+        ++t;
+      }
+    }
+
+    if (sameLayout) {
+      for (auto& p : m_parameters) {
+        LumiverseTypeUtils::copyByVal(p.second, target->m_parameters[p.first]);
+      }
+
+      target->m_channel = m_channel;
+      target->m_type = m_type;
+      target->m_metadata = m_metadata;
+    }
+    else {
+      delete target;
+      target = new Device(*this);
+    }
+
+    // A write started while copying, try again.
+    if (m_writeSeq.load() == seq)
+      return target;
   }
+}
 
-  m_parameters[param] = val;
+bool Device::setParam(string param, LumiverseType* val) {
+  bool ret = (readParam(param) != nullptr);
+
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    m_parameters[param] = val;
+    ParamHandle handle = indexParam(param, val);
+
+    markChanged(handle);
+    endWrite();
+  }
 
   // callback
   onParameterChanged();
@@ -89,51 +293,84 @@ bool Device::setParam(string param, LumiverseType* val) {
   return ret;
 }
 
-
 bool Device::setParam(string param, float val) {
   bool ret = true;
+  ParamHandle handle = findParamHandle(param);
 
-  if (m_parameters.count(param) == 0) {
+  if (readParam(handle) == nullptr) {
     ret = false;
-    m_parameters[param] = (LumiverseType*) new LumiverseFloat();
+
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseType* data = (LumiverseType*) new LumiverseFloat();
+    m_parameters[param] = data;
+    handle = indexParam(param, data);
+    endWrite();
+  }
+
+  return setParam(handle, val) && ret;
+}
+
+bool Device::setParam(ParamHandle param, float val) {
+  LumiverseType* data = readParam(param);
+
+  if (data == nullptr) {
+    return false;
   }
 
   // Checks param type
-  if (m_parameters[param]->getTypeName() != "float" &&
-	  m_parameters[param]->getTypeName() != "orientation") {
+  if (data->getTypeTag() != LumiverseType::FLOAT &&
+	  data->getTypeTag() != LumiverseType::ORIENTATION) {
       Logger::log(WARN, "Trying to assign float value to a non-float type.");
       
       return false;
   }
     
-  if (m_parameters[param]->getTypeName() == "float")
-	*((LumiverseFloat *)m_parameters[param]) = val;
+  beginWrite();
+  if (data->getTypeTag() == LumiverseType::FLOAT)
+	*((LumiverseFloat *)data) = val;
   else 
-	*((LumiverseOrientation *)m_parameters[param]) = val;
+	*((LumiverseOrientation *)data) = val;
+
+  markChanged(param);
+  endWrite();
 
   // callback
   onParameterChanged();
     
-  return ret;
+  return true;
 }
 
 bool Device::setParam(string param, string val, float val2) {
-  if (m_parameters.count(param) == 0) {
+  return setParam(findParamHandle(param), val, val2);
+}
+
+bool Device::setParam(ParamHandle param, string val, float val2) {
+  LumiverseType* param_data = readParam(param);
+
+  if (param_data == nullptr) {
     return false;
   }
 
   // Checks param type
-  if (m_parameters[param]->getTypeName() != "enum") {
+  if (param_data->getTypeTag() != LumiverseType::ENUM) {
     Logger::log(WARN, "Trying to assign enum value to a non-enum type.");
         
     return false;
   }
     
-  LumiverseEnum* data = (LumiverseEnum *)m_parameters[param];
-  data->setVal(val);
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseEnum* data = (LumiverseEnum *)param_data;
+    data->setVal(val);
+
+    if (val2 >= 0) {
+      data->setTweak(val2);
+    }
 
-  if (val2 >= 0) {
-    data->setTweak(val2);
+    markChanged(param);
+    endWrite();
   }
 
   // callback
@@ -143,13 +380,23 @@ bool Device::setParam(string param, string val, float val2) {
 }
 
 bool Device::setParam(string param, string val, float val2, LumiverseEnum::Mode mode, LumiverseEnum::InterpolationMode interpMode) {
-  if (m_parameters.count(param) == 0 ||
-      m_parameters[param]->getTypeName() != "enum") {
+  ParamHandle handle = findParamHandle(param);
+  LumiverseType* param_data = readParam(handle);
+
+  if (param_data == nullptr ||
+      param_data->getTypeTag() != LumiverseType::ENUM) {
     return false;
   }
     
-  LumiverseEnum* data = (LumiverseEnum *)m_parameters[param];
-  data->setVal(val, val2, mode, interpMode);
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseEnum* data = (LumiverseEnum *)param_data;
+    data->setVal(val, val2, mode, interpMode);
+
+    markChanged(handle);
+    endWrite();
+  }
 
   // callback
   onParameterChanged();
@@ -158,28 +405,55 @@ bool Device::setParam(string param, string val, float val2, LumiverseEnum::Mode
 }
 
 bool Device::setParam(string param, string channel, double val) {
-  if (m_parameters.count(param) == 0 ||
-      m_parameters[param]->getTypeName() != "color") {
+  ParamHandle handle = findParamHandle(param);
+  LumiverseType* param_data = readParam(handle);
+
+  if (param_data == nullptr ||
+      param_data->getTypeTag() != LumiverseType::COLOR) {
     return false;
   }
 
-  LumiverseColor* data = (LumiverseColor*)m_parameters[param];
   bool ret;
-  if ((ret = data->setColorChannel(channel, val)))
-      // callback
-      onParameterChanged();
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseColor* data = (LumiverseColor*)param_data;
+    ret = data->setColorChannel(channel, val);
+
+    if (ret)
+      markChanged(handle);
+    endWrite();
+  }
+
+  if (ret)
+    // callback
+    onParameterChanged();
     
   return ret;
 }
 
 bool Device::setParam(string param, double x, double y, double weight) {
-  if (m_parameters.count(param) == 0 ||
-        m_parameters[param]->getTypeName() != "color") {
+  return setParam(findParamHandle(param), x, y, weight);
+}
+
+bool Device::setParam(ParamHandle param, double x, double y, double weight) {
+  LumiverseType* param_data = readParam(param);
+
+  if (param_data == nullptr ||
+        param_data->getTypeTag() != LumiverseType::COLOR) {
     return false;
   }
 
-  LumiverseColor* data = (LumiverseColor*)m_parameters[param];
-  data->setxy(x, y, weight);
+  {
+    // Can add channels to the color's layout.
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseColor* data = (LumiverseColor*)param_data;
+    data->setxy(x, y, weight);
+
+    markChanged(param);
+    endWrite();
+  }
 
   // callback
   onParameterChanged();
@@ -188,13 +462,23 @@ bool Device::setParam(string param, double x, double y, double weight) {
 }
 
 bool Device::setColorRGBRaw(string param, double r, double g, double b, double weight) {
-  if (m_parameters.count(param) == 0 ||
-        m_parameters[param]->getTypeName() != "color") {
+  ParamHandle handle = findParamHandle(param);
+  LumiverseType* param_data = readParam(handle);
+
+  if (param_data == nullptr ||
+        param_data->getTypeTag() != LumiverseType::COLOR) {
     return false;
   }
 
-  LumiverseColor* data = (LumiverseColor*)m_parameters[param];
-  data->setRGBRaw(r, g, b, weight);
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseColor* data = (LumiverseColor*)param_data;
+    data->setRGBRaw(r, g, b, weight);
+
+    markChanged(handle);
+    endWrite();
+  }
 
   // callback
   onParameterChanged();
@@ -203,56 +487,190 @@ bool Device::setColorRGBRaw(string param, double r, double g, double b, double w
 }
 
 bool Device::setColorRGB(string param, double r, double g, double b, double weight, RGBColorSpace cs) {
-  if (m_parameters.count(param) == 0 ||
-        m_parameters[param]->getTypeName() != "color") {
+  ParamHandle handle = findParamHandle(param);
+  LumiverseType* param_data = readParam(handle);
+
+  if (param_data == nullptr ||
+        param_data->getTypeTag() != LumiverseType::COLOR) {
     return false;
   }
 
-  LumiverseColor* data = (LumiverseColor*)m_parameters[param];
-  data->setRGB(r, g, b, weight, cs);
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseColor* data = (LumiverseColor*)param_data;
+    data->setRGB(r, g, b, weight, cs);
+
+    markChanged(handle);
+    endWrite();
+  }
 
   // callback
   onParameterChanged();
     
   return true;
 }
+
+bool Device::setColorChannel(string param, string channel, double val) {
+  ParamHandle handle = findParamHandle(param);
+  LumiverseType* param_data = readParam(handle);
+
+  if (param_data == nullptr ||
+        param_data->getTypeTag() != LumiverseType::COLOR) {
+    return false;
+  }
+
+  bool set;
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    LumiverseColor* data = (LumiverseColor*)param_data;
+    set = data->setColorChannel(channel, val);
+
+    if (set)
+      markChanged(handle);
+    endWrite();
+  }
+
+  // callback
+  if (set)
+    onParameterChanged();
+
+  return set;
+}
     
 void Device::copyParamByValue(string param, LumiverseType* source) {
-    LumiverseType *target = getParam(param);
+    copyParamByValue(findParamHandle(param), source);
+}
+
+void Device::copyParamByValue(ParamHandle param, LumiverseType* source) {
+    LumiverseType *target = readParam(param);
     
 	// Skips this copy if the target value equals the current value
     if (!LumiverseTypeUtils::areSameType(source, target) ||
 		LumiverseTypeUtils::equals(target, source))
         return;
     
-    if (source->getTypeName() == "float") {
+    // Only plain numbers can be written without the data lock.
+    unique_lock<mutex> lock(m_dataLock, defer_lock);
+    if (source->getTypeTag() != LumiverseType::FLOAT &&
+        source->getTypeTag() != LumiverseType::ORIENTATION)
+        lock.lock();
+
+    beginWrite();
+    if (source->getTypeTag() == LumiverseType::FLOAT) {
         *((LumiverseFloat*)target) = *((LumiverseFloat*)source);
     }
-    else if (source->getTypeName() == "enum") {
+    else if (source->getTypeTag() == LumiverseType::ENUM) {
         *((LumiverseEnum*)target) = *((LumiverseEnum*)source);
     }
-    else if (source->getTypeName() == "color") {
+    else if (source->getTypeTag() == LumiverseType::COLOR) {
         *((LumiverseColor*)target) = *((LumiverseColor*)source);
     }
-	else if (source->getTypeName() == "orientation") {
+	else if (source->getTypeTag() == LumiverseType::ORIENTATION) {
 		*((LumiverseOrientation*)target) = *((LumiverseOrientation*)source);
 	}
     else {
+        endWrite();
         return;
     }
     
+    markChanged(param);
+    endWrite();
+    if (lock.owns_lock())
+        lock.unlock();
+
     onParameterChanged();
 }
-    
+
+bool Device::copyParamsByValue(const StateBatch::Entry* first, const StateBatch::Entry* last) {
+  bool changed = false;
+
+  // Only plain numbers can be written without the data lock.
+  unique_lock<mutex> lock(m_dataLock, defer_lock);
+  for (const StateBatch::Entry* e = first; e != last; e++) {
+    if (e->type != LumiverseType::FLOAT && e->type != LumiverseType::ORIENTATION) {
+      lock.lock();
+      break;
+    }
+  }
+
+  beginWrite();
+  for (const StateBatch::Entry* e = first; e != last; e++) {
+    LumiverseType* target = readParam(e->param);
+
+    // The batch already knows the source type, so this only has to make sure
+    // the target has the same one.
+    if (target == nullptr || target->getTypeTag() != e->type)
+      continue;
+
+    switch (e->type) {
+      case LumiverseType::FLOAT: {
+        LumiverseFloat* t = (LumiverseFloat*)target;
+        LumiverseFloat* s = (LumiverseFloat*)e->value;
+        if (t->getVal() == s->getVal())
+          continue;
+        *t = *s;
+        break;
+      }
+      case LumiverseType::ENUM: {
+        LumiverseEnum* t = (LumiverseEnum*)target;
+        LumiverseEnum* s = (LumiverseEnum*)e->value;
+        if (t->getVal() == s->getVal() && t->getTweak() == s->getTweak())
+          continue;
+        *t = *s;
+        break;
+      }
+      case LumiverseType::COLOR: {
+        LumiverseColor* t = (LumiverseColor*)target;
+        LumiverseColor* s = (LumiverseColor*)e->value;
+        if (t->isEqual(*s))
+          continue;
+        *t = *s;
+        break;
+      }
+      case LumiverseType::ORIENTATION: {
+        LumiverseOrientation* t = (LumiverseOrientation*)target;
+        LumiverseOrientation* s = (LumiverseOrientation*)e->value;
+        if (*t == *s)
+          continue;
+        *t = *s;
+        break;
+      }
+      default:
+        // StateBatch only holds the core types.
+        continue;
+    }
+
+    markChanged(e->param);
+    changed = true;
+  }
+  endWrite();
+
+  if (lock.owns_lock())
+    lock.unlock();
+
+  if (changed)
+    onParameterChanged();
+
+  return changed;
+}
+
 bool Device::paramExists(string param) {
-  return (m_parameters.count(param) > 0);
+  return (readParam(param) != nullptr);
+}
+
+bool Device::paramExists(ParamHandle param) {
+  return (readParam(param) != nullptr);
 }
 
 unsigned int Device::numParams() {
+  lock_guard<mutex> lock(m_dataLock);
   return m_parameters.size();
 }
 
 vector<string> Device::getParamNames() {
+  lock_guard<mutex> lock(m_dataLock);
   vector<string> keys;
   for (const auto& kv : m_parameters) {
     keys.push_back(kv.first);
@@ -262,8 +680,10 @@ vector<string> Device::getParamNames() {
 }
 
 bool Device::getMetadata(string key, string& val) {
-  if (m_metadata.count(key) > 0) {
-    val = m_metadata[key];
+  lock_guard<mutex> lock(m_dataLock);
+  auto it = m_metadata.find(key);
+  if (it != m_metadata.end()) {
+    val = it->second;
     return true;
   }
 
@@ -273,11 +693,17 @@ bool Device::getMetadata(string key, string& val) {
 bool Device::setMetadata(string key, string val) {
   bool ret = false;
 
-  if (m_metadata.count(key) == 0) {
-    ret = true;
-  }
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    if (m_metadata.count(key) == 0) {
+      ret = true;
+    }
 
-  m_metadata[key] = val;
+    beginWrite();
+    m_metadata[key] = val;
+    ++m_generation;
+    endWrite();
+  }
     
   // callback
   onMetadataChanged();
@@ -286,8 +712,14 @@ bool Device::setMetadata(string key, string val) {
 }
 
 void Device::clearMetadataValues() {
-  for (auto& kv : m_metadata) {
-    kv.second = "";
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    for (auto& kv : m_metadata) {
+      kv.second = "";
+    }
+    ++m_generation;
+    endWrite();
   }
     
   // callback
@@ -295,17 +727,25 @@ void Device::clearMetadataValues() {
 }
 
 void Device::clearAllMetadata() {
-  m_metadata.clear();
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    m_metadata.clear();
+    ++m_generation;
+    endWrite();
+  }
     
   // callback
   onMetadataChanged();
 }
 
 unsigned int Device::numMetadataKeys() {
+  lock_guard<mutex> lock(m_dataLock);
   return m_metadata.size();
 }
 
 vector<string> Device::getMetadataKeyNames() {
+  lock_guard<mutex> lock(m_dataLock);
   vector<string> keys;
   for (const auto& kv : m_metadata) {
     keys.push_back(kv.first);
@@ -315,8 +755,16 @@ vector<string> Device::getMetadataKeyNames() {
 }
 
 void Device::reset() {
-  for (auto p : m_parameters) {
-    p.second->reset();
+  {
+    lock_guard<mutex> lock(m_dataLock);
+    beginWrite();
+    for (ParamHandle h = 0; h < m_paramsByHandle.size(); h++) {
+      if (m_paramsByHandle[h] != nullptr) {
+        m_paramsByHandle[h]->reset();
+        markChanged(h);
+      }
+    }
+    endWrite();
   }
     
   // callback
@@ -342,7 +790,7 @@ JSONNode Device::toJSON() {
 
   // Add the device's properties
   root.push_back(JSONNode("channel", m_channel));
-  root.push_back(JSONNode("type", m_type));
+  root.push_back(JSONNode("type", getType()));
 
   // Add the parameters
   root.push_back(parametersToJSON());
@@ -354,14 +802,15 @@ JSONNode Device::toJSON() {
 }
 
 int Device::addParameterChangedCallback(DeviceCallbackFunction func) {
-    size_t id = m_onParameterChangedFunctions.size();
+    // Ids of deleted callbacks leave gaps, so go past the largest one.
+    int id = m_onParameterChangedFunctions.empty() ? 0 : m_onParameterChangedFunctions.rbegin()->first + 1;
     m_onParameterChangedFunctions[id] = func;
 
     return id;
 }
 
 int Device::addMetadataChangedCallback(DeviceCallbackFunction func) {
-    size_t id = m_onMetadataChangedFunctions.size();
+    int id = m_onMetadataChangedFunctions.empty() ? 0 : m_onMetadataChangedFunctions.rbegin()->first + 1;
     m_onMetadataChangedFunctions[id] = func;
 
     return id;
@@ -380,6 +829,7 @@ void Device::deleteMetadataChangedCallback(int id) {
 }
 
 JSONNode Device::parametersToJSON() {
+  lock_guard<mutex> lock(m_dataLock);
   JSONNode params;
   params.set_name("parameters");
 
@@ -391,6 +841,7 @@ JSONNode Device::parametersToJSON() {
 }
 
 JSONNode Device::metadataToJSON() {
+  lock_guard<mutex> lock(m_dataLock);
   JSONNode metadata;
   metadata.set_name("metadata");
 
@@ -401,7 +852,7 @@ JSONNode Device::metadataToJSON() {
   return metadata;
 }
 
-void Device::loadJSON(const JSONNode data) {
+void Device::loadJSON(const JSONNode& data) {
   JSONNode::const_iterator i = data.begin();
 
   // for this we want to iterate through all children and have the device class
@@ -420,7 +871,7 @@ void Device::loadJSON(const JSONNode data) {
       loadParams(*i);
     }
     else if (nodeName == "metadata") {
-      JSONNode metaData = *i;
+      const JSONNode& metaData = *i;
 
       auto meta = metaData.begin();
       while (meta != metaData.end()) {
@@ -437,13 +888,9 @@ void Device::loadJSON(const JSONNode data) {
     //increment the iterator
     ++i;
   }
-
-  stringstream ss;
-  ss << "Loaded " << m_type << " Device " << m_id << " (Channel " << m_channel << ")";
-  Logger::log(INFO, ss.str());
 }
 
-void Device::loadParams(const JSONNode data) {
+void Device::loadParams(const JSONNode& data) {
   JSONNode::const_iterator i = data.begin();
 
   while (i != data.end()){
@@ -451,7 +898,7 @@ void Device::loadParams(const JSONNode data) {
     std::string paramName = i->name();
 
     // Go into the child node that has all the param data
-    JSONNode paramData = *i;
+    const JSONNode& paramData = *i;
     LumiverseType *val = LumiverseTypeUtils::loadFromJSON(paramData);
       
     if (val != nullptr)
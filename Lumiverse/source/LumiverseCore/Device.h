@@ -11,9 +11,16 @@
 #include <string>
 #include <memory>
 #include <sstream>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <mutex>
 
 #include "LumiverseCoreConfig.h"
 #include "Logger.h"
+#include "Interner.h"
+#include "ParameterStore.h"
+#include "StateBatch.h"
 #include "LumiverseType.h"
 #include "types/LumiverseFloat.h"
 #include "types/LumiverseEnum.h"
@@ -56,15 +63,18 @@ namespace Lumiverse {
     * \param data JSONNode containing the device information.
     * \sa Rig, Device(string, unsigned int, string), ~Device()
     */
-    Device(string id, const JSONNode data);
+    Device(string id, const JSONNode& data);
 
     /*!
     * \brief Copies a Device
+    *
+    * Not safe while other threads write to `other`, use snapshot() for that.
     */
     Device(const Device& other);
 
     /*!
     * \brief Copies a Device
+    * \sa Device(const Device&)
     */
     Device(Device* other);
 
@@ -91,6 +101,14 @@ namespace Lumiverse {
     */
     inline string getId() { return m_id; }
 
+    /*!
+    * \brief Accessor for the Device's interned id handle
+    *
+    * \return Handle for the Device's id
+    * \sa acquireDeviceHandle(), Rig::getDevice(DeviceHandle)
+    */
+    inline DeviceHandle getHandle() { return m_handle; }
+
     /*!
     * \brief Accessor for channel
     *
@@ -110,14 +128,14 @@ namespace Lumiverse {
     *
     * \return The Device's type as a string
     */
-    inline string getType() { return m_type; }
+    inline string getType() { lock_guard<mutex> lock(m_dataLock); return m_type; }
 
     /*!
     * \brief Assigns Device type
     *
     * \param newType New type for the device.
     */
-    inline void setType(string newType) { m_type = newType; }
+    inline void setType(string newType) { lock_guard<mutex> lock(m_dataLock); m_type = newType; }
 
     /*!
     * \brief Gets the value of a float parameter
@@ -132,23 +150,72 @@ namespace Lumiverse {
     */
     bool getParam(string param, float& val);
 
+    /*!
+    * \brief Gets the value of a float parameter by handle.
+    *
+    * Same as getParam(string, float&) without the name lookup.
+    * \sa getParamHandle()
+    */
+    bool getParam(ParamHandle param, float& val);
+
     /*!
     * \brief Returns a pointer to the raw LumiverseType data associated with a parameter.
     *
     * This function gives you direct access to the object stored in the Device.
     * Modifying the data in the returned pointer will propagate throughout the Rig.
+    * Since writes through the pointer can't be tracked, the device is treated
+    * as entirely changed on the next Rig update. Writes made through a pointer
+    * kept from an earlier frame aren't picked up, so get it again (or use
+    * setParam()) for each change.
+    *
+    * Writes through the pointer also bypass the locking that makes setParam()
+    * safe against snapshot(), so they are not supported while a running Rig
+    * may be reading the device. Use the setParam() family from other threads.
     * \param param Parameter name
     * \return Pointer to LumiverseType object associated with the paramater.
     * `nullptr` if parameter does not exist in the device.
-    * \sa getParam(string, float&), LumiverseType, LumiverseFloat
+    * \sa getParam(string, float&), readParam(), LumiverseType, LumiverseFloat
     */
     LumiverseType* getParam(string param);
 
+    /*!
+    * \brief Returns a pointer to a parameter by handle.
+    *
+    * Same as getParam(string) without the name lookup.
+    * \sa getParamHandle()
+    */
+    LumiverseType* getParam(ParamHandle param);
+
+    /*!
+    * \brief Returns a pointer to a parameter for reading only.
+    *
+    * Same as getParam(string) but doesn't mark the device as having its raw
+    * parameters handed out. Patches and other readers should use this.
+    * Do not modify the data through the returned pointer.
+    * \param param Parameter name
+    * \return Pointer to the parameter. `nullptr` if it doesn't exist.
+    * \sa getParam(string)
+    */
+    LumiverseType* readParam(string param);
+
+    /*!
+    * \brief Returns a pointer to a parameter for reading only, by handle.
+    *
+    * Handles index straight into the device's parameter slots, so this is
+    * the cheapest way to read a parameter repeatedly.
+    * \sa getParamHandle(), readParam(string)
+    */
+    inline LumiverseType* readParam(ParamHandle param) {
+      return (param < m_paramsByHandle.size()) ? m_paramsByHandle[param] : nullptr;
+    }
+
     /*!
     * \brief Gets a pointer to a LumiverseColor parameter.
     *
     * Gives direct access to a color parameter. Probably the easiest way to
     * modify a color for a device.
+    * Like getParam(string), the device is treated as changed on the next
+    * Rig update only.
     * \param param Parameter name. Defaults to "color" assuming that most people
     * will call the color parameter "color" in their devices.
     * \return Pointer to LumiverseColor object associated with parameter. `nullptr`
@@ -157,6 +224,91 @@ namespace Lumiverse {
     */
     LumiverseColor* getColor(string param = "color");
 
+    /*!
+    * \brief Gets the change generation of the device.
+    *
+    * The generation increases every time a parameter or metadata value is
+    * changed through the Device interface. Compare against a previously
+    * stored value to see if the device changed.
+    * \sa getParamGeneration(), hasRawAccess()
+    */
+    uint64_t getGeneration() { return m_generation.load(); }
+
+    /*!
+    * \brief Gets the device generation at which a parameter last changed.
+    *
+    * \param param Parameter name
+    * \return Generation of the last change. 0 if the parameter hasn't changed
+    * since the device was created or doesn't exist.
+    */
+    uint64_t getParamGeneration(string param);
+
+    /*! \brief Gets the device generation at which a parameter last changed, by handle. */
+    uint64_t getParamGeneration(ParamHandle param);
+
+    /*!
+    * \brief Lists the parameters that changed after a generation.
+    *
+    * Safe to call while other threads change the device, with the same
+    * limits as snapshot().
+    * \param since Generation to compare against, usually an earlier getGeneration().
+    * 0 lists every parameter.
+    * \param[out] changed Handles of the parameters are appended to this.
+    * \sa getParamGeneration()
+    */
+    void getChangedParams(uint64_t since, vector<ParamHandle>& changed);
+
+    /*!
+    * \brief Indicates if raw parameter pointers have been handed out.
+    *
+    * If true, parameters may have changed without the generation changing,
+    * so the device has to be treated as changed.
+    * \sa getParam(string), getColor(), getRawParameters(), takeRawAccess()
+    */
+    bool hasRawAccess() { return m_rawAccess.load(); }
+
+    /*!
+    * \brief Clears the raw access flag and returns its previous value.
+    *
+    * Called by the Rig once per frame, so handing out a pointer marks the
+    * device as changed for one frame rather than for good.
+    * \sa hasRawAccess()
+    */
+    bool takeRawAccess() { return m_rawAccess.exchange(false); }
+
+    /*!
+    * \brief Copies the current state of the device into another device.
+    *
+    * Safe to call while other threads change the device through the Device
+    * interface. Float and orientation writes never wait on this: if one
+    * happens during the copy, the copy is retried, so the result never
+    * contains a half-finished write. Everything that can allocate or free
+    * memory (enums, colors, metadata, the type, new parameters) is written
+    * under m_dataLock, which the copy holds.
+    * Writes through pointers from getParam(), getColor() or getRawParameters()
+    * aren't covered and must not happen while a snapshot may be taken.
+    * \param target Device to copy into. If nullptr, or if its parameters
+    * don't match this device, it is deleted and a new copy is made.
+    * \return The device holding the copy.
+    * \sa Rig::update()
+    */
+    Device* snapshot(Device* target = nullptr);
+
+    /*!
+    * \brief Moves the device's float and color parameters into a ParameterStore.
+    *
+    * Float and color parameters added later are bound to the same store. Binding to
+    * nullptr moves the values back into the parameters themselves. Copies
+    * of the device are never bound. Not safe while other threads use the
+    * device; the Rig only does this between frames.
+    * \param store Store to use, or nullptr.
+    * \sa Rig::setParameterStore()
+    */
+    void bindStore(ParameterStore* store);
+
+    /*! \brief Gets the store the device's floats and colors live in. nullptr if none. */
+    ParameterStore* getStore() { return m_store; }
+
     /*!
     * \brief Sets the value of a parameter.
     * 
@@ -180,6 +332,16 @@ namespace Lumiverse {
     */
     bool setParam(string param, float val);
 
+    /*!
+    * \brief Sets the value of a LumiverseFloat parameter by handle.
+    *
+    * Unlike setParam(string, float), the parameter is not created if it
+    * doesn't exist.
+    * \return False if the parameter doesn't exist or isn't a float.
+    * \sa getParamHandle()
+    */
+    bool setParam(ParamHandle param, float val);
+
     /*!
     * \brief Sets the value of a LumiverseEnum parameter
     *
@@ -194,6 +356,9 @@ namespace Lumiverse {
     */
     bool setParam(string param, string val, float val2 = -1.0f);
 
+    /*! \brief Sets the value of a LumiverseEnum parameter by handle. */
+    bool setParam(ParamHandle param, string val, float val2 = -1.0f);
+
     /*!
     \brief Fully specify the value of an enumeration.
 
@@ -225,6 +390,9 @@ namespace Lumiverse {
     */
     bool setParam(string param, double x, double y, double weight = 1.0);
 
+    /*! \brief Sets the value of a LumiverseColor parameter by handle using LumiverseColor::setxy() */
+    bool setParam(ParamHandle param, double x, double y, double weight = 1.0);
+
     /*! \brief Sets the value of a LumiverseColor parameter
     *
     * Proxy for LumiverseColor::setRGBRaw().
@@ -262,6 +430,22 @@ namespace Lumiverse {
     * \param source Pointer to the data source
     */
     void copyParamByValue(string param, LumiverseType* source);
+
+    /*! \brief Copies the data from source into the parameter with the given handle. */
+    void copyParamByValue(ParamHandle param, LumiverseType* source);
+
+    /*!
+    * \brief Copies a run of state batch entries into this device.
+    *
+    * Entries for parameters this device doesn't have, or has with a different
+    * type, are skipped. Parameter changed callbacks run once at the end, and only
+    * if a value changed.
+    * \param first First entry to copy.
+    * \param last One past the last entry to copy.
+    * \return True if any parameter changed.
+    * \sa Rig::applyState()
+    */
+    bool copyParamsByValue(const StateBatch::Entry* first, const StateBatch::Entry* last);
       
     /*! 
     * \brief Checks for the existance of a parameter
@@ -272,6 +456,9 @@ namespace Lumiverse {
     */
     bool paramExists(string param);
 
+    /*! \brief Checks for the existance of a parameter by handle. */
+    bool paramExists(ParamHandle param);
+
     /*!
     * \brief Get the number of parameters in the device.
     * \return Number of parameters in the device.
@@ -351,10 +538,11 @@ namespace Lumiverse {
     * 
     * This function is intended to provide the collection of parameters for a calling
     * function to iterate though. You may modify the data contained by the map
-    * in a calling function.
+    * in a calling function. As with getParam(string), the device is treated as
+    * changed on the next Rig update after this is called.
     * \return Reference to the map of parameter data.
     */
-    map<string, LumiverseType*>& getRawParameters() { return m_parameters; }
+    map<string, LumiverseType*>& getRawParameters() { m_rawAccess = true; return m_parameters; }
       
     /** Indicates the function signature for parameter and metadata callbacks.
     Currently a device have to pass in "this" pointer. It seems to be other
@@ -414,13 +602,18 @@ namespace Lumiverse {
     * checks in the Rig to make sure the change propagates correctly.
     * \param newId New deivce id
     */
-    void setId(string newId) { m_id = newId; }
+    void setId(string newId) {
+      DeviceHandle old = m_handle;
+      m_id = newId;
+      m_handle = acquireDeviceHandle(newId);
+      releaseDeviceHandle(old);
+    }
 
     /*!
     * \brief Takes parsed JSON data and makes a device.
     * \param data JSON data to turn into a device.
     */
-    void loadJSON(const JSONNode data);
+    void loadJSON(const JSONNode& data);
 
     /*!
     * \brief Loads the parameters of the device from JSON data.
@@ -428,7 +621,7 @@ namespace Lumiverse {
     * \param data JSON node containing the parameters of the device.
     * \sa loadJSON()
     */
-    void loadParams(const JSONNode data);
+    void loadParams(const JSONNode& data);
 
     /*!
     * \brief Serializes the parameters into a JSON node
@@ -455,7 +648,42 @@ namespace Lumiverse {
     * \sa onParameterChanged()
     */
     void onMetadataChanged();
-      
+
+    /*!
+    * \brief Advances the device generation and records it for a parameter.
+    * \param param Handle of the parameter that changed.
+    * \sa getGeneration(), getParamGeneration()
+    */
+    void markChanged(ParamHandle param);
+
+    /*!
+    * \brief Puts a parameter in its handle slot.
+    *
+    * Must be called whenever m_parameters gains or replaces a value.
+    * \return Handle of the parameter.
+    */
+    ParamHandle indexParam(const string& param, LumiverseType* val);
+
+    /*!
+    * \brief Binds a float or color parameter to a store. Other types stay where they are.
+    * \sa LumiverseFloat::bind(), LumiverseColor::bind()
+    */
+    void bindParam(LumiverseType* param, ParameterStore* store, ParamHandle handle);
+
+    /*!
+    * \brief Marks the start of a change to the device.
+    *
+    * Every change made through the Device interface is wrapped in
+    * beginWrite() / endWrite() so snapshot() can detect it.
+    */
+    void beginWrite();
+
+    /*!
+    * \brief Marks the end of a change to the device.
+    * \sa beginWrite()
+    */
+    void endWrite();
+
     /*!
     * \brief Unique identifier for the device.
     *
@@ -466,6 +694,11 @@ namespace Lumiverse {
     // Uniqueness isn't quite enforceable at the device level.
     string m_id;
 
+    /*!
+    * \brief Interned handle for m_id.
+    */
+    DeviceHandle m_handle;
+
     /*!
     * \brief Channel number for the fixture. Does not have to be unique.
     */
@@ -487,6 +720,20 @@ namespace Lumiverse {
     // Type may change in the future as more specialized datatypes come up.
     map<string, LumiverseType*> m_parameters;
 
+    /*!
+    * \brief Parameters indexed by ParamHandle.
+    *
+    * Points at the same objects as m_parameters. Slots for parameters the
+    * device doesn't have are nullptr.
+    */
+    vector<LumiverseType*> m_paramsByHandle;
+
+    /*!
+    * \brief Store holding the values of float and color parameters. nullptr if none.
+    * \sa bindStore()
+    */
+    ParameterStore* m_store;
+
     /*!
     * \brief Map for program-side information.
     * 
@@ -495,6 +742,47 @@ namespace Lumiverse {
     * assuming it can be serialized to a string.
     */
     map<string, string> m_metadata;
+
+    /*!
+    * \brief Change generation of the device.
+    * \sa getGeneration()
+    */
+    atomic<uint64_t> m_generation;
+
+    /*!
+    * \brief Device generation at which each parameter last changed.
+    * \sa getParamGeneration()
+    */
+    vector<uint64_t> m_paramGenerations;
+
+    /*!
+    * \brief True once a mutable pointer to the parameters has been handed out.
+    *
+    * Cleared by the Rig every frame. \sa takeRawAccess()
+    */
+    atomic<bool> m_rawAccess;
+
+    /*!
+    * \brief Protects everything a write can allocate or free.
+    *
+    * Held by writers of enum and color parameters, metadata, the type and the
+    * parameter map itself, and by snapshot() for the whole copy. Float and
+    * orientation writes only overwrite numbers in place and go through the
+    * m_writeSeq check instead. Always taken before beginWrite().
+    */
+    mutable mutex m_dataLock;
+
+    /*!
+    * \brief Incremented at the start and end of every write.
+    * \sa snapshot()
+    */
+    atomic<uint64_t> m_writeSeq;
+
+    /*!
+    * \brief Number of writes currently in progress.
+    * \sa snapshot()
+    */
+    atomic<unsigned int> m_writers;
     
     /*!
     * \brief List of functions to run when a parameter is changed. Each function has an int id.
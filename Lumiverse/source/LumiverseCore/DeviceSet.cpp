@@ -1,17 +1,54 @@
 #include "DeviceSet.h"
+#include "types/ColorConversion.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace Lumiverse {
 
+// Number of set bits in a word.
+static inline size_t popcount(uint64_t word) {
+#ifdef _MSC_VER
+  return (size_t)__popcnt64(word);
+#else
+  return (size_t)__builtin_popcountll(word);
+#endif
+}
+
+// Index of the lowest set bit. word can't be 0.
+static inline unsigned int lowestBit(uint64_t word) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return (unsigned int)index;
+#else
+  return (unsigned int)__builtin_ctzll(word);
+#endif
+}
+
 DeviceSet::DeviceSet(Rig* rig) : m_rig(rig) {
   // look it's empty
 }
 
 DeviceSet::DeviceSet(Rig* rig, set<Device *> devices) : m_rig(rig) {
-  m_workingSet = set<Device *>(devices);
+  for (auto d : devices) {
+    addDevice(d);
+  }
 }
 
 DeviceSet::DeviceSet(const DeviceSet& dc) {
-  m_workingSet = set<Device *>(dc.m_workingSet);
+  m_bits = dc.m_bits;
+  m_loose = dc.m_loose;
+  m_rig = dc.m_rig;
+}
+
+DeviceSet& DeviceSet::operator=(const DeviceSet& dc) {
+  m_bits = dc.m_bits;
+  m_loose = dc.m_loose;
   m_rig = dc.m_rig;
+
+  return *this;
 }
 
 DeviceSet::~DeviceSet() {
@@ -19,75 +56,37 @@ DeviceSet::~DeviceSet() {
 }
 
 DeviceSet DeviceSet::select(string selector) {
-  // First step is to split the entire string into groups.
-  vector<string> groups;
-
-  size_t lbracket = selector.find('[', 0);
-  size_t rbracket;
-
-  // If we're not starting with a bracket, that's ok just treat everything before a bracket as a group.
-  if (lbracket != 0) {
-    groups.push_back(selector.substr(0, lbracket));
-  }
-
-  while (lbracket != string::npos) {
-    rbracket = selector.find(']', lbracket);
-
-    if (rbracket == string::npos) {
-      stringstream ss;
-      ss << "Selector parse error: no matching ] for [ in " << selector << " (" << lbracket << ")";
-      Logger::log(LOG_LEVEL::ERR, ss.str());
-    }
+  if (m_rig == nullptr)
+    return select(QueryPlan(selector));
 
-    groups.push_back(selector.substr(lbracket + 1, rbracket - lbracket - 1));
-    lbracket = selector.find('[', rbracket);
-  }
+  return select(*m_rig->getQueryPlan(selector));
+}
 
+DeviceSet DeviceSet::select(const QueryPlan& plan) {
   // The first selector is always an add.
   bool filter = false;
 
   // Group by group, add devices to the DeviceSet according to the selectors
-  for (string& s : groups) {
-    size_t start = 0;
-    size_t end = 0;
+  for (const auto& group : plan.getGroups()) {
     vector<DeviceSet> queryResults;
 
-    while (start != string::npos) {
-      // Flag indicating the end of an or section.
-      bool consolidate = true;
-
-      // Skip whitespace
-      while (s[start] == ' ' || s[start] == '\n' || s[start] == '\t') {
-        start++;
-      }
-
-      // Time to handle |
-      end = s.find(',', start);
-
-        size_t bar = s.find('|', start);
-        if (bar < end) {
-          end = bar;
-          consolidate = false;
-        }
-
-      string sel = s.substr(start, end - start);
-      DeviceSet temp = parseSelector(sel, filter);
+    for (const auto& step : group) {
+      DeviceSet temp = runStep(step, filter);
 
       // Consolidation step. Either wait until all the or ops have finished
       // and then consolidate results into one set, or just replace selector result with current
       // working set.
-      if (!consolidate) {
+      if (step.orNext) {
         queryResults.push_back(temp);
       }
       else {
-        m_workingSet = set<Device*>(temp.m_workingSet);
+        m_bits = temp.m_bits;
+        m_loose = temp.m_loose;
 
         for (auto& res : queryResults) {
-          m_workingSet.insert(res.m_workingSet.begin(), res.m_workingSet.end());
+          addSet(res);
         }
       }
-
-      start = (end == string::npos) ? end : end + 1;
     }
 
     filter = true;
@@ -96,174 +95,70 @@ DeviceSet DeviceSet::select(string selector) {
   return *this;
 }
 
-DeviceSet DeviceSet::parseSelector(string selector, bool filter) {
-  char type;
-  // first check for !
-  type = (selector[0] == '!') ? selector[1] : selector[0];
-
-  // First check for #, @ or $
-  switch (type) {
-    // Channel selector
-    case '#':
-      return parseChannelSelector(selector, filter);
-      break;
-    // Parameter selector
-    case '@':
-      return parseParameterSelector(selector, filter);
-      break;
-    // Metadata seletor
-    case '$': 
-      return parseMetadataSelector(selector, filter);
-    // Everything else is an ID
-    default:
-      return (filter) ? remove(m_rig->m_devicesById[selector]) : add(m_rig->m_devicesById[selector]);
-  }
-}
-
-DeviceSet DeviceSet::parseMetadataSelector(string selector, bool filter) {
-  regex metadataRegex("(!\?)\\$([\\w\\d\\-]+)([\\!\\*~\\$\\^]?[=])(.+)");
-  smatch matches;
-  regex_match(selector, matches, metadataRegex);
-
-  // Matches size is 5 since entire string is the first match
-  if (matches.size() != 5) {
-    stringstream ss;
-    ss << "Selector parse error: invalid metadata selector format: " << selector;
-    Logger::log(LOG_LEVEL::ERR, ss.str());
-  }
-
-  string invert = matches[1];
-  bool eq = (invert.size() > 0) ? false : true;
-
-  string metadataKey = matches[2];
-  string op = matches[3];
-  string arg = matches[4];
-  regex testArg;
-
-  switch (op[0]) {
-    // Contains
-    case '*':
-      testArg = regex(".*" + arg + ".*");
-      break;
-    // Ends with
-    case '$':
-      testArg = regex(".*" + arg + "$");
-      break;
-    // Starts with
-    case '^':
-      testArg = regex("^" + arg + ".*");
-      break;
-    // Not equal to
-    case '!':
-      eq = !eq;
-      testArg = regex(arg);
-      break;
-    // Exactly equal to
-    case '=':
-      // Anything else is same as =
-    default:
-      testArg = regex("^" + arg + "$");
-      break;
-  }
-
-  return (filter) ? remove(metadataKey, testArg, !eq) : add(metadataKey, testArg, eq);
-}
-
-DeviceSet DeviceSet::parseChannelSelector(string selector, bool filter) {
-  regex metadataRegex("(!\?)#(\\d+)-\?(\\d*)");
-  smatch matches;
-  regex_match(selector, matches, metadataRegex);
-
-  // Matches size is 4 since entire string is the first match
-  if (matches.size() != 4) {
-    stringstream ss;
-    ss << "Selector parse error: invalid channel selector format: " << selector;
-    Logger::log(LOG_LEVEL::ERR, ss.str());
-  }
-
-  string invert = matches[1];
-  bool eq = (invert.size() > 0) ? false : true;
-
-  size_t first, second;
-  stringstream(matches[2]) >> first;
-
-  string secondStr = matches[3];
-  if (secondStr.size() > 0) {
-    stringstream(matches[3]) >> second;
-
-    if (first > second) {
-      // Flip channel ranges if the first value is greater than the second value
-      size_t tmp = first;
-      first = second;
-      second = tmp;
+DeviceSet DeviceSet::runStep(const QueryPlan::Step& step, bool filter) {
+  switch (step.type) {
+    case QueryPlan::ID: {
+      Device* device = m_rig->getDevice(step.name);
+      return (filter) ? remove(device) : add(device);
     }
-  }
+    case QueryPlan::CHANNEL: {
+      // Non-inverted range
+      if (step.eq) {
+        return (filter) ? this->remove(step.first, step.last) : this->add(step.first, step.last);
+      }
 
-  // Non-inverted range
-  if (eq) {
-    if (secondStr.size() == 0) {
-      return (filter) ? this->remove(first) : this->add(first);
-    }
-    else {
-      return (filter) ? this->remove(first, second) : this->add(first, second);
-    }
-  }
-  // Inverted range
-  else {
-    if (secondStr.size() == 0) {
-      size_t lowerEnd = first - 1;
-      size_t upperStart = first + 1;
-      size_t maxChan = m_rig->m_devicesByChannel.rbegin()->first;
+      // Inverted range
+      shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+      if (tables->devicesByChannel.empty())
+        return DeviceSet(*this);
 
-      return (filter) ? this->remove(0, lowerEnd).remove(upperStart, maxChan) : this->add(0, lowerEnd).add(upperStart, maxChan);
-    }
-    else
-    {
-      size_t lowerEnd = first - 1;
-      size_t upperStart = second + 1;
-      size_t maxChan = m_rig->m_devicesByChannel.rbegin()->first;
+      unsigned int lowerEnd = step.first - 1;
+      unsigned int upperStart = step.last + 1;
+      unsigned int maxChan = tables->devicesByChannel.rbegin()->first;
 
       return (filter) ? this->remove(0, lowerEnd).remove(upperStart, maxChan) : this->add(0, lowerEnd).add(upperStart, maxChan);
     }
-  }
-}
+    case QueryPlan::PARAMETER:
+      return parseFloatParameter(step.name, step.op, step.val, filter, step.eq);
+    case QueryPlan::METADATA:
+      if (step.metadataMatch != QueryPlan::REGEX)
+        return indexedMetadata(step.name, step.metadataValue, step.metadataMatch == QueryPlan::PREFIX, filter, step.eq);
 
-DeviceSet DeviceSet::parseParameterSelector(string selector, bool filter) {
-  // Paramters are special in that we need to know the type of parameter we're filtering
-  // before we can construct the actual query in C++
-
-  // Supported Types: LumiverseFloat
-  regex paramRegex("(!\?)@(\\w+)([><!]\?[><=])(\\d*\\.\?\\d*)([f])");
-  smatch matches;
-  regex_match(selector, matches, paramRegex);
-  
-  // Matches size is 6 since entire string is the first match
-  if (matches.size() != 6) {
-    stringstream ss;
-    ss << "Selector parse error: invalid parameter selector format: " << selector;
-    Logger::log(LOG_LEVEL::ERR, ss.str());
-  }
-
-  string type = matches[5];
-  string invert = matches[1];
-  bool eq = (invert.size() > 0) ? false : true;
-
-  switch (type[0]) {
-    // LumiverseFloat
-    case 'f':
-      float val;
-      stringstream(matches[4]) >> val;
-      return parseFloatParameter(matches[2], matches[3], val, filter, eq);
-    // Error
+      return (filter) ? remove(step.name, step.pattern, !step.eq) : add(step.name, step.pattern, step.eq);
     default:
-      stringstream ss;
-      ss << "Selector parse error: invalid parameter selector type: " << type << " in " << selector;
-      Logger::log(LOG_LEVEL::ERR, ss.str());
       return DeviceSet(*this);
   }
 }
 
 DeviceSet DeviceSet::parseFloatParameter(string param, string op, float val, bool filter, bool eq) {
+  // With a parameter store, compare the whole column at once.
+  shared_ptr<ParameterStore> store = m_rig->getParameterStore();
+  if (store != nullptr) {
+    ParameterStore::Comparison cmp = ParameterStore::EQUAL;
+    if (op == "<")
+      cmp = ParameterStore::LESS;
+    else if (op == ">")
+      cmp = ParameterStore::GREATER;
+    else if (op == "<=")
+      cmp = ParameterStore::LESS_EQUAL;
+    else if (op == ">=")
+      cmp = ParameterStore::GREATER_EQUAL;
+    else if (op == "!=")
+      cmp = ParameterStore::NOT_EQUAL;
+
+    // Filtering keeps the devices that the comparison doesn't remove.
+    DeviceSet found(m_rig);
+    if (store->scan(findParamHandle(param), cmp, val, (filter) ? !eq : eq, found.m_bits)) {
+      DeviceSet newSet(*this);
+      if (filter)
+        newSet.intersectSet(found);
+      else
+        newSet.addSet(found);
+
+      return newSet;
+    }
+  }
+
   LumiverseFloat oVal(val);
   LumiverseType* gVal = (LumiverseType *)(&oVal);
 
@@ -296,6 +191,28 @@ DeviceSet DeviceSet::parseFloatParameter(string param, string op, float val, boo
   }
 }
 
+DeviceSet DeviceSet::indexedMetadata(const string& key, const string& val, bool prefix, bool filter, bool eq) {
+  vector<DeviceHandle> handles;
+  m_rig->m_metadataIndex.find(key, val, prefix, eq, handles);
+
+  DeviceSet found(m_rig);
+  shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+
+  for (DeviceHandle h : handles) {
+    // The index can briefly hold devices that are on their way out of the rig.
+    if (tables->getDevice(h) != nullptr)
+      found.setBit(h);
+  }
+
+  DeviceSet newSet(*this);
+  if (filter)
+    newSet.intersectSet(found);
+  else
+    newSet.addSet(found);
+
+  return newSet;
+}
+
 DeviceSet DeviceSet::add(Device* device) {
   DeviceSet newSet(*this);
   newSet.addDevice(device);
@@ -313,9 +230,10 @@ DeviceSet DeviceSet::add(string query) {
 DeviceSet DeviceSet::add(unsigned int channel) {
   DeviceSet newSet(*this);
 
-  auto range = m_rig->m_devicesByChannel.equal_range(channel);
+  shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+  auto range = tables->devicesByChannel.equal_range(channel);
   for (auto it = range.first; it != range.second; it++) {
-    newSet.addDevice(it->second);
+    newSet.setBit(it->second->getHandle());
   }
 
   return newSet;
@@ -323,25 +241,28 @@ DeviceSet DeviceSet::add(unsigned int channel) {
 
 DeviceSet DeviceSet::add(unsigned int lower, unsigned int upper) {
   DeviceSet newSet(*this);
-  
-  for (unsigned int i = lower; i <= upper; i++) {
-    auto range = m_rig->m_devicesByChannel.equal_range(i);
-    for (auto it = range.first; it != range.second; it++) {
-      newSet.addDevice(it->second);
-    }
+
+  shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+  auto end = tables->devicesByChannel.upper_bound(upper);
+  for (auto it = tables->devicesByChannel.lower_bound(lower); it != end; it++) {
+    newSet.setBit(it->second->getHandle());
   }
 
   return newSet;
 }
 
 DeviceSet DeviceSet::add(string key, string val, bool isEqual) {
+  if (MetadataIndex::isLiteral(val))
+    return indexedMetadata(key, val, false, false, isEqual);
+
   return add(key, regex("^" + val + "$"), isEqual);
 }
 
 DeviceSet DeviceSet::add(string key, regex val, bool isEqual) {
   DeviceSet newSet(*this);
 
-  for (auto& d : m_rig->m_devices) {
+  shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+  for (auto& d : tables->devices) {
     string data;
     if (d->getMetadata(key, data)) {
       if (regex_match(data, val) == isEqual) {
@@ -356,8 +277,9 @@ DeviceSet DeviceSet::add(string key, regex val, bool isEqual) {
 DeviceSet DeviceSet::add(string key, LumiverseType* val, function<bool(LumiverseType* a, LumiverseType* b)> cmp, bool isEqual) {
   DeviceSet newSet(*this);
 
-  for (auto& d : m_rig->m_devices) {
-    LumiverseType* data = d->getParam(key);
+  shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+  for (auto& d : tables->devices) {
+    LumiverseType* data = d->readParam(key);
     if (data != nullptr) {
       if (cmp(data, val) == isEqual) {
         newSet.addDevice(d);
@@ -392,7 +314,8 @@ DeviceSet DeviceSet::remove(string query) {
 DeviceSet DeviceSet::remove(unsigned int channel) {
   DeviceSet newSet(*this);
 
-  auto range = m_rig->m_devicesByChannel.equal_range(channel);
+  shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+  auto range = tables->devicesByChannel.equal_range(channel);
   for (auto it = range.first; it != range.second; it++) {
     newSet.removeDevice(it->second);
   }
@@ -403,24 +326,27 @@ DeviceSet DeviceSet::remove(unsigned int channel) {
 DeviceSet DeviceSet::remove(unsigned int lower, unsigned int upper) {
   DeviceSet newSet(*this);
 
-  for (unsigned int i = lower; i <= upper; i++) {
-    auto range = m_rig->m_devicesByChannel.equal_range(i);
-    for (auto it = range.first; it != range.second; it++) {
-      newSet.removeDevice(it->second);
-    }
+  shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+  auto end = tables->devicesByChannel.upper_bound(upper);
+  for (auto it = tables->devicesByChannel.lower_bound(lower); it != end; it++) {
+    newSet.clearBit(it->second->getHandle());
   }
 
   return newSet;
 }
 
 DeviceSet DeviceSet::remove(string key, string val, bool isEqual) {
+  // Keeps the devices that have the key and aren't removed.
+  if (MetadataIndex::isLiteral(val))
+    return indexedMetadata(key, val, false, true, !isEqual);
+
   return remove(key, regex("^" + val + "$"), isEqual);
 }
 
 DeviceSet DeviceSet::remove(string key, regex val, bool isEqual) {
   DeviceSet newSet(*this);
 
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     string data;
     if (d->getMetadata(key, data)) {
       if (regex_match(data, val) == isEqual) {
@@ -431,7 +357,7 @@ DeviceSet DeviceSet::remove(string key, regex val, bool isEqual) {
     else {
       newSet.removeDevice(d);
     }
-  }
+  });
 
   return newSet;
 }
@@ -439,8 +365,8 @@ DeviceSet DeviceSet::remove(string key, regex val, bool isEqual) {
 DeviceSet DeviceSet::remove(string key, LumiverseType* val, function<bool(LumiverseType* a, LumiverseType* b)> cmp, bool isEqual) {
   DeviceSet newSet(*this);
 
-  for (auto& d : m_workingSet) {
-    LumiverseType* data = d->getParam(key);
+  forEachDevice([&](Device* d) {
+    LumiverseType* data = d->readParam(key);
     if (data != nullptr) {
       if (cmp(data, val) == isEqual) {
         newSet.removeDevice(d);
@@ -450,7 +376,7 @@ DeviceSet DeviceSet::remove(string key, LumiverseType* val, function<bool(Lumive
     else {
       newSet.removeDevice(d);
     }
-  }
+  });
 
   return newSet;
 }
@@ -464,91 +390,227 @@ DeviceSet DeviceSet::remove(DeviceSet set) {
 }
 
 void DeviceSet::reset() {
-  for (auto& d : m_workingSet) {
-    d->reset();
-  }
+  forEachDevice([](Device* d) { d->reset(); });
 }
 
 void DeviceSet::addDevice(Device* device) {
-  if (device != nullptr) {
-    m_workingSet.insert(device);
+  if (device == nullptr)
+    return;
+
+  // The handle only finds devices in the rig, so anything else is kept by pointer.
+  if (m_rig == nullptr || m_rig->getDevice(device->getHandle()) != device) {
+    m_loose.insert(device);
+    return;
   }
+
+  setBit(device->getHandle());
 }
 
 void DeviceSet::removeDevice(Device* device) {
-  m_workingSet.erase(device);
+  if (device == nullptr)
+    return;
+
+  // A copy of a rig device shares its handle, so only clear the bit for the rig's own.
+  if (m_loose.erase(device) == 0)
+    clearBit(device->getHandle());
+}
+
+void DeviceSet::addSet(const DeviceSet& otherSet) {
+  if (otherSet.m_bits.size() > m_bits.size())
+    m_bits.resize(otherSet.m_bits.size(), 0);
+
+  for (size_t i = 0; i < otherSet.m_bits.size(); i++) {
+    m_bits[i] |= otherSet.m_bits[i];
+  }
+
+  m_loose.insert(otherSet.m_loose.begin(), otherSet.m_loose.end());
 }
 
-void DeviceSet::addSet(DeviceSet otherSet) {
-  m_workingSet.insert(otherSet.m_workingSet.begin(), otherSet.m_workingSet.end());
+void DeviceSet::removeSet(const DeviceSet& otherSet) {
+  size_t words = min(m_bits.size(), otherSet.m_bits.size());
+  for (size_t i = 0; i < words; i++) {
+    m_bits[i] &= ~otherSet.m_bits[i];
+  }
+
+  for (auto d : otherSet.m_loose) {
+    m_loose.erase(d);
+  }
 }
 
-void DeviceSet::removeSet(DeviceSet otherSet) {
-  for (auto& d : otherSet.m_workingSet) {
-    removeDevice(d);
+void DeviceSet::intersectSet(const DeviceSet& otherSet) {
+  if (m_bits.size() > otherSet.m_bits.size())
+    m_bits.resize(otherSet.m_bits.size());
+
+  for (size_t i = 0; i < m_bits.size(); i++) {
+    m_bits[i] &= otherSet.m_bits[i];
   }
+
+  for (auto it = m_loose.begin(); it != m_loose.end(); ) {
+    if (otherSet.m_loose.count(*it) == 0)
+      it = m_loose.erase(it);
+    else
+      it++;
+  }
+}
+
+void DeviceSet::setBit(DeviceHandle handle) {
+  size_t word = handle / 64;
+  if (word >= m_bits.size())
+    m_bits.resize(word + 1, 0);
+
+  m_bits[word] |= (uint64_t)1 << (handle % 64);
+}
+
+void DeviceSet::clearBit(DeviceHandle handle) {
+  size_t word = handle / 64;
+  if (word < m_bits.size())
+    m_bits[word] &= ~((uint64_t)1 << (handle % 64));
+}
+
+bool DeviceSet::hasBit(DeviceHandle handle) const {
+  size_t word = handle / 64;
+  return word < m_bits.size() && (m_bits[word] & ((uint64_t)1 << (handle % 64))) != 0;
+}
+
+void DeviceSet::forEachDevice(const function<void(Device*)>& func) {
+  if (m_rig != nullptr) {
+    // Held until the end so no device in it gets freed while func runs.
+    shared_ptr<const Rig::Tables> tables = m_rig->getTables();
+
+    for (size_t i = 0; i < m_bits.size(); i++) {
+      uint64_t word = m_bits[i];
+
+      while (word != 0) {
+        Device* d = tables->getDevice((DeviceHandle)(i * 64 + lowestBit(word)));
+        word &= word - 1;
+
+        // Skip devices deleted from the rig since they were added.
+        if (d != nullptr)
+          func(d);
+      }
+    }
+  }
+
+  for (auto d : m_loose) {
+    func(d);
+  }
+}
+
+set<Device *> DeviceSet::getDevices() {
+  set<Device *> devices;
+  forEachDevice([&devices](Device* d) { devices.insert(d); });
+
+  return devices;
+}
+
+vector<Device *> DeviceSet::getDevicesByChannel() {
+  vector<pair<unsigned int, Device*> > byChannel;
+  byChannel.reserve(size());
+  forEachDevice([&byChannel](Device* d) { byChannel.push_back(make_pair(d->getChannel(), d)); });
+
+  // Ids are only compared on shared channels, which are rare.
+  sort(byChannel.begin(), byChannel.end(), [](const pair<unsigned int, Device*>& a, const pair<unsigned int, Device*>& b) {
+    if (a.first != b.first)
+      return a.first < b.first;
+
+    return a.second->getId() < b.second->getId();
+  });
+
+  vector<Device *> devices;
+  devices.reserve(byChannel.size());
+  for (auto& d : byChannel) {
+    devices.push_back(d.second);
+  }
+
+  return devices;
+}
+
+size_t DeviceSet::size() {
+  size_t count = m_loose.size();
+  for (uint64_t word : m_bits) {
+    count += popcount(word);
+  }
+
+  return count;
 }
 
 void DeviceSet::setParam(string param, float val) {
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     if (d->paramExists(param)) {
       d->setParam(param, val);
     }
-  }
+  });
 }
 
 void DeviceSet::setParam(string param, string val, float val2) {
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     if (d->paramExists(param)) {
       d->setParam(param, val, val2);
     }
-  }
+  });
 }
 
 void DeviceSet::setParam(string param, string val, float val2, LumiverseEnum::Mode mode, LumiverseEnum::InterpolationMode interpMode) {
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     if (d->paramExists(param)) {
       d->setParam(param, val, val2, mode, interpMode);
     }
-  }
+  });
 }
 
 void DeviceSet::setParam(string param, string channel, double val) {
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     if (d->paramExists(param)) {
       d->setParam(param, channel, val);
     }
-  }
+  });
 }
 
 void DeviceSet::setParam(string param, double x, double y, double weight) {
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     if (d->paramExists(param)) {
       d->setParam(param, x, y, weight);
     }
-  }
+  });
 }
 
 void DeviceSet::setColorRGBRaw(string param, double r, double g, double b, double weight) {
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     if (d->paramExists(param)) {
       d->setColorRGBRaw(param, r, g, b, weight);
     }
-  }
+  });
 }
 
 void DeviceSet::setColorRGB(string param, double r, double g, double b, double weight, RGBColorSpace cs) {
-  for (auto& d : m_workingSet) {
+  forEachDevice([&](Device* d) {
     if (d->paramExists(param)) {
       d->setColorRGB(param, r, g, b, weight, cs);
     }
-  }
+  });
+}
+
+void DeviceSet::getColorXYZ(string param, vector<Device*>& devices, vector<Eigen::Vector3d>& XYZ) {
+  vector<LumiverseColor*> colors;
+  devices.clear();
+
+  forEachDevice([&](Device* d) {
+    LumiverseType* data = d->readParam(param);
+    if (data != nullptr && data->getTypeTag() == LumiverseType::COLOR) {
+      devices.push_back(d);
+      colors.push_back((LumiverseColor*)data);
+    }
+  });
+
+  XYZ.resize(colors.size());
+  if (!colors.empty())
+    ColorConversion::getXYZ(&colors[0], &XYZ[0], colors.size());
 }
 
 vector<string> DeviceSet::getIds() {
   vector<string> ids;
   
-  for (auto& d : m_workingSet) {
+  for (auto d : getDevicesByChannel()) {
     ids.push_back(d->getId());
   }
 
@@ -558,11 +620,11 @@ vector<string> DeviceSet::getIds() {
 set<string> DeviceSet::getAllParams() {
   set<string> params;
 
-  for (auto& d : m_workingSet) {
+  forEachDevice([&params](Device* d) {
     for (auto& s : d->getParamNames()) {
       params.insert(s);
     }
-  }
+  });
 
   return params;
 }
@@ -570,11 +632,11 @@ set<string> DeviceSet::getAllParams() {
 set<string> DeviceSet::getAllMetadata() {
   set<string> params;
 
-  for (auto& d : m_workingSet) {
+  forEachDevice([&params](Device* d) {
     for (auto& s : d->getMetadataKeyNames()) {
       params.insert(s);
     }
-  }
+  });
 
   return params;
 }
@@ -586,7 +648,7 @@ string DeviceSet::info() {
   ss << "IDs: ";
 
   bool first = true;
-  for (auto& d : m_workingSet) {
+  for (auto d : getDevicesByChannel()) {
     ss << ((first) ? "" : ", ") << d->getId();
     first = false;
   }
@@ -10,10 +10,13 @@
 #include <set>
 #include <regex>
 #include <functional>
+#include <vector>
+#include <cstdint>
 
 #include "Logger.h"
 #include "Device.h"
 #include "Rig.h"
+#include "QueryPlan.h"
 
 namespace Lumiverse {
   class Rig;
@@ -36,10 +39,20 @@ namespace Lumiverse {
   * not saved, but may in the future be part of this class.
   * Alternately, DeviceSets can be constructed from concise queries: 
   * https://github.com/ebshimizu/Lumiverse/wiki/Query-Syntax-Notes
+  *
+  * Internally the set is a bitset indexed by DeviceHandle, so copying a set
+  * and combining sets work on 64 devices at a time. Devices deleted from the
+  * Rig drop out of the set. Devices that aren't in the set's Rig, or added
+  * to a set without one, are kept by pointer instead. Queries only find
+  * devices in the Rig. Rig devices are visited in handle order, then the
+  * others; getDevicesByChannel() sorts by channel when that order matters.
   * \sa Device
   */
   class DeviceSet
   {
+    /*! \sa LiveView */
+    friend class LiveView;
+
   public:
     /*!
     * \brief Constructs a DeviceSet unassociated with a Rig
@@ -49,7 +62,7 @@ namespace Lumiverse {
     * it can store an arbitrary list of deivces.
     * \sa DeviceSet(Rig*), DeviceSet(const DeviceSet&)
     */
-    DeviceSet() { };
+    DeviceSet() : m_rig(nullptr) { };
 
     /*!
     * \brief Constructs an empty set
@@ -76,6 +89,14 @@ namespace Lumiverse {
     */
     DeviceSet(const DeviceSet& dc);
 
+    /*!
+    * \brief Copy a DeviceSet
+    *
+    * \param dc DeviceSet to copy data from
+    * \return This set.
+    */
+    DeviceSet& operator=(const DeviceSet& dc);
+
     /*!
     * \brief Destructor for the DeviceSet
     */
@@ -98,70 +119,40 @@ namespace Lumiverse {
     * 
     * This is the primary function to select Devices from the Rig.
     * Syntax details can be found here: https://github.com/ebshimizu/Lumiverse/wiki/Query-Syntax-Notes
+    * The compiled query is cached by the Rig, see Rig::getQueryPlan().
     * \param selector Query string.
     * \return DeviceSet containing all Device objects matching the selector
     */
     DeviceSet select(string selector);
 
+    /*!
+    * \brief Get devices matching an already compiled query from the Rig
+    *
+    * \param plan Compiled query.
+    * \return DeviceSet containing all Device objects matching the query
+    * \sa select(string), QueryPlan
+    */
+    DeviceSet select(const QueryPlan& plan);
+
   private:
     // Grouped here for convenience
-    
     /*!
-    * \brief Parses a single selector.
+    * \brief Runs a single compiled selector.
     *
-    * Redirects to appropriate functions. See implementation for details.
     * Boolean flag determines if selected Devices are added or subtracted from
     * the current DeviceSet.
-    * \param selector Query string
+    * \param step Selector to run
     * \param filter If true, indicates that devices will be filtered out of the current device set
     * based on the result of the selector. If false, devices will be added based on the selector result.
     * \return DeviceSet containing the result of applying the selector to the current set.
-    * \sa parseMetadataSelector(string, bool), parseChannelSelector(string, bool), parseParameterSelector(string, bool),
-    * parseFloatParameter(string, string, float, bool, bool)
-    */
-    DeviceSet parseSelector(string selector, bool filter);
-
-    /*!
-    * \brief Processes a metadata selector
-    * 
-    * Helper for parseSelector.
-    * \param selector Query string
-    * \param filter If true, indicates that devices will be filtered out of the current device set
-    * based on the result of the selector. If false, devices will be added based on the selector result.
-    * \return DeviceSet containing the result of applying the metadata selector to the current set.
-    * \sa parseSelector(string, bool)
+    * \sa parseFloatParameter(string, string, float, bool, bool)
     */
-    DeviceSet parseMetadataSelector(string selector, bool filter);
-
-    /*!
-    * \brief Processes a channel selector
-    *
-    * Helper for parseSelector.
-    * \param selector Query string
-    * \param filter If true, indicates that devices will be filtered out of the current device set
-    * based on the result of the selector. If false, devices will be added based on the selector result.
-    * \return DeviceSet containing the result of applying the channel selector to the current set.
-    * \sa parseSelector(string, bool)
-    */
-    DeviceSet parseChannelSelector(string selector, bool filter);
-
-    /*!
-    * \brief Processes a parameter selector
-    *
-    * Helper for parseSelector. This part of the query is a bit difficult to parse
-    * due to LumiverseType objects actually being different types (enum, float, etc.).
-    * \param selector Query string
-    * \param filter If true, indicates that devices will be filtered out of the current device set
-    * based on the result of the selector. If false, devices will be added based on the selector result.
-    * \return DeviceSet containing the result of applying the parameter selector to the current set.
-    * \sa parseSelector(string, bool), parseFloatParameter(string, string, float, bool, bool)
-    */
-    DeviceSet parseParameterSelector(string selector, bool filter);
+    DeviceSet runStep(const QueryPlan::Step& step, bool filter);
 
     /*!
     * \brief Processes a float parameter selector
     *
-    * Helper for parseParameterSelector.
+    * Helper for runStep().
     * \param param Parameter name
     * \param op Equality operation. One of "<", "<=", ">", ">=, "!=". Defaults to "==" if nothing specified
     * or if invalid option is specified.
@@ -172,10 +163,26 @@ namespace Lumiverse {
     * It essentially inverts the query. For example, if you have `@intensity < .50` as the query with `eq = false`,
     * the returned set will contain `@intensity >= .5`. This parameter is intended for internal use only.
     * \return DeviceSet containing the result of applying the channel selector to the current set.
-    * \sa parseParameterSelector(string, bool)
+    * \sa runStep()
     */
     DeviceSet parseFloatParameter(string param, string op, float val, bool filter, bool eq);
 
+    /*!
+    * \brief Processes an exact or prefix metadata selector with the Rig's MetadataIndex
+    *
+    * Helper for runStep() and the string metadata add and remove. Gives the same
+    * result as matching `^val$` or `^val.*` against every device.
+    * \param key Metadata key
+    * \param val Value, taken literally
+    * \param prefix If true, matches values starting with val instead of equal to it.
+    * \param filter If true, only devices already in the set that have the key and
+    * match are kept. If false, devices that have the key and match are added.
+    * \param eq If set to false, devices that have the key and don't match are used instead.
+    * \return DeviceSet containing the result of applying the selector to the current set.
+    * \sa MetadataIndex
+    */
+    DeviceSet indexedMetadata(const string& key, const string& val, bool prefix, bool filter, bool eq);
+
   public:
     /*!
     * \brief Adds a Device to the set.
@@ -431,11 +438,34 @@ namespace Lumiverse {
     void setColorRGB(string param, double r, double g, double b, double weight = 1.0, RGBColorSpace cs = sRGB);
 
     /*!
-    * \brief Gets the devices managed by this set.
+    * \brief Gets the XYZ coordinates of a LumiverseColor parameter of every device.
+    *
+    * Devices that don't have the parameter, or where it isn't a color, are
+    * skipped. The coordinates can be passed straight to the ColorConversion
+    * functions to get the colors of the whole set in another color space.
+    * \param param Parameter name
+    * \param devices Receives the devices that have the color, in set order.
+    * \param XYZ Receives the XYZ coordinates of each color in devices.
+    * \sa LumiverseColor::getXYZ(), ColorConversion
+    */
+    void getColorXYZ(string param, vector<Device*>& devices, vector<Eigen::Vector3d>& XYZ);
+
+    /*!
+    * \brief Gets a copy of the devices managed by this set.
     * 
+    * The set is rebuilt from the bitset on every call.
     * \return Set of Device* contained by the DeviceSet
+    * \sa getDevicesByChannel()
     */
-    inline const set<Device *>& getDevices() { return m_workingSet; }
+    set<Device *> getDevices();
+
+    /*!
+    * \brief Gets the devices managed by this set in channel order.
+    *
+    * Devices on the same channel are ordered by id.
+    * \return Devices contained by the DeviceSet
+    */
+    vector<Device *> getDevicesByChannel();
 
     /*!
     * \brief Gets a copy of the list of the IDs contained by this DeviceSet
@@ -466,7 +496,7 @@ namespace Lumiverse {
     * \brief Returns the number of devices in the DeviceSet.
     * \return Number of devices in the set.
     */
-    inline size_t size() { return m_workingSet.size(); }
+    size_t size();
 
   private:
     /*!
@@ -491,7 +521,7 @@ namespace Lumiverse {
     * Internal set opration. Equivalent to a union.
     * \param otherSet The set to add to the DeviceSet.
     */
-    void addSet(DeviceSet otherSet);
+    void addSet(const DeviceSet& otherSet);
 
     /*!
     * \brief Removes a set from the current set
@@ -499,12 +529,42 @@ namespace Lumiverse {
     * Internal set opration. Equivalent to a set difference.
     * \param otherSet The set to remove fromthe DeviceSet.
     */
-    void removeSet(DeviceSet otherSet);
+    void removeSet(const DeviceSet& otherSet);
+
+    /*!
+    * \brief Keeps only the devices also in another set
+    *
+    * Internal set operation. Equivalent to an intersection.
+    * \param otherSet The set to intersect with.
+    */
+    void intersectSet(const DeviceSet& otherSet);
+
+    /*! \brief Adds a device by handle. Doesn't check that it's in the rig. */
+    void setBit(DeviceHandle handle);
+
+    /*! \brief Removes a device by handle. */
+    void clearBit(DeviceHandle handle);
+
+    /*! \brief Checks if a device is in the set by handle. */
+    bool hasBit(DeviceHandle handle) const;
+
+    /*!
+    * \brief Calls a function for every device in the set.
+    *
+    * Rig devices are visited in handle order, then devices kept by pointer.
+    * Nothing is allocated or sorted, so bulk setters stay linear.
+    */
+    void forEachDevice(const function<void(Device*)>& func);
 
     /*!
-    * \brief Set of devices currently contained in the Deviceset
+    * \brief Devices currently contained in the DeviceSet
+    *
+    * Bit `h % 64` of word `h / 64` is set if the device with handle h is in the set.
     */
-    set<Device *> m_workingSet;
+    vector<uint64_t> m_bits;
+
+    /*! \brief Devices in the set that aren't in m_rig, so they have no bit. */
+    set<Device *> m_loose;
 
     /*!
     * \brief Pointer to the rig for accessing indexes and devices
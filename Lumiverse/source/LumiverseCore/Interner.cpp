@@ -0,0 +1,99 @@
+#include "Interner.h"
+
+namespace Lumiverse {
+
+unsigned int Interner::intern(const string& name) {
+  lock_guard<mutex> lock(m_lock);
+
+  auto it = m_ids.find(name);
+  if (it != m_ids.end())
+    return it->second;
+
+  return assign(name);
+}
+
+unsigned int Interner::acquire(const string& name) {
+  lock_guard<mutex> lock(m_lock);
+
+  auto it = m_ids.find(name);
+  unsigned int id = (it != m_ids.end()) ? it->second : assign(name);
+  m_refs[id]++;
+
+  return id;
+}
+
+void Interner::release(unsigned int id) {
+  lock_guard<mutex> lock(m_lock);
+
+  if (id >= m_refs.size() || m_refs[id] == 0)
+    return;
+
+  if (--m_refs[id] == 0) {
+    m_ids.erase(m_names[id]);
+    m_names[id].clear();
+  }
+}
+
+unsigned int Interner::assign(const string& name) {
+  unsigned int id = (unsigned int)m_names.size();
+  m_names.push_back(name);
+  m_refs.push_back(0);
+  m_ids[name] = id;
+
+  return id;
+}
+
+unsigned int Interner::find(const string& name) {
+  lock_guard<mutex> lock(m_lock);
+
+  auto it = m_ids.find(name);
+  return (it != m_ids.end()) ? it->second : InvalidHandle;
+}
+
+string Interner::getName(unsigned int id) {
+  lock_guard<mutex> lock(m_lock);
+  return (id < m_names.size()) ? m_names[id] : "";
+}
+
+unsigned int Interner::size() {
+  lock_guard<mutex> lock(m_lock);
+  return (unsigned int)m_names.size();
+}
+
+// Function-local statics so devices constructed during static
+// initialization still find the tables ready.
+static Interner& paramNames() {
+  static Interner names;
+  return names;
+}
+
+static Interner& deviceIds() {
+  static Interner ids;
+  return ids;
+}
+
+ParamHandle getParamHandle(const string& name) {
+  return paramNames().intern(name);
+}
+
+ParamHandle findParamHandle(const string& name) {
+  return paramNames().find(name);
+}
+
+string getParamName(ParamHandle handle) {
+  return paramNames().getName(handle);
+}
+
+DeviceHandle acquireDeviceHandle(const string& id) {
+  return deviceIds().acquire(id);
+}
+
+void releaseDeviceHandle(DeviceHandle handle) {
+  deviceIds().release(handle);
+}
+
+string getDeviceName(DeviceHandle handle) {
+  return deviceIds().getName(handle);
+}
+
+}
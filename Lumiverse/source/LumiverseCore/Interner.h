@@ -0,0 +1,136 @@
+/*! \file Interner.h
+* \brief Maps device ids and parameter names to dense integer handles.
+*/
+#ifndef _INTERNER_H_
+#define _INTERNER_H_
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+
+using namespace std;
+
+namespace Lumiverse {
+  /*! \brief Integer handle for a parameter name. \sa getParamHandle() */
+  typedef unsigned int ParamHandle;
+
+  /*! \brief Integer handle for a device id. \sa acquireDeviceHandle() */
+  typedef unsigned int DeviceHandle;
+
+  /*! \brief Value of a handle that doesn't refer to anything. */
+  const unsigned int InvalidHandle = (unsigned int)-1;
+
+  /*!
+  * \brief Assigns dense integer ids to strings.
+  *
+  * The first string interned gets id 0, the next 1, and so on, so ids can
+  * index directly into arrays. Ids handed out by intern() are kept for good.
+  * Ids handed out by acquire() are dropped when the last holder releases
+  * them. A dropped id is never given out again, so ids kept elsewhere can't
+  * end up naming a different string, and acquiring the string again gives
+  * it a new id. An Interner should use one or the other, since release()
+  * can drop an id that intern() also handed out.
+  * All functions are thread safe.
+  */
+  class Interner
+  {
+  public:
+    /*!
+    * \brief Gets the id for a string, assigning a new one if needed.
+    * \param name String to intern.
+    * \return Id of the string.
+    */
+    unsigned int intern(const string& name);
+
+    /*!
+    * \brief Gets the id for a string and holds it until release() is called.
+    * \param name String to intern.
+    * \return Id of the string.
+    */
+    unsigned int acquire(const string& name);
+
+    /*!
+    * \brief Drops a hold on an id taken with acquire().
+    *
+    * When the last hold is dropped, the string is forgotten. The id isn't
+    * reused.
+    * \param id Id to release.
+    */
+    void release(unsigned int id);
+
+    /*!
+    * \brief Gets the id for a string without assigning a new one.
+    * \param name String to look up.
+    * \return Id of the string. InvalidHandle if it was never interned.
+    */
+    unsigned int find(const string& name);
+
+    /*!
+    * \brief Gets the string for an id.
+    * \param id Id to look up.
+    * \return The string. Empty if the id was never assigned.
+    */
+    string getName(unsigned int id);
+
+    /*! \brief Gets one past the highest id assigned so far. */
+    unsigned int size();
+
+  private:
+    /*! \brief Assigns an id to a string that doesn't have one. */
+    unsigned int assign(const string& name);
+
+    /*! \brief Maps strings to their ids. */
+    unordered_map<string, unsigned int> m_ids;
+
+    /*! \brief Strings indexed by id. */
+    deque<string> m_names;
+
+    /*! \brief Holds on each id. Ids from intern() are never released. */
+    deque<unsigned int> m_refs;
+
+    /*! \brief Protects the tables. */
+    mutex m_lock;
+  };
+
+  /*!
+  * \brief Gets the handle for a parameter name, assigning one if needed.
+  *
+  * Parameter handles are shared by all devices, so a handle looked up once
+  * can be used with any Device that has the parameter.
+  * \sa Device::getParam(ParamHandle)
+  */
+  ParamHandle getParamHandle(const string& name);
+
+  /*!
+  * \brief Gets the handle for a parameter name if it exists.
+  * \return The handle. InvalidHandle if no device ever had the parameter.
+  */
+  ParamHandle findParamHandle(const string& name);
+
+  /*! \brief Gets the parameter name for a handle. */
+  string getParamName(ParamHandle handle);
+
+  /*!
+  * \brief Gets the handle for a device id and holds it.
+  *
+  * Each Device holds the handle of its id while it exists. Once every
+  * device with the id is gone the handle is retired for good, so handles
+  * kept in DeviceSets, views, journals or state batches never resolve to a
+  * device added later. A device added while another with the same id is
+  * still alive shares its handle, since they are the same device to the
+  * rest of the library. Handles are 32 bits, so running out isn't a concern.
+  * \sa releaseDeviceHandle(), Rig::getDevice(DeviceHandle)
+  */
+  DeviceHandle acquireDeviceHandle(const string& id);
+
+  /*! \brief Drops a hold taken with acquireDeviceHandle(). */
+  void releaseDeviceHandle(DeviceHandle handle);
+
+  /*! \brief Gets the device id for a handle. */
+  string getDeviceName(DeviceHandle handle);
+}
+#endif
@@ -0,0 +1,113 @@
+#include "LiveView.h"
+#include "Rig.h"
+
+#include <algorithm>
+
+namespace Lumiverse {
+
+LiveView::LiveView(Rig* rig, shared_ptr<const QueryPlan> plan) :
+  m_rig(rig), m_plan(plan), m_set(rig), m_size(0), m_version(0)
+{
+}
+
+// True if both bitsets hold the same devices. Missing words count as empty.
+static bool sameBits(const vector<uint64_t>& a, const vector<uint64_t>& b) {
+  size_t words = max(a.size(), b.size());
+  for (size_t i = 0; i < words; i++) {
+    uint64_t wa = (i < a.size()) ? a[i] : 0;
+    uint64_t wb = (i < b.size()) ? b[i] : 0;
+    if (wa != wb)
+      return false;
+  }
+
+  return true;
+}
+
+DeviceSet LiveView::getDevices() {
+  refreshIfStopped();
+  lock_guard<mutex> lock(m_lock);
+  return m_set;
+}
+
+bool LiveView::contains(Device* device) {
+  refreshIfStopped();
+  lock_guard<mutex> lock(m_lock);
+  return device != nullptr && m_set.hasBit(device->getHandle());
+}
+
+size_t LiveView::size() {
+  refreshIfStopped();
+  lock_guard<mutex> lock(m_lock);
+  return m_size;
+}
+
+uint64_t LiveView::getVersion() {
+  refreshIfStopped();
+  lock_guard<mutex> lock(m_lock);
+  return m_version;
+}
+
+void LiveView::refresh() {
+  DeviceSet result = DeviceSet(m_rig).select(*m_plan);
+  size_t size = result.size();
+
+  lock_guard<mutex> lock(m_lock);
+  if (sameBits(m_set.m_bits, result.m_bits))
+    return;
+
+  m_set = result;
+  m_size = size;
+  m_version++;
+}
+
+void LiveView::refreshIfStopped() {
+  if (!m_rig->isRunning())
+    refresh();
+}
+
+void LiveView::update(const set<Device *>& changed) {
+  lock_guard<mutex> lock(m_lock);
+  bool updated = false;
+
+  for (Device* d : changed) {
+    bool in = m_set.hasBit(d->getHandle());
+    if (m_plan->matches(d) == in)
+      continue;
+
+    if (in) {
+      m_set.clearBit(d->getHandle());
+      m_size--;
+    }
+    else {
+      m_set.setBit(d->getHandle());
+      m_size++;
+    }
+
+    updated = true;
+  }
+
+  if (updated)
+    m_version++;
+}
+
+void LiveView::remove(Device* device) {
+  lock_guard<mutex> lock(m_lock);
+
+  if (m_set.hasBit(device->getHandle())) {
+    m_set.clearBit(device->getHandle());
+    m_size--;
+    m_version++;
+  }
+}
+
+void LiveView::clear() {
+  lock_guard<mutex> lock(m_lock);
+  if (m_size == 0)
+    return;
+
+  m_set = DeviceSet(m_rig);
+  m_size = 0;
+  m_version++;
+}
+
+}
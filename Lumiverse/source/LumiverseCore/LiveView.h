@@ -0,0 +1,122 @@
+/*! \file LiveView.h
+* \brief Query results kept current by the Rig.
+*/
+#ifndef _LIVEVIEW_H_
+#define _LIVEVIEW_H_
+
+#pragma once
+
+#include <set>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "DeviceSet.h"
+#include "QueryPlan.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  class Rig;
+  class Device;
+
+  /*!
+  * \brief The result of a query, updated as devices change.
+  *
+  * Made with Rig::createView(). Every frame the Rig update loop checks the
+  * front buffer copy of each device that changed against the view's query,
+  * so the view always holds what Rig::query() would return, as of the last
+  * frame, without running the query again. For example a view of
+  * `@intensity>0.5f` gains a device in the frame its intensity goes above 0.5.
+  *
+  * While the Rig is stopped there are no frames, so reading the view runs
+  * the whole query again instead. Views can be read from any thread, and
+  * stop being updated once the last shared_ptr to them is gone. Like
+  * DeviceSets, they must not outlive their Rig.
+  * \sa Rig::createView(), QueryPlan::matches()
+  */
+  class LiveView
+  {
+  public:
+    /*!
+    * \brief Makes an empty view.
+    *
+    * Use Rig::createView() instead, which registers the view and fills it.
+    * \param rig Rig the devices come from.
+    * \param plan Query.
+    */
+    LiveView(Rig* rig, shared_ptr<const QueryPlan> plan);
+
+    /*! \brief Gets the query of the view. */
+    const QueryPlan& getPlan() const { return *m_plan; }
+
+    /*!
+    * \brief Gets a copy of the devices in the view.
+    *
+    * The copy is a few words per 64 devices in the rig.
+    */
+    DeviceSet getDevices();
+
+    /*! \brief Checks if a device is in the view. */
+    bool contains(Device* device);
+
+    /*! \brief Gets the number of devices in the view. */
+    size_t size();
+
+    /*!
+    * \brief Gets the number of times the view has changed.
+    *
+    * Only goes up when devices join or leave the view, so it's a cheap way to
+    * tell if anything needs redrawing.
+    */
+    uint64_t getVersion();
+
+    /*!
+    * \brief Runs the whole query again.
+    *
+    * Called by the Rig between frames, and by readers while the Rig is stopped.
+    */
+    void refresh();
+
+    /*!
+    * \brief Checks devices that changed against the query.
+    *
+    * Only called by the Rig update loop.
+    * \param changed Front buffer copies of the devices that changed in the frame.
+    */
+    void update(const set<Device *>& changed);
+
+    /*!
+    * \brief Takes a device out of the view.
+    *
+    * Only called by the Rig when the device is deleted.
+    */
+    void remove(Device* device);
+
+    /*! \brief Empties the view. Only called by the Rig. */
+    void clear();
+
+  private:
+    /*! \brief Runs the query again if the Rig isn't running to keep the view current. */
+    void refreshIfStopped();
+
+    /*! \brief Rig the devices come from. */
+    Rig* m_rig;
+
+    /*! \brief Query. */
+    shared_ptr<const QueryPlan> m_plan;
+
+    /*! \brief Devices in the view. */
+    DeviceSet m_set;
+
+    /*! \brief Number of devices in m_set. */
+    size_t m_size;
+
+    /*! \brief Incremented every time m_set changes. */
+    uint64_t m_version;
+
+    /*! \brief Protects the view. The update loop writes it while others read. */
+    mutex m_lock;
+  };
+}
+#endif
@@ -54,11 +54,26 @@
 #include "Device.h"
 #include "Rig.h"
 #include "DeviceSet.h"
+#include "QueryPlan.h"
+#include "MetadataIndex.h"
+#include "LiveView.h"
+#include "TimingHistogram.h"
+#include "WorkerPool.h"
+#include "Interner.h"
+#include "ParameterStore.h"
+#include "RigLoader.h"
+#include "BinarySnapshot.h"
+#include "StateBatch.h"
+#include "ChangeSet.h"
+#include "ChangeJournal.h"
 #include "Patch.h"
 #include "LumiverseType.h"
 #include "types/LumiverseFloat.h"
 #include "types/LumiverseEnum.h"
+#include "types/ChromaSolver.h"
+#include "types/ColorLayout.h"
 #include "types/LumiverseColor.h"
+#include "types/ColorConversion.h"
 #include "types/LumiverseTypeUtils.h"
 #include "DMX/DMXPatch.h"
 #include "DMX/DMXDevicePatch.h"
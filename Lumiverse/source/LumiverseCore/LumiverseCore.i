@@ -19,6 +19,11 @@ using namespace Lumiverse;
 %apply const std::string& {std::string* m_id};
 %apply const std::string& {std::string* m_type};
 
+enum OverrunPolicy {
+  OVERRUN_SKIP,
+  OVERRUN_CATCH_UP
+};
+
 class Rig
 {
   friend class DeviceSet;
@@ -33,6 +38,7 @@ public:
   void stop();
   void addDevice(Device * device);
   Device* getDevice(string id);
+  Device* getDevice(unsigned int handle);
   void deleteDevice(string id);
   void addPatch(string id, Patch* patch);
   Patch* getPatch(string id);
@@ -40,6 +46,11 @@ public:
   void deletePatch(string id);
   void setRefreshRate(unsigned int rate);
   unsigned int getRefreshRate() { return m_refreshRate; }
+  void setSpinTime(unsigned int us);
+  unsigned int getSpinTime();
+  void setOverrunPolicy(OverrunPolicy policy);
+  OverrunPolicy getOverrunPolicy();
+  void setParameterStore(bool enable);
   Device* operator[](string id);
   DeviceSet query(string q);
   DeviceSet operator[](unsigned int channel);
@@ -47,7 +58,7 @@ public:
   DeviceSet getChannel(unsigned int channel);
   DeviceSet getChannel(unsigned int lower, unsigned int upper);
   DeviceSet getDevices(string key, string val, bool isEqual);
-  const set<Device *>* getDeviceRaw() { return &m_devices; }
+  set<Device *> getDeviceRaw();
 };
 
 class DeviceSet
@@ -80,9 +91,9 @@ public:
   DeviceSet remove(string key, regex val, bool isEqual);
   DeviceSet remove(string key, Lumiverse::LumiverseType* val, function<bool(Lumiverse::LumiverseType* a, Lumiverse::LumiverseType* b)> cmp, bool isEqual);
   void setParam(string param, float val);
-  inline const set<Device *>* getDevices() { return &m_workingSet; }
+  set<Device *> getDevices();
   string info();
-  inline size_t size() { return m_workingSet.size(); }
+  size_t size();
 };
 
 class Device
@@ -98,6 +109,7 @@ public:
   };
 
   inline string getId() { return m_id; }
+  unsigned int getHandle();
   inline unsigned int getChannel() { return m_channel; }
   inline void setChannel(unsigned int newChan) { m_channel = newChan; }
   inline string getType() { return m_type; }
@@ -23,6 +23,26 @@ namespace Lumiverse {
   class LumiverseType
   {
   public:
+    /*!
+    * \brief Tags for the built in types.
+    *
+    * Every object carries one, so code that handles each type differently can
+    * switch on getTypeTag() instead of calling getTypeName() and comparing strings.
+    */
+    enum TypeTag {
+      FLOAT,        /*!< LumiverseFloat */
+      ENUM,         /*!< LumiverseEnum */
+      COLOR,        /*!< LumiverseColor */
+      ORIENTATION,  /*!< LumiverseOrientation */
+      OTHER         /*!< Any type defined outside of the core */
+    };
+
+    /*!
+    * \brief Makes a type with the given tag.
+    * \param tag Tag of the subclass. Types outside of the core should leave this as OTHER.
+    */
+    LumiverseType(TypeTag tag = OTHER) : m_typeTag(tag) { }
+
     /*! \brief Destroys the object. */
     virtual ~LumiverseType() { };
 
@@ -34,6 +54,14 @@ namespace Lumiverse {
     */
     virtual string getTypeName() = 0;
 
+    /*!
+    * \brief Gets the tag of the type.
+    *
+    * Not virtual, so this is just a load.
+    * \sa getTypeName()
+    */
+    TypeTag getTypeTag() const { return m_typeTag; }
+
     /*!
     * \brief Resets the data to a type-defined default.
     */
@@ -60,6 +88,10 @@ namespace Lumiverse {
 
     // Yeah actually there's not much here because types are
     // all different.
+
+  private:
+    /*! \brief Tag of the type, set by the subclass constructor. */
+    TypeTag m_typeTag;
   };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "MetadataIndex.h"
+#include "Device.h"
+
+namespace Lumiverse {
+
+void MetadataIndex::update(Device* device) {
+  map<string, string> metadata;
+  for (const auto& key : device->getMetadataKeyNames()) {
+    device->getMetadata(key, metadata[key]);
+  }
+
+  lock_guard<mutex> lock(m_lock);
+  removeLocked(device->getHandle());
+
+  for (const auto& kv : metadata) {
+    m_index[kv.first][kv.second].insert(device->getHandle());
+  }
+
+  m_indexed[device->getHandle()] = metadata;
+}
+
+void MetadataIndex::remove(DeviceHandle device) {
+  lock_guard<mutex> lock(m_lock);
+  removeLocked(device);
+}
+
+void MetadataIndex::clear() {
+  lock_guard<mutex> lock(m_lock);
+  m_index.clear();
+  m_indexed.clear();
+}
+
+void MetadataIndex::removeLocked(DeviceHandle device) {
+  auto indexed = m_indexed.find(device);
+  if (indexed == m_indexed.end())
+    return;
+
+  for (const auto& kv : indexed->second) {
+    auto& values = m_index[kv.first];
+    auto& devices = values[kv.second];
+    devices.erase(device);
+
+    // Drop empty entries so lookups don't have to skip them.
+    if (devices.empty())
+      values.erase(kv.second);
+    if (values.empty())
+      m_index.erase(kv.first);
+  }
+
+  m_indexed.erase(indexed);
+}
+
+void MetadataIndex::find(const string& key, const string& value, bool prefix, bool isEqual, vector<DeviceHandle>& devices) {
+  lock_guard<mutex> lock(m_lock);
+
+  auto values = m_index.find(key);
+  if (values == m_index.end())
+    return;
+
+  if (isEqual && !prefix) {
+    auto it = values->second.find(value);
+    if (it != values->second.end())
+      devices.insert(devices.end(), it->second.begin(), it->second.end());
+  }
+  else if (isEqual) {
+    // Everything starting with value sorts right after it.
+    for (auto it = values->second.lower_bound(value);
+      it != values->second.end() && it->first.compare(0, value.size(), value) == 0; it++) {
+      if (matches(it->first, value, prefix))
+        devices.insert(devices.end(), it->second.begin(), it->second.end());
+    }
+  }
+  else {
+    for (const auto& v : values->second) {
+      if (!matches(v.first, value, prefix))
+        devices.insert(devices.end(), v.second.begin(), v.second.end());
+    }
+  }
+}
+
+bool MetadataIndex::matches(const string& data, const string& value, bool prefix) {
+  if (!prefix)
+    return data == value;
+
+  // The regex for a prefix is "^value.*", and . doesn't match line breaks.
+  return data.compare(0, value.size(), value) == 0 &&
+    data.find_first_of("\r\n", value.size()) == string::npos;
+}
+
+bool MetadataIndex::isLiteral(const string& value) {
+  return value.find_first_of("\\^$.|?*+()[]{}") == string::npos;
+}
+
+}
@@ -0,0 +1,101 @@
+/*! \file MetadataIndex.h
+* \brief Lookup from metadata values to the devices that have them.
+*/
+#ifndef _METADATAINDEX_H_
+#define _METADATAINDEX_H_
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+
+#include "Interner.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  class Device;
+
+  /*!
+  * \brief Inverted index of device metadata.
+  *
+  * Maps each metadata key to its values, and each value to the handles of the
+  * devices that have it. Values are kept sorted so that prefix lookups are a
+  * range scan. The Rig keeps one of these up to date through the devices'
+  * metadata callbacks, and DeviceSet uses it for `$key=value` and
+  * `$key^=value` selectors instead of matching every device.
+  *
+  * Devices can change their metadata from any thread, so everything locks.
+  * \sa Rig, DeviceSet::select()
+  */
+  class MetadataIndex
+  {
+  public:
+    /*! \brief Makes an empty index. */
+    MetadataIndex() { }
+
+    /*!
+    * \brief Replaces the entries of a device with its current metadata.
+    * \param device Device to index.
+    */
+    void update(Device* device);
+
+    /*!
+    * \brief Removes all entries of a device.
+    * \param device Handle of the device.
+    */
+    void remove(DeviceHandle device);
+
+    /*! \brief Removes everything from the index. */
+    void clear();
+
+    /*!
+    * \brief Finds the devices with a value for key that does or doesn't match value.
+    *
+    * Matching is the same as the `std::regex` the selector would otherwise
+    * use, with value taken literally. Devices without the key are never
+    * returned.
+    * \param key Metadata key.
+    * \param value Value to look for.
+    * \param prefix If true, values starting with value match. Otherwise only
+    * equal values do.
+    * \param isEqual If false, the devices whose value doesn't match are returned instead.
+    * \param[out] devices Handles are appended to this.
+    */
+    void find(const string& key, const string& value, bool prefix, bool isEqual, vector<DeviceHandle>& devices);
+
+    /*!
+    * \brief Matches one metadata value the way find() does.
+    * \param data Metadata value of a device.
+    * \param value Value to look for.
+    * \param prefix If true, checks that data starts with value instead of being equal to it.
+    */
+    static bool matches(const string& data, const string& value, bool prefix);
+
+    /*!
+    * \brief Checks if a selector value can be looked up in the index.
+    *
+    * Values with regex special characters in them have to be matched as a
+    * regex instead.
+    */
+    static bool isLiteral(const string& value);
+
+  private:
+    /*! \brief Device handles, by value, by key. */
+    map<string, map<string, set<DeviceHandle> > > m_index;
+
+    /*! \brief Metadata each device is indexed under. Used to remove old entries. */
+    unordered_map<DeviceHandle, map<string, string> > m_indexed;
+
+    /*! \brief Protects the index. */
+    mutex m_lock;
+
+    /*! \brief Removes the entries of a device. Caller holds m_lock. */
+    void removeLocked(DeviceHandle device);
+  };
+}
+#endif
@@ -0,0 +1,343 @@
+#include "ParameterStore.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARAMETERSTORE_SSE2
+#endif
+
+namespace Lumiverse {
+
+// Sets or clears bit i of a bitset, growing it as needed.
+static void setBit(vector<uint64_t>& bits, size_t i, bool val) {
+  if (i / 64 >= bits.size()) {
+    if (!val)
+      return;
+
+    bits.resize(i / 64 + 1, 0);
+  }
+
+  if (val)
+    bits[i / 64] |= (uint64_t)1 << (i % 64);
+  else
+    bits[i / 64] &= ~((uint64_t)1 << (i % 64));
+}
+
+static bool getBit(const vector<uint64_t>& bits, size_t i) {
+  return i / 64 < bits.size() && (bits[i / 64] & ((uint64_t)1 << (i % 64))) != 0;
+}
+
+namespace {
+
+// Comparisons for scan(). The negated ones are written as negations so NaNs
+// behave like they do in the LumiverseFloat operators.
+struct Less {
+#ifdef PARAMETERSTORE_SSE2
+  static __m128 cmp(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+#endif
+  static bool cmp(float a, float b) { return a < b; }
+};
+
+struct Greater {
+#ifdef PARAMETERSTORE_SSE2
+  static __m128 cmp(__m128 a, __m128 b) { return _mm_cmpgt_ps(a, b); }
+#endif
+  static bool cmp(float a, float b) { return a > b; }
+};
+
+struct LessEqual {
+#ifdef PARAMETERSTORE_SSE2
+  static __m128 cmp(__m128 a, __m128 b) { return _mm_cmpngt_ps(a, b); }
+#endif
+  static bool cmp(float a, float b) { return !(a > b); }
+};
+
+struct GreaterEqual {
+#ifdef PARAMETERSTORE_SSE2
+  static __m128 cmp(__m128 a, __m128 b) { return _mm_cmpnlt_ps(a, b); }
+#endif
+  static bool cmp(float a, float b) { return !(a < b); }
+};
+
+struct Equal {
+#ifdef PARAMETERSTORE_SSE2
+  static __m128 cmp(__m128 a, __m128 b) { return _mm_cmpeq_ps(a, b); }
+#endif
+  static bool cmp(float a, float b) { return a == b; }
+};
+
+struct NotEqual {
+#ifdef PARAMETERSTORE_SSE2
+  static __m128 cmp(__m128 a, __m128 b) { return _mm_cmpneq_ps(a, b); }
+#endif
+  static bool cmp(float a, float b) { return !(a == b); }
+};
+
+}
+
+// Compares 64 values, returning a bit per value. values is 16 byte aligned.
+template <class Op>
+static uint64_t compareWord(const float* values, float val) {
+  uint64_t mask = 0;
+
+#ifdef PARAMETERSTORE_SSE2
+  __m128 v = _mm_set1_ps(val);
+  for (unsigned int i = 0; i < 64; i += 4) {
+    __m128 x = _mm_load_ps(values + i);
+    mask |= (uint64_t)_mm_movemask_ps(Op::cmp(x, v)) << i;
+  }
+#else
+  for (unsigned int i = 0; i < 64; i++) {
+    mask |= (uint64_t)Op::cmp(values[i], val) << i;
+  }
+#endif
+
+  return mask;
+}
+
+// Runs a comparison over the value columns of one parameter.
+template <class Op>
+static void scanColumn(const vector<unsigned int>& columnBlocks, const vector<uint64_t>& present,
+  const vector<float*>& blocks, float val, bool isEqual, vector<uint64_t>& devices)
+{
+  const unsigned int wordsPerBlock = ParameterStore::BlockSize / 64;
+  devices.assign(present.size(), 0);
+
+  for (size_t r = 0; r < columnBlocks.size(); r++) {
+    // Range without a block (ParameterStore::NoBlock)
+    if (columnBlocks[r] == (unsigned int)-1)
+      continue;
+
+    const float* values = blocks[columnBlocks[r]];
+
+    for (unsigned int w = 0; w < wordsPerBlock; w++) {
+      size_t word = r * wordsPerBlock + w;
+      if (word >= present.size())
+        return;
+
+      // Skip devices that aren't in the store at all.
+      if (present[word] == 0)
+        continue;
+
+      uint64_t mask = compareWord<Op>(values + w * 64, val);
+      devices[word] = present[word] & (isEqual ? mask : ~mask);
+    }
+  }
+}
+
+// Allocates a zeroed block of count values, aligned to ParameterStore::Alignment.
+template <class T>
+static T* allocBlock(size_t count, vector<T*>& allocations) {
+  // new[] doesn't promise more than default alignment, so pad and align by hand.
+  const size_t pad = ParameterStore::Alignment / sizeof(T);
+  T* alloc = new T[count + pad];
+  uintptr_t addr = (uintptr_t)alloc;
+  T* block = (T*)((addr + ParameterStore::Alignment - 1) & ~(uintptr_t)(ParameterStore::Alignment - 1));
+
+  memset(block, 0, count * sizeof(T));
+  allocations.push_back(alloc);
+  return block;
+}
+
+const unsigned int ParameterStore::NoBlock;
+const unsigned int ParameterStore::ColorChannels;
+
+ParameterStore::ParameterStore() {
+  m_numSlots = 0;
+  m_numColorSlots = 0;
+}
+
+ParameterStore::~ParameterStore() {
+  for (auto a : m_allocations) {
+    delete[] a;
+  }
+
+  for (auto a : m_colorAllocations) {
+    delete[] a;
+  }
+}
+
+unsigned int ParameterStore::acquire(ParamHandle param, DeviceHandle device) {
+  lock_guard<mutex> lock(m_lock);
+
+  if (param >= m_columns.size())
+    m_columns.resize(param + 1);
+
+  Column& c = m_columns[param];
+  unsigned int range = device / BlockSize;
+
+  if (range >= c.blocks.size())
+    c.blocks.resize(range + 1, NoBlock);
+
+  if (c.blocks[range] == NoBlock) {
+    m_blocks.push_back(allocBlock<float>(4 * BlockSize, m_allocations));
+    m_blockKeys.push_back(make_pair(param, range * BlockSize));
+    c.blocks[range] = (unsigned int)m_blocks.size() - 1;
+  }
+
+  if (getBit(c.present, device)) {
+    stringstream ss;
+    ss << "Parameter " << getParamName(param) << " of device " << getDeviceName(device) << " is already in the parameter store";
+    Logger::log(ERR, ss.str());
+  }
+  else {
+    setBit(c.present, device, true);
+    m_numSlots++;
+  }
+
+  return c.blocks[range] * BlockSize + device % BlockSize;
+}
+
+void ParameterStore::release(unsigned int slot) {
+  lock_guard<mutex> lock(m_lock);
+
+  float* data = m_blocks[slot / BlockSize] + slot % BlockSize;
+  for (unsigned int col = 0; col < 4; col++) {
+    data[col * BlockSize] = 0;
+  }
+
+  const auto& key = m_blockKeys[slot / BlockSize];
+  setBit(m_columns[key.first].present, key.second + slot % BlockSize, false);
+  m_numSlots--;
+}
+
+float* ParameterStore::getSlot(unsigned int slot) {
+  lock_guard<mutex> lock(m_lock);
+  return m_blocks[slot / BlockSize] + slot % BlockSize;
+}
+
+unsigned int ParameterStore::getNumBlocks() {
+  lock_guard<mutex> lock(m_lock);
+  return (unsigned int)m_blocks.size();
+}
+
+unsigned int ParameterStore::getNumSlots() {
+  lock_guard<mutex> lock(m_lock);
+  return m_numSlots;
+}
+
+unsigned int ParameterStore::acquireColor(ParamHandle param, DeviceHandle device) {
+  lock_guard<mutex> lock(m_lock);
+
+  if (param >= m_columns.size())
+    m_columns.resize(param + 1);
+
+  Column& c = m_columns[param];
+  unsigned int range = device / BlockSize;
+
+  if (range >= c.colorBlocks.size())
+    c.colorBlocks.resize(range + 1, NoBlock);
+
+  if (c.colorBlocks[range] == NoBlock) {
+    m_colorBlocks.push_back(allocBlock<double>(ColorChannels * BlockSize, m_colorAllocations));
+    m_colorBlockKeys.push_back(make_pair(param, range * BlockSize));
+    c.colorBlocks[range] = (unsigned int)m_colorBlocks.size() - 1;
+  }
+
+  if (getBit(c.colorPresent, device)) {
+    stringstream ss;
+    ss << "Color " << getParamName(param) << " of device " << getDeviceName(device) << " is already in the parameter store";
+    Logger::log(ERR, ss.str());
+  }
+  else {
+    setBit(c.colorPresent, device, true);
+    m_numColorSlots++;
+  }
+
+  return c.colorBlocks[range] * BlockSize + device % BlockSize;
+}
+
+void ParameterStore::releaseColor(unsigned int slot) {
+  lock_guard<mutex> lock(m_lock);
+
+  double* data = m_colorBlocks[slot / BlockSize] + slot % BlockSize;
+  for (unsigned int ch = 0; ch < ColorChannels; ch++) {
+    data[ch * BlockSize] = 0;
+  }
+
+  const auto& key = m_colorBlockKeys[slot / BlockSize];
+  setBit(m_columns[key.first].colorPresent, key.second + slot % BlockSize, false);
+  m_numColorSlots--;
+}
+
+double* ParameterStore::getColorSlot(unsigned int slot) {
+  lock_guard<mutex> lock(m_lock);
+  return m_colorBlocks[slot / BlockSize] + slot % BlockSize;
+}
+
+unsigned int ParameterStore::getNumColorBlocks() {
+  lock_guard<mutex> lock(m_lock);
+  return (unsigned int)m_colorBlocks.size();
+}
+
+unsigned int ParameterStore::getNumColorSlots() {
+  lock_guard<mutex> lock(m_lock);
+  return m_numColorSlots;
+}
+
+void ParameterStore::setNonFloat(ParamHandle param, DeviceHandle device, bool nonFloat) {
+  lock_guard<mutex> lock(m_lock);
+
+  if (param >= m_columns.size()) {
+    if (!nonFloat)
+      return;
+
+    m_columns.resize(param + 1);
+  }
+
+  setBit(m_columns[param].nonFloat, device, nonFloat);
+}
+
+bool ParameterStore::scan(ParamHandle param, Comparison op, float val, bool isEqual, vector<uint64_t>& devices) {
+  lock_guard<mutex> lock(m_lock);
+
+  if (param >= m_columns.size()) {
+    devices.clear();
+    return true;
+  }
+
+  const Column& c = m_columns[param];
+
+  switch (op) {
+    case LESS:
+      scanColumn<Less>(c.blocks, c.present, m_blocks, val, isEqual, devices);
+      break;
+    case GREATER:
+      scanColumn<Greater>(c.blocks, c.present, m_blocks, val, isEqual, devices);
+      break;
+    case LESS_EQUAL:
+      scanColumn<LessEqual>(c.blocks, c.present, m_blocks, val, isEqual, devices);
+      break;
+    case GREATER_EQUAL:
+      scanColumn<GreaterEqual>(c.blocks, c.present, m_blocks, val, isEqual, devices);
+      break;
+    case EQUAL:
+      scanColumn<Equal>(c.blocks, c.present, m_blocks, val, isEqual, devices);
+      break;
+    case NOT_EQUAL:
+      scanColumn<NotEqual>(c.blocks, c.present, m_blocks, val, isEqual, devices);
+      break;
+  }
+
+  for (uint64_t word : c.nonFloat) {
+    if (word != 0)
+      return false;
+  }
+
+  return true;
+}
+
+float* ParameterStore::getColumn(unsigned int block, unsigned int col) {
+  lock_guard<mutex> lock(m_lock);
+  return (block < m_blocks.size()) ? m_blocks[block] + col * BlockSize : nullptr;
+}
+
+double* ParameterStore::getChannels(unsigned int block, unsigned int channel) {
+  lock_guard<mutex> lock(m_lock);
+  return (block < m_colorBlocks.size() && channel < ColorChannels) ? m_colorBlocks[block] + channel * BlockSize : nullptr;
+}
+
+}
@@ -0,0 +1,243 @@
+/*! \file ParameterStore.h
+* \brief Column storage for float and color parameters across a whole Rig.
+*/
+#ifndef _PARAMETERSTORE_H_
+#define _PARAMETERSTORE_H_
+
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <utility>
+
+#include "Interner.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Stores the values of many LumiverseFloats in contiguous columns.
+  *
+  * Storage is split into blocks of BlockSize slots. Each block holds four
+  * 64-byte aligned columns back to back: values, defaults, maximums and
+  * minimums. A LumiverseFloat bound to the store (see LumiverseFloat::bind())
+  * reads and writes its slot instead of its own members, so code that walks
+  * a column touches every float parameter in the rig without chasing
+  * pointers.
+  *
+  * Every block belongs to one parameter and covers BlockSize consecutive
+  * device handles, so a value column holds the same parameter of
+  * neighbouring devices. scan() compares a parameter of every device this
+  * way.
+  *
+  * Colors are kept the same way in blocks of their own: ColorChannels
+  * columns of doubles, one per channel index of the color's ColorLayout
+  * (see LumiverseColor::bind()). Channel c of every bound color of a
+  * parameter sits in column c, next to the same channel of neighbouring
+  * devices.
+  *
+  * Blocks never move once allocated, so slot pointers stay valid until the
+  * slot is released.
+  * \sa Rig::setParameterStore(), Device::bindStore()
+  */
+  class ParameterStore
+  {
+  public:
+    /*! \brief Number of slots in each block. */
+    static const unsigned int BlockSize = 1024;
+
+    /*! \brief Byte alignment of each column. */
+    static const unsigned int Alignment = 64;
+
+    /*! \brief Number of channel columns in each color block. Same as ColorLayout::MaxChannels. */
+    static const unsigned int ColorChannels = 16;
+
+    /*!
+    * \brief Comparisons scan() can do, with the parameter on the left.
+    *
+    * Same results as the LumiverseFloat operators, NaNs included.
+    */
+    enum Comparison {
+      LESS,
+      GREATER,
+      LESS_EQUAL,
+      GREATER_EQUAL,
+      EQUAL,
+      NOT_EQUAL
+    };
+
+    /*! \brief Creates an empty store. */
+    ParameterStore();
+
+    /*!
+    * \brief Frees all blocks.
+    *
+    * Every float bound to the store must be unbound first.
+    */
+    ~ParameterStore();
+
+    /*!
+    * \brief Reserves the slot of a parameter of a device.
+    * \param param Parameter handle.
+    * \param device Device handle.
+    * \return Index of the slot. Its columns are zeroed.
+    */
+    unsigned int acquire(ParamHandle param, DeviceHandle device);
+
+    /*!
+    * \brief Returns a slot to the store for reuse.
+    * \param slot Slot from acquire().
+    */
+    void release(unsigned int slot);
+
+    /*!
+    * \brief Gets a pointer to the value of a slot.
+    *
+    * The default, maximum and minimum follow at offsets of 1, 2 and 3 times
+    * BlockSize.
+    */
+    float* getSlot(unsigned int slot);
+
+    /*! \brief Gets the number of allocated blocks. */
+    unsigned int getNumBlocks();
+
+    /*! \brief Gets the number of slots in use. */
+    unsigned int getNumSlots();
+
+    /*!
+    * \brief Reserves the color slot of a parameter of a device.
+    * \param param Parameter handle.
+    * \param device Device handle.
+    * \return Index of the slot. Its channels are zeroed.
+    */
+    unsigned int acquireColor(ParamHandle param, DeviceHandle device);
+
+    /*!
+    * \brief Returns a color slot to the store for reuse.
+    * \param slot Slot from acquireColor().
+    */
+    void releaseColor(unsigned int slot);
+
+    /*!
+    * \brief Gets a pointer to channel 0 of a color slot.
+    *
+    * Channel c follows at an offset of c times BlockSize.
+    */
+    double* getColorSlot(unsigned int slot);
+
+    /*! \brief Gets the number of allocated color blocks. */
+    unsigned int getNumColorBlocks();
+
+    /*! \brief Gets the number of color slots in use. */
+    unsigned int getNumColorSlots();
+
+    /*!
+    * \brief Records whether a device has a parameter that isn't a float.
+    *
+    * Those parameters can't be in the store, so scan() has to tell its
+    * caller about them.
+    * \param param Parameter handle.
+    * \param device Device handle.
+    * \param nonFloat True if the device has a non-float parameter with this handle.
+    */
+    void setNonFloat(ParamHandle param, DeviceHandle device, bool nonFloat);
+
+    /*!
+    * \brief Compares a parameter of every device in the store against a value.
+    *
+    * Walks the parameter's value columns 64 devices at a time, with SSE2 where
+    * the compiler has it.
+    * \param param Parameter to compare.
+    * \param op Comparison.
+    * \param val Value to compare against.
+    * \param isEqual If false, the devices where the comparison is false are returned instead.
+    * \param[out] devices Set to a bitset of the devices that have the parameter
+    * and matched. Bit `h % 64` of word `h / 64` is the device with handle h.
+    * \return False if some device has a non-float parameter with this handle,
+    * which isn't in devices.
+    */
+    bool scan(ParamHandle param, Comparison op, float val, bool isEqual, vector<uint64_t>& devices);
+
+    /*!
+    * \brief Gets the value column of a block.
+    *
+    * BlockSize entries long. Released and never used slots hold 0.
+    */
+    float* getValues(unsigned int block) { return getColumn(block, 0); }
+
+    /*! \brief Gets the default value column of a block. */
+    float* getDefaults(unsigned int block) { return getColumn(block, 1); }
+
+    /*! \brief Gets the maximum value column of a block. */
+    float* getMaxs(unsigned int block) { return getColumn(block, 2); }
+
+    /*! \brief Gets the minimum value column of a block. */
+    float* getMins(unsigned int block) { return getColumn(block, 3); }
+
+    /*!
+    * \brief Gets a channel column of a color block.
+    *
+    * BlockSize entries long. Released and never used slots hold 0.
+    * \param block Color block.
+    * \param channel Channel index, less than ColorChannels.
+    */
+    double* getChannels(unsigned int block, unsigned int channel);
+
+  private:
+    /*! \brief Gets column `col` of a block. */
+    float* getColumn(unsigned int block, unsigned int col);
+
+    /*! \brief Blocks and devices of one parameter. */
+    struct Column {
+      /*! \brief Block for each range of BlockSize device handles. NoBlock if not allocated. */
+      vector<unsigned int> blocks;
+
+      /*! \brief Bitset of the devices with a slot. */
+      vector<uint64_t> present;
+
+      /*! \brief Bitset of the devices with a non-float parameter of this handle. */
+      vector<uint64_t> nonFloat;
+
+      /*! \brief Color block for each range of BlockSize device handles. NoBlock if not allocated. */
+      vector<unsigned int> colorBlocks;
+
+      /*! \brief Bitset of the devices with a color slot. */
+      vector<uint64_t> colorPresent;
+    };
+
+    /*! \brief Marks a range of device handles without a block. */
+    static const unsigned int NoBlock = (unsigned int)-1;
+
+    /*! \brief Columns, by parameter handle. */
+    vector<Column> m_columns;
+
+    /*! \brief Aligned start of each block. */
+    vector<float*> m_blocks;
+
+    /*! \brief Allocations backing m_blocks, for delete[]. */
+    vector<float*> m_allocations;
+
+    /*! \brief Parameter and first device handle of each block. */
+    vector<pair<ParamHandle, DeviceHandle> > m_blockKeys;
+
+    /*! \brief Number of slots in use. */
+    unsigned int m_numSlots;
+
+    /*! \brief Aligned start of each color block. */
+    vector<double*> m_colorBlocks;
+
+    /*! \brief Allocations backing m_colorBlocks, for delete[]. */
+    vector<double*> m_colorAllocations;
+
+    /*! \brief Parameter and first device handle of each color block. */
+    vector<pair<ParamHandle, DeviceHandle> > m_colorBlockKeys;
+
+    /*! \brief Number of color slots in use. */
+    unsigned int m_numColorSlots;
+
+    /*! \brief Protects the store. */
+    mutex m_lock;
+  };
+}
+#endif
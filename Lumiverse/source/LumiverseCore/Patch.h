@@ -38,6 +38,20 @@ namespace Lumiverse {
     */
     virtual void update(set<Device *> devices) = 0;
 
+    /*!
+    * \brief Updates the patch knowing which Devices changed since the last update.
+    *
+    * The Rig calls this instead of update(), passing a snapshot of the device
+    * state taken at the start of the frame. Patches should treat the devices
+    * as read-only. Patches that keep their output
+    * state between frames can override it to only process the Devices in
+    * `changed`. The default implementation ignores `changed` and calls update().
+    * \param devices All Devices in the Rig.
+    * \param changed Devices that changed since the previous call.
+    * \sa Device::getGeneration()
+    */
+    virtual void updateChanged(const set<Device *>& devices, const set<Device *>& /*changed*/) { update(devices); }
+
     /*!
     * \brief Initializes settings for the patch.
     *
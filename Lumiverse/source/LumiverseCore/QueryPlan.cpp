@@ -0,0 +1,305 @@
+#include "QueryPlan.h"
+#include "Logger.h"
+#include "MetadataIndex.h"
+#include "Device.h"
+
+#include <sstream>
+
+namespace Lumiverse {
+
+QueryPlan::QueryPlan(string selector) : m_selector(selector) {
+  // First step is to split the entire string into groups.
+  vector<string> groups;
+
+  size_t lbracket = selector.find('[', 0);
+  size_t rbracket;
+
+  // If we're not starting with a bracket, that's ok just treat everything before a bracket as a group.
+  if (lbracket != 0) {
+    groups.push_back(selector.substr(0, lbracket));
+  }
+
+  while (lbracket != string::npos) {
+    rbracket = selector.find(']', lbracket);
+
+    if (rbracket == string::npos) {
+      stringstream ss;
+      ss << "Selector parse error: no matching ] for [ in " << selector << " (" << lbracket << ")";
+      Logger::log(LOG_LEVEL::ERR, ss.str());
+    }
+
+    groups.push_back(selector.substr(lbracket + 1, rbracket - lbracket - 1));
+    lbracket = selector.find('[', rbracket);
+  }
+
+  // Then split each group into selectors.
+  for (string& s : groups) {
+    size_t start = 0;
+    size_t end = 0;
+    vector<Step> steps;
+
+    while (start != string::npos) {
+      bool orNext = false;
+
+      // Skip whitespace
+      while (s[start] == ' ' || s[start] == '\n' || s[start] == '\t') {
+        start++;
+      }
+
+      end = s.find(',', start);
+
+      size_t bar = s.find('|', start);
+      if (bar < end) {
+        end = bar;
+        orNext = true;
+      }
+
+      Step step = compileSelector(s.substr(start, end - start));
+      step.orNext = orNext;
+      steps.push_back(step);
+
+      start = (end == string::npos) ? end : end + 1;
+    }
+
+    m_groups.push_back(steps);
+  }
+}
+
+bool QueryPlan::matches(Device* device) const {
+  // Every selector decides each device on its own, so running the steps of
+  // DeviceSet::select() on just this device gives the same answer.
+  bool in = false;
+  bool filter = false;
+
+  for (const auto& group : m_groups) {
+    // select() doesn't clear or'd results until the end of the group either.
+    bool orResults = false;
+
+    for (const auto& step : group) {
+      bool temp = stepMatches(step, device, filter, in);
+
+      if (step.orNext)
+        orResults = orResults || temp;
+      else
+        in = temp || orResults;
+    }
+
+    filter = true;
+  }
+
+  return in;
+}
+
+bool QueryPlan::stepMatches(const Step& step, Device* device, bool filter, bool in) {
+  switch (step.type) {
+    case ID: {
+      // Filtering by id removes the device.
+      bool hit = (device->getId() == step.name);
+      return (filter) ? in && !hit : in || hit;
+    }
+    case CHANNEL: {
+      // Inverted ranges are [0, first - 1] and [last + 1, max channel], with
+      // the same unsigned wrap around as DeviceSet::runStep().
+      unsigned int channel = device->getChannel();
+      bool hit = (step.eq) ? (channel >= step.first && channel <= step.last) :
+        (channel <= step.first - 1 || channel >= step.last + 1);
+
+      return (filter) ? in && !hit : in || hit;
+    }
+    case PARAMETER: {
+      LumiverseType* data = device->readParam(step.name);
+      if (data == nullptr)
+        return (filter) ? false : in;
+
+      LumiverseFloat val(step.val);
+      LumiverseFloat& a = *(LumiverseFloat*)data;
+      bool cmp;
+
+      if (step.op == "<")
+        cmp = a < val;
+      else if (step.op == ">")
+        cmp = a > val;
+      else if (step.op == "<=")
+        cmp = a <= val;
+      else if (step.op == ">=")
+        cmp = a >= val;
+      else if (step.op == "!=")
+        cmp = a != val;
+      else
+        cmp = a == val;
+
+      // The filter removes the devices that compare equal to eq.
+      return (filter) ? in && cmp != step.eq : in || cmp == step.eq;
+    }
+    case METADATA: {
+      string data;
+      if (!device->getMetadata(step.name, data))
+        return (filter) ? false : in;
+
+      bool match;
+      if (step.metadataMatch == REGEX)
+        match = regex_match(data, step.pattern);
+      else
+        match = MetadataIndex::matches(data, step.metadataValue, step.metadataMatch == PREFIX);
+
+      return (filter) ? in && match == step.eq : in || match == step.eq;
+    }
+    default:
+      return in;
+  }
+}
+
+QueryPlan::Step QueryPlan::compileSelector(const string& selector) {
+  // first check for !
+  char type = (selector[0] == '!') ? selector[1] : selector[0];
+
+  switch (type) {
+    case '#':
+      return compileChannelSelector(selector);
+    case '@':
+      return compileParameterSelector(selector);
+    case '$':
+      return compileMetadataSelector(selector);
+    // Everything else is an ID
+    default: {
+      Step step;
+      step.type = ID;
+      step.eq = true;
+      step.name = selector;
+      return step;
+    }
+  }
+}
+
+QueryPlan::Step QueryPlan::compileMetadataSelector(const string& selector) {
+  Step step;
+
+  regex metadataRegex("(!\?)\\$([\\w\\d\\-]+)([\\!\\*~\\$\\^]?[=])(.+)");
+  smatch matches;
+
+  // Matches size is 5 since entire string is the first match
+  if (!regex_match(selector, matches, metadataRegex) || matches.size() != 5) {
+    stringstream ss;
+    ss << "Selector parse error: invalid metadata selector format: " << selector;
+    Logger::log(LOG_LEVEL::ERR, ss.str());
+
+    step.type = INVALID;
+    return step;
+  }
+
+  string invert = matches[1];
+  string op = matches[3];
+  string arg = matches[4];
+
+  step.type = METADATA;
+  step.eq = (invert.size() > 0) ? false : true;
+  step.name = matches[2];
+
+  // Equality and prefix of plain values can come straight from the index.
+  bool literal = MetadataIndex::isLiteral(arg);
+  if (literal)
+    step.metadataValue = arg;
+
+  switch (op[0]) {
+    // Contains
+    case '*':
+      step.pattern = regex(".*" + arg + ".*");
+      break;
+    // Ends with
+    case '$':
+      step.pattern = regex(".*" + arg + "$");
+      break;
+    // Starts with
+    case '^':
+      step.pattern = regex("^" + arg + ".*");
+      if (literal)
+        step.metadataMatch = PREFIX;
+      break;
+    // Not equal to
+    case '!':
+      step.eq = !step.eq;
+      step.pattern = regex(arg);
+      if (literal)
+        step.metadataMatch = EXACT;
+      break;
+    // Exactly equal to
+    case '=':
+      // Anything else is same as =
+    default:
+      step.pattern = regex("^" + arg + "$");
+      if (literal)
+        step.metadataMatch = EXACT;
+      break;
+  }
+
+  return step;
+}
+
+QueryPlan::Step QueryPlan::compileChannelSelector(const string& selector) {
+  Step step;
+
+  regex channelRegex("(!\?)#(\\d+)-\?(\\d*)");
+  smatch matches;
+
+  // Matches size is 4 since entire string is the first match
+  if (!regex_match(selector, matches, channelRegex) || matches.size() != 4) {
+    stringstream ss;
+    ss << "Selector parse error: invalid channel selector format: " << selector;
+    Logger::log(LOG_LEVEL::ERR, ss.str());
+
+    step.type = INVALID;
+    return step;
+  }
+
+  string invert = matches[1];
+  string secondStr = matches[3];
+
+  step.type = CHANNEL;
+  step.eq = (invert.size() > 0) ? false : true;
+
+  stringstream(matches[2]) >> step.first;
+  step.last = step.first;
+
+  if (secondStr.size() > 0) {
+    stringstream(secondStr) >> step.last;
+
+    if (step.first > step.last) {
+      // Flip channel ranges if the first value is greater than the second value
+      unsigned int tmp = step.first;
+      step.first = step.last;
+      step.last = tmp;
+    }
+  }
+
+  return step;
+}
+
+QueryPlan::Step QueryPlan::compileParameterSelector(const string& selector) {
+  Step step;
+
+  // Supported Types: LumiverseFloat
+  regex paramRegex("(!\?)@(\\w+)([><!]\?[><=])(\\d*\\.\?\\d*)([f])");
+  smatch matches;
+
+  // Matches size is 6 since entire string is the first match
+  if (!regex_match(selector, matches, paramRegex) || matches.size() != 6) {
+    stringstream ss;
+    ss << "Selector parse error: invalid parameter selector format: " << selector;
+    Logger::log(LOG_LEVEL::ERR, ss.str());
+
+    step.type = INVALID;
+    return step;
+  }
+
+  string invert = matches[1];
+
+  step.type = PARAMETER;
+  step.eq = (invert.size() > 0) ? false : true;
+  step.name = matches[2];
+  step.op = matches[3];
+  stringstream(matches[4]) >> step.val;
+
+  return step;
+}
+
+}
@@ -0,0 +1,145 @@
+/*! \file QueryPlan.h
+* \brief Query strings compiled into a reusable form.
+*/
+#ifndef _QUERYPLAN_H_
+#define _QUERYPLAN_H_
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <regex>
+#include <memory>
+
+using namespace std;
+
+namespace Lumiverse {
+  class Device;
+
+  /*!
+  * \brief A query string parsed once, ready to run against a DeviceSet any number of times.
+  *
+  * All of the string splitting and regex matching of the query syntax happens
+  * in the constructor, and metadata patterns are built into `std::regex`
+  * objects once. Running the plan with DeviceSet::select(const QueryPlan&)
+  * then only does the set operations. Plans don't refer to any Rig and never
+  * change after construction, so one plan can be shared between threads.
+  * \sa DeviceSet::select(), Rig::query(), Rig::getQueryPlan()
+  */
+  class QueryPlan
+  {
+  public:
+    /*! \brief Kinds of selector. */
+    enum StepType {
+      ID,         /*!< A device id */
+      CHANNEL,    /*!< `#channel` or `#first-last` */
+      PARAMETER,  /*!< `@param<op>value` */
+      METADATA,   /*!< `$key<op>=value` */
+      INVALID     /*!< Didn't parse. Leaves the set as it is. */
+    };
+
+    /*! \brief How a METADATA step can be answered. */
+    enum MetadataMatch {
+      REGEX,      /*!< Only by matching pattern against every device */
+      EXACT,      /*!< Value equal to metadataValue, from the Rig's MetadataIndex */
+      PREFIX      /*!< Value starting with metadataValue, from the Rig's MetadataIndex */
+    };
+
+    /*! \brief One selector of a query. */
+    struct Step {
+      Step() : type(INVALID), eq(true), orNext(false), first(0), last(0), val(0), metadataMatch(REGEX) { }
+
+      StepType type;
+
+      /*! \brief False if the selector is inverted with `!`. */
+      bool eq;
+
+      /*! \brief True if the selector was followed by `|`, so its result is or'd with the next ones. */
+      bool orNext;
+
+      /*! \brief Device id, parameter name or metadata key. */
+      string name;
+
+      /*! \brief First channel for CHANNEL. */
+      unsigned int first;
+
+      /*! \brief Last channel for CHANNEL. Same as first if it isn't a range. */
+      unsigned int last;
+
+      /*! \brief Comparison for PARAMETER. One of <, >, <=, >=, !=, anything else means ==. */
+      string op;
+
+      /*! \brief Value to compare to for PARAMETER. */
+      float val;
+
+      /*! \brief Pattern to match metadata values against for METADATA. */
+      regex pattern;
+
+      /*! \brief Whether METADATA can use the index instead of pattern. */
+      MetadataMatch metadataMatch;
+
+      /*! \brief Value to look up for EXACT and PREFIX METADATA steps. */
+      string metadataValue;
+    };
+
+    /*!
+    * \brief Compiles a query string.
+    *
+    * Syntax errors are logged and the offending selectors become INVALID steps.
+    * \param selector Query string, as for DeviceSet::select().
+    */
+    QueryPlan(string selector);
+
+    /*! \brief Gets the query string the plan was compiled from. */
+    const string& getSelector() const { return m_selector; }
+
+    /*!
+    * \brief Gets the bracketed groups of the query.
+    *
+    * The first group adds devices to the set, every following group filters the set.
+    */
+    const vector<vector<Step> >& getGroups() const { return m_groups; }
+
+    /*!
+    * \brief Checks if a device would be in the result of the query.
+    *
+    * Same answer as running the plan with DeviceSet::select() on the device's
+    * Rig and looking for the device, but only looks at the one device.
+    * \param device Device to check.
+    * \sa LiveView
+    */
+    bool matches(Device* device) const;
+
+  private:
+    /*!
+    * \brief Runs a single step on a single device.
+    *
+    * Mirrors DeviceSet::runStep() for one device.
+    * \param step Selector to run.
+    * \param device Device to check.
+    * \param filter True if the step filters the set instead of adding to it.
+    * \param in True if the device was in the set before the step.
+    * \return True if the device is in the set after the step.
+    */
+    static bool stepMatches(const Step& step, Device* device, bool filter, bool in);
+
+    /*! \brief Parses a single selector. */
+    static Step compileSelector(const string& selector);
+
+    /*! \brief Parses a `$` selector. */
+    static Step compileMetadataSelector(const string& selector);
+
+    /*! \brief Parses a `#` selector. */
+    static Step compileChannelSelector(const string& selector);
+
+    /*! \brief Parses a `@` selector. */
+    static Step compileParameterSelector(const string& selector);
+
+    /*! \brief Query string. */
+    string m_selector;
+
+    /*! \brief Selectors, by group. */
+    vector<vector<Step> > m_groups;
+  };
+}
+#endif
@@ -1,24 +1,50 @@
 #include "Rig.h"
+#include "LiveView.h"
+#include "types/LumiverseOrientation.h"
+
+#include <limits>
 
 namespace Lumiverse {
 
 Rig::Rig() {
   m_running = false;
   setRefreshRate(40);
+  m_spinTime = chrono::microseconds(0);
+  m_overrunPolicy = OVERRUN_SKIP;
+  m_parallelPatches = true;
+  m_changesQueued = 0;
+  m_nextChangeCallbackId = 0;
+  m_queryCacheSize = 128;
+  m_changesApplied = 0;
   m_updateLoop = nullptr;
+  shared_ptr<Tables> tables = make_shared<Tables>();
+  tables->release = make_shared<Release>();
+  m_tables = tables;
+  m_tablesDirty = false;
 }
 
 Rig::Rig(string filename) {
   m_running = false;
   setRefreshRate(40);
+  m_spinTime = chrono::microseconds(0);
+  m_overrunPolicy = OVERRUN_SKIP;
+  m_parallelPatches = true;
+  m_changesQueued = 0;
+  m_nextChangeCallbackId = 0;
+  m_queryCacheSize = 128;
+  m_changesApplied = 0;
   m_updateLoop = nullptr;
+  shared_ptr<Tables> tables = make_shared<Tables>();
+  tables->release = make_shared<Release>();
+  m_tables = tables;
+  m_tablesDirty = false;
 
   if (!load(filename)) {
     Logger::log(WARN, "Proceeding with default rig initialization");
   }
 }
 
-void Rig::loadJSON(JSONNode root) {
+void Rig::loadJSON(const JSONNode& root) {
   JSONNode::const_iterator i = root.begin();
 
   auto version = root.find("version");
@@ -69,9 +95,12 @@ void Rig::loadJSON(JSONNode root) {
   }
 }
 
-void Rig::loadDevices(JSONNode root) {
+void Rig::loadDevices(const JSONNode& root) {
   JSONNode::const_iterator i = root.begin();
 
+  // All the devices go in as one change, so the tables are copied once.
+  vector<Device*> devices;
+
   // for this we want to iterate through all children and have the device class
   // parse the sub-element.
   while (i != root.end()){
@@ -79,15 +108,24 @@ void Rig::loadDevices(JSONNode root) {
     std::string nodeName = i->name();
 
     // Node name is the Device id
-    Device* device = new Device(nodeName, *i);
-    addDevice(device);
+    devices.push_back(new Device(nodeName, *i));
 
     //increment the iterator
     ++i;
   }
+
+  queueChange([this, devices]() {
+    for (auto d : devices) {
+      addDeviceNow(d);
+    }
+  });
+
+  stringstream ss;
+  ss << "Loaded " << root.size() << " Devices";
+  Logger::log(INFO, ss.str());
 }
 
-void Rig::loadPatches(JSONNode root) {
+void Rig::loadPatches(const JSONNode& root) {
   JSONNode::const_iterator i = root.begin();
 
   // for this we want to iterate through all children and have the device class
@@ -120,25 +158,12 @@ void Rig::loadPatches(JSONNode root) {
     else if (patchType == "ArnoldAnimationPatch") {
       patch = (Patch*) new ArnoldAnimationPatch(*i);
       addPatch(nodeName, patch);
-      Device::DeviceCallbackFunction callback = std::bind(&ArnoldAnimationPatch::onDeviceChanged,
-                                                            (ArnoldAnimationPatch*)patch,
-                                                            std::placeholders::_1);
-      for (Device *d : getDeviceRaw()) {
-          d->addParameterChangedCallback(callback);
-          d->addMetadataChangedCallback(callback);
-      }
+      addArnoldChangeCallback(nodeName);
     }
     else if (patchType == "ArnoldPatch") {
       patch = (Patch*) new ArnoldPatch(*i);
       addPatch(nodeName, patch);
-        
-        Device::DeviceCallbackFunction callback = std::bind(&ArnoldPatch::onDeviceChanged,
-                                                            (ArnoldPatch*)patch,
-                                                            std::placeholders::_1);
-        for (Device *d : getDeviceRaw()) {
-            d->addParameterChangedCallback(callback);
-            d->addMetadataChangedCallback(callback);
-        }
+      addArnoldChangeCallback(nodeName);
     }
 #endif
     else {
@@ -152,59 +177,128 @@ void Rig::loadPatches(JSONNode root) {
   }
 }
 
+#ifdef USE_ARNOLD
+void Rig::addArnoldChangeCallback(string id) {
+  // Looks the patch up every frame instead of holding on to it, so nothing
+  // breaks if the patch is deleted or replaced.
+  addChangeCallback([this, id](const ChangeSet& changes) {
+    shared_ptr<const Tables> tables = getTables();
+    auto p = tables->patches.find(id);
+    if (p == tables->patches.end())
+      return;
+
+    string type = p->second->getType();
+    if (type != "ArnoldPatch" && type != "ArnoldAnimationPatch")
+      return;
+
+    ArnoldPatch* patch = (ArnoldPatch*)p->second;
+    for (DeviceHandle h : changes.devices) {
+      Device* d = tables->getDevice(h);
+      if (d != nullptr)
+        patch->onDeviceChanged(d);
+    }
+  });
+}
+#endif
+
 void Rig::reset() {
   stop();
 
-  // Delete Devices
-  for (auto& d : m_devices) {
-    delete d;
+  lock_guard<recursive_mutex> apply(m_applyLock);
+  Tables& tables = editTables();
+
+  // Delete Devices, once no one can find them
+  for (auto& d : tables.devices) {
+    Device* device = d;
+    retireWithTables([device]() { delete device; });
+  }
+
+  // Delete the frame snapshots
+  for (auto& s : m_frontBuffer) {
+    delete s.second;
   }
 
   // Delete Patches
-  for (auto& p : m_patches) {
-    delete p.second;
+  for (auto& p : tables.patches) {
+    Patch* patch = p.second;
+    retireWithTables([patch]() { delete patch; });
   }
 
-  m_devices.clear();
-  m_patches.clear();
-  m_devicesById.clear();
-  m_devicesByChannel.clear();
+  tables.devices.clear();
+  tables.patches.clear();
+  tables.devicesById.clear();
+  tables.devicesByHandle.clear();
+  tables.devicesByChannel.clear();
+  publishTables();
+
+  m_metadataIndex.clear();
+  m_metadataCallbacks.clear();
+
+  for (auto& v : m_views) {
+    shared_ptr<LiveView> view = v.lock();
+    if (view)
+      view->clear();
+  }
+  m_seenGenerations.clear();
+  m_frontBuffer.clear();
+  m_frontDevices.clear();
   m_updateFunctions.clear();
+  {
+    lock_guard<mutex> lock(m_timingLock);
+    m_functionTimings.clear();
+    m_patchTimings.clear();
+  }
+  m_frameTiming.reset();
 }
 
 Rig::~Rig() {
-  // Stop the update thread.
-  stop();
-
-  if (m_updateLoop != nullptr)
-    delete m_updateLoop;
-  
-  // Delete Devices
-  for (auto& d : m_devices) {
-    delete d;
-  }
+  // Stops the update thread and empties the rig.
+  reset();
 
-  // Delete Patches
-  for (auto& p : m_patches) {
-    delete p.second;
-  }
+  // Frees the devices and patches along with the old tables.
+  collectRetired();
 }
 
 void Rig::init() {
-  for (auto& p : m_patches) {
+  shared_ptr<const Tables> tables = getTables();
+  for (auto& p : tables->patches) {
     p.second->init();
   }
 }
 
 void Rig::run() {
+  if (m_running)
+    return;
+
+  if (m_parallelPatches) {
+    // The update thread works on the patches too.
+    unsigned int cores = thread::hardware_concurrency();
+    m_patchPool = unique_ptr<WorkerPool>(new WorkerPool((cores > 1) ? cores - 1 : 0));
+  }
+
   m_running = true;
   m_updateLoop = new thread(&Rig::update, this);
 }
 
 void Rig::stop() {
   if (m_running) {
-    m_running = false;
+    {
+      lock_guard<mutex> lock(m_changeLock);
+      m_running = false;
+    }
     m_updateLoop->join();
+    delete m_updateLoop;
+    m_updateLoop = nullptr;
+    m_patchPool.reset();
+
+    {
+      lock_guard<mutex> lock(m_changeLock);
+      m_updateThreadId = thread::id();
+    }
+
+    // Anything queued after the last frame still has to go in.
+    applyPendingChanges();
+    collectRetired();
   }
 }
 
@@ -234,11 +328,48 @@ bool Rig::load(string filename) {
     // It's not guaranteed that the following memory after memblock is blank.
     // C-style string needs an end.
     memblock[size] = '\0';
-      
-    JSONNode n = libjson::parse(memblock);
 
-    // This could get to be a large function, so let's break off into a helper.
-    loadJSON(n);
+    // Large rigs are mostly devices, so those get split out and built in
+    // parallel. Everything else is small and goes through loadJSON as usual.
+    vector<RigLoader::Member> members;
+    vector<RigLoader::Member> deviceMembers;
+    bool fast = RigLoader::split(memblock, memblock + size, members);
+
+    string rest = "{";
+    for (size_t i = 0; fast && i < members.size(); i++) {
+      if (members[i].name == "devices") {
+        fast = RigLoader::split(members[i].begin, members[i].end, deviceMembers);
+        continue;
+      }
+
+      if (rest.size() > 1)
+        rest += ",";
+      rest += "\"" + members[i].name + "\":" + string(members[i].begin, members[i].end);
+    }
+    rest += "}";
+
+    if (fast) {
+      vector<Device*> devices = RigLoader::loadDevices(deviceMembers);
+      queueChange([this, devices]() {
+        for (auto d : devices) {
+          if (d != nullptr)
+            addDeviceNow(d);
+        }
+      });
+
+      stringstream ss;
+      ss << "Loaded " << devices.size() << " Devices";
+      Logger::log(INFO, ss.str());
+
+      // The devices are loaded, so loadJSON sees a file without them.
+      loadJSON(libjson::parse(rest));
+    }
+    else {
+      // Something the scanner doesn't handle. Parse the whole thing.
+      loadJSON(libjson::parse(memblock));
+    }
+
+    delete[] memblock;
 
     return true;
   }
@@ -252,13 +383,14 @@ bool Rig::load(string filename) {
 }
 
 void Rig::addDevice(Device* device) {
-  if (m_running) {
-    Logger::log(ERR, "Can't add Devices to the Rig while the Rig is running.");
-    return;
-  }
+  queueChange([this, device]() { addDeviceNow(device); });
+}
+
+void Rig::addDeviceNow(Device* device) {
+  Tables& tables = editTables();
 
   // Don't add duplicates.
-  if (m_devicesById.count(device->getId()) > 0)
+  if (tables.devicesById.count(device->getId()) > 0)
   {
     stringstream ss;
     ss << "Failed to add device with ID " << device->getId() << " to rig because ID already exists";
@@ -266,130 +398,499 @@ void Rig::addDevice(Device* device) {
     return;
   }
 
-  m_devices.insert(device);
-  m_devicesById[device->getId()] = device;
-  m_devicesByChannel.insert(make_pair(device->getChannel(), device));
+  tables.devices.insert(device);
+  tables.devicesById[device->getId()] = device;
+
+  if (device->getHandle() >= tables.devicesByHandle.size())
+    tables.devicesByHandle.resize(device->getHandle() + 1, nullptr);
+  tables.devicesByHandle[device->getHandle()] = device;
+  tables.devicesByChannel.insert(make_pair(device->getChannel(), device));
+
+  m_metadataIndex.update(device);
+  m_metadataCallbacks[device] = device->addMetadataChangedCallback([this](Device* d) {
+    m_metadataIndex.update(d);
+  });
+
+  if (m_paramStore)
+    device->bindStore(m_paramStore.get());
 }
 
 Device* Rig::getDevice(string id) {
+  shared_ptr<const Tables> tables = getTables();
+
   // If it doesn't exist, just return a null pointer.
-  if (m_devicesById.count(id) == 0) {
-    return nullptr;
-  }
-  return m_devicesById[id];
+  auto it = tables->devicesById.find(id);
+  return (it != tables->devicesById.end()) ? it->second : nullptr;
+}
+
+Device* Rig::getDevice(DeviceHandle handle) {
+  return getTables()->getDevice(handle);
+}
+
+set<Device *> Rig::getDeviceRaw() {
+  return getTables()->devices;
 }
 
 void Rig::deleteDevice(string id) {
-  if (m_running) {
-    Logger::log(ERR, "Can't delete devices while Rig is running.");
-    return;
-  }
+  queueChange([this, id]() { deleteDeviceNow(id); });
+}
 
-  if (m_devicesById.count(id) == 0)
+void Rig::deleteDeviceNow(string id) {
+  Tables& tables = editTables();
+  if (tables.devicesById.count(id) == 0)
     return;
 
   // Find the device pointer so we can delete it in the other indexes
-  Device * toDelete = m_devicesById[id];
-  auto range = m_devicesByChannel.equal_range(toDelete->getChannel());
+  Device * toDelete = tables.devicesById[id];
+  auto range = tables.devicesByChannel.equal_range(toDelete->getChannel());
   for (auto it = range.first; it != range.second; it++) {
     if (it->second->getId() == toDelete->getId()) {
-      m_devicesByChannel.erase(it);
+      tables.devicesByChannel.erase(it);
       break;
     }
   }
 
-  // Find the device in the vector and delete it. Yay vectors.
-  m_devices.erase(find(m_devices.begin(), m_devices.end(), m_devicesById[id]));
+  tables.devices.erase(toDelete);
+  tables.devicesById.erase(id);
+  tables.devicesByHandle[toDelete->getHandle()] = nullptr;
+
+  toDelete->deleteMetadataChangedCallback(m_metadataCallbacks[toDelete]);
+  m_metadataCallbacks.erase(toDelete);
+  m_metadataIndex.remove(toDelete->getHandle());
+
+  for (auto& v : m_views) {
+    shared_ptr<LiveView> view = v.lock();
+    if (view)
+      view->remove(toDelete);
+  }
+
+  // The store belongs to the rig, so the device takes its values back.
+  toDelete->bindStore(nullptr);
+
+  m_seenGenerations.erase(toDelete);
+  Device* snapshot = nullptr;
+  if (m_frontBuffer.count(toDelete) > 0) {
+    snapshot = m_frontBuffer[toDelete];
+    m_frontDevices.erase(snapshot);
+    m_frontBuffer.erase(toDelete);
+  }
+
+  // Free the memory once nothing can be using it anymore
+  retireWithTables([toDelete, snapshot]() {
+    delete toDelete;
+    delete snapshot;
+  });
+}
+
+void Rig::setParameterStore(bool enable) {
+  queueChange([this, enable]() {
+    if (enable == (m_paramStore != nullptr))
+      return;
+
+    shared_ptr<ParameterStore> store = enable ? make_shared<ParameterStore>() : nullptr;
+    for (auto d : editTables().devices) {
+      d->bindStore(store.get());
+    }
 
-  // Delete the memory used by the device using the id->device map
-  delete m_devicesById[id];
-  m_devicesById.erase(id);
+    // Queries may still be scanning the old store.
+    shared_ptr<ParameterStore> old = atomic_load(&m_paramStore);
+    atomic_store(&m_paramStore, store);
+    retire([old]() mutable { old.reset(); });
+  });
 }
 
 void Rig::addPatch(string id, Patch* patch) {
-  if (m_running) {
-    Logger::log(ERR, "Can't add patches while Rig is running.");
-    return;
-  }
+  queueChange([this, id, patch]() { addPatchNow(id, patch); });
+}
+
+void Rig::addPatchNow(string id, Patch* patch) {
+  Tables& tables = editTables();
 
   // No duplicates.
-  if (m_patches.count(id) > 0)
+  if (tables.patches.count(id) > 0)
     return;
 
-  m_patches[id] = patch;
+  tables.patches[id] = patch;
+
+  lock_guard<mutex> lock(m_timingLock);
+  m_patchTimings[id] = shared_ptr<TimingHistogram>(new TimingHistogram());
 }
 
 Patch* Rig::getPatch(string id) {
-  return (m_patches.count(id) > 0) ? m_patches[id] : nullptr;
+  shared_ptr<const Tables> tables = getTables();
+  auto it = tables->patches.find(id);
+  return (it != tables->patches.end()) ? it->second : nullptr;
 }
 
 void Rig::deletePatch(string id) {
-  if (m_running) {
-    Logger::log(ERR, "Can't remove patches while Rig is running.");
+  queueChange([this, id]() { deletePatchNow(id); });
+}
+
+void Rig::deletePatchNow(string id) {
+  Tables& tables = editTables();
+  if (tables.patches.count(id) == 0)
     return;
+
+  // Closing a patch can be slow (interfaces shut down in the destructor),
+  // so it's freed outside the update loop.
+  Patch* toDelete = tables.patches[id];
+  tables.patches.erase(id);
+  {
+    lock_guard<mutex> lock(m_timingLock);
+    m_patchTimings.erase(id);
   }
 
-  if (m_patches.count(id) == 0)
+  retireWithTables([toDelete]() { delete toDelete; });
+}
+
+bool Rig::queueChange(function<void()> change) {
+  // Checked under the lock so stop() can't slip in between the check
+  // and queueing the change.
+  unique_lock<mutex> lock(m_changeLock);
+
+  if (!m_running) {
+    lock.unlock();
+
+    // Not published right away, so adding devices one at a time doesn't
+    // copy the tables every time. The next read publishes them.
+    {
+      lock_guard<recursive_mutex> apply(m_applyLock);
+      change();
+    }
+
+    collectRetired();
+    return true;
+  }
+
+  m_pendingChanges.push_back(change);
+  uint64_t ticket = ++m_changesQueued;
+
+  // Called from inside the update loop (an additional function for example).
+  // Waiting would deadlock, so the change just goes in at the next frame.
+  if (this_thread::get_id() == m_updateThreadId)
+    return false;
+
+  m_changesDone.wait(lock, [this, ticket]() { return m_changesApplied >= ticket; });
+  lock.unlock();
+
+  collectRetired();
+  return true;
+}
+
+void Rig::applyPendingChanges() {
+  vector<function<void()> > changes;
+  {
+    lock_guard<mutex> lock(m_changeLock);
+    if (m_pendingChanges.empty())
+      return;
+
+    changes.swap(m_pendingChanges);
+  }
+
+  // All changes queued before this frame go in together, so a frame never
+  // sees half of a batch.
+  {
+    lock_guard<recursive_mutex> apply(m_applyLock);
+    for (auto& c : changes) {
+      c();
+    }
+
+    publishTables();
+  }
+
+  {
+    lock_guard<mutex> lock(m_changeLock);
+    m_changesApplied += changes.size();
+  }
+  m_changesDone.notify_all();
+}
+
+shared_ptr<const Rig::Tables> Rig::getTables() {
+  // Publishing has to wait for changes on other threads to finish. Until
+  // then the last published tables are still consistent, so use those.
+  if (m_tablesDirty) {
+    unique_lock<recursive_mutex> apply(m_applyLock, try_to_lock);
+    if (apply.owns_lock())
+      publishTables();
+  }
+
+  return atomic_load(&m_tables);
+}
+
+Rig::Tables& Rig::editTables() {
+  if (m_editTables == nullptr) {
+    m_editTables = make_shared<Tables>(*atomic_load(&m_tables));
+    m_editTables->release = make_shared<Release>();
+  }
+
+  m_tablesDirty = true;
+  return *m_editTables;
+}
+
+void Rig::publishTables() {
+  if (m_editTables == nullptr)
     return;
 
-  // Free up space and erase the patch from the map
-  delete m_patches[id];
-  m_patches.erase(id);
+  shared_ptr<const Tables> old = atomic_load(&m_tables);
+  old->release->deleters.swap(m_released);
+  old->release->next = m_editTables->release;
+
+  atomic_store(&m_tables, shared_ptr<const Tables>(m_editTables));
+  m_editTables.reset();
+  m_tablesDirty = false;
+
+  // Freeing a large set of tables isn't free either, so it happens off the loop.
+  retire([old]() mutable { old.reset(); });
+}
+
+void Rig::retireWithTables(function<void()> deleter) {
+  m_released.push_back(deleter);
+}
+
+void Rig::retire(function<void()> deleter) {
+  lock_guard<mutex> lock(m_changeLock);
+  m_retired.push_back(deleter);
+}
+
+void Rig::collectRetired() {
+  vector<function<void()> > retired;
+  {
+    lock_guard<mutex> lock(m_changeLock);
+    retired.swap(m_retired);
+  }
+
+  for (auto& r : retired) {
+    r();
+  }
 }
 
 void Rig::setRefreshRate(unsigned int rate) {
+  if (rate == 0) {
+    Logger::log(ERR, "Rig refresh rate must be greater than 0");
+    return;
+  }
+
   m_refreshRate = rate;
   m_loopTime = 1.0f / (float)m_refreshRate;
+  m_loopPeriod = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / rate));
 }
 
 void Rig::update() {
+  // Deadlines are absolute. Each frame's deadline is the previous one plus
+  // the loop period, so the cadence doesn't drift with however long a frame took.
+  auto deadline = chrono::steady_clock::now();
+
+  {
+    lock_guard<mutex> lock(m_changeLock);
+    m_updateThreadId = this_thread::get_id();
+  }
+
   while (m_running) {
-    // Get start time
-    auto start = chrono::high_resolution_clock::now();
+    // Settings can change from other threads, each frame uses one set of them.
+    chrono::steady_clock::duration period = m_loopPeriod;
+    chrono::microseconds spinTime = m_spinTime;
+    OverrunPolicy overrunPolicy = m_overrunPolicy;
+
+    deadline += period;
+    auto frameStart = chrono::steady_clock::now();
+
+    // Structural changes only happen here, between frames.
+    applyPendingChanges();
+
+    // The whole frame works from one version of the tables.
+    shared_ptr<const Tables> tables = getTables();
 
     // Run additional functions before sending to patches
     // These functions can be update functions you run in your own code
     // or other things that need to be in sync with stuff going over the network.
     for (auto& f : m_updateFunctions) {
+      auto start = chrono::steady_clock::now();
       f.second();
+      auto elapsed = chrono::steady_clock::now() - start;
+      m_functionTimings.at(f.first)->record(elapsed, elapsed > period);
     } 
 
-    // Run the whole update thing for all patches
-    for (auto& p : m_patches) {
-      p.second->update(m_devices);
+    // Patches only need to look at devices that changed since the last frame
+    // Parameter level changes are only worked out if someone wants them.
+    set<Device *> changed;
+    ChangeSet* changes = nullptr;
+    if (!m_changeCallbacks.empty() || m_changeJournal != nullptr) {
+      m_frameChanges.clear();
+      changes = &m_frameChanges;
+    }
+    collectChangedDevices(tables->devices, changed, changes);
+
+    if (changes != nullptr && !changes->empty()) {
+      for (auto& c : m_changeCallbacks) {
+        c.second(*changes);
+      }
+    }
+
+    // Patches read from the front buffer, so application threads can keep
+    // writing to the devices while the patches run.
+    set<Device *> changedFront;
+    commitFrame(changed, changedFront);
+
+    // Views check the front buffer, which nothing else writes to.
+    if (!m_views.empty()) {
+      updateViews(changedFront);
     }
 
-    // Sleep a bit depending on how long the update took.
-    auto end = chrono::high_resolution_clock::now();
-    float elapsed = chrono::duration_cast<chrono::milliseconds>(end - start).count() / 1000.0f;
+    if (changes != nullptr && m_changeJournal != nullptr) {
+      writeJournal(*changes, frameStart);
+    }
+
+    // Run the whole update thing for all patches
+    if (m_patchPool != nullptr && tables->patches.size() > 1) {
+      vector<function<void()> > jobs;
+      for (auto& p : tables->patches) {
+        const string& id = p.first;
+        Patch* patch = p.second;
+        jobs.push_back([this, &id, patch, &changedFront]() { updatePatch(id, patch, changedFront); });
+      }
 
-    if (elapsed < m_loopTime) {
-      unsigned int ms = (unsigned int)(1000 * (m_loopTime - elapsed));
-      this_thread::sleep_for(chrono::milliseconds(ms));
+      // Returns once every patch is done
+      m_patchPool->run(jobs);
     }
     else {
+      for (auto& p : tables->patches) {
+        updatePatch(p.first, p.second, changedFront);
+      }
+    }
+
+    auto now = chrono::steady_clock::now();
+    m_frameTiming.record(now - frameStart, now - frameStart > period);
+
+    if (now >= deadline) {
       Logger::log(WARN, "Rig Update loop running slowly");
+
+      auto behind = now - deadline;
+      if (overrunPolicy == OVERRUN_SKIP || behind > chrono::seconds(1)) {
+        // Drop the missed frames and stay on the original schedule.
+        // Catch-up also gives up here if it's over a second behind.
+        deadline += (behind / period + 1) * period;
+      }
+      else {
+        // Run the next frame immediately.
+        continue;
+      }
+    }
+
+    // Sleep most of the way, then spin for the rest if requested.
+    if (deadline - now > spinTime) {
+      this_thread::sleep_until(deadline - spinTime);
+    }
+
+    while (chrono::steady_clock::now() < deadline) {
+      this_thread::yield();
     }
   }
 }
 
-void Rig::setAllDevices(map<string, Device*> devices) {
-  for (auto& kvp : devices) {
-    if (m_devicesById.count(kvp.first) > 0) {
-      auto params = kvp.second->getRawParameters();
-      for (auto& param : params) {
-        // We want to copy instead of assign since we don't know where that LumiverseType data
-        // is going to end up. Maybe it'd be better if devices did a copy instead...
-        //LumiverseTypeUtils::copyByVal(param.second, m_devicesById[kvp.first]->getParam(param.first));
-        m_devicesById[kvp.first]->copyParamByValue(param.first, param.second);
+void Rig::updatePatch(const string& id, Patch* patch, const set<Device *>& changed) {
+  auto start = chrono::steady_clock::now();
+  patch->updateChanged(m_frontDevices, changed);
+  auto elapsed = chrono::steady_clock::now() - start;
+  m_patchTimings.at(id)->record(elapsed, elapsed > m_loopPeriod.load());
+}
+
+void Rig::commitFrame(const set<Device *>& changed, set<Device *>& changedFront) {
+  for (Device* d : changed) {
+    Device* old = nullptr;
+    auto front = m_frontBuffer.find(d);
+    if (front != m_frontBuffer.end())
+      old = front->second;
+
+    Device* snap = d->snapshot(old);
+
+    if (snap != old) {
+      // snapshot() already deleted the old copy, just drop the pointer.
+      m_frontDevices.erase(old);
+      m_frontDevices.insert(snap);
+      m_frontBuffer[d] = snap;
+    }
+
+    changedFront.insert(snap);
+  }
+}
+
+void Rig::collectChangedDevices(const set<Device *>& devices, set<Device *>& changed, ChangeSet* changes) {
+  vector<ParamHandle> params;
+
+  for (Device* d : devices) {
+    uint64_t gen = d->getGeneration();
+    bool raw = d->takeRawAccess();
+    auto seen = m_seenGenerations.find(d);
+    uint64_t since = 0;
+
+    if (seen == m_seenGenerations.end()) {
+      m_seenGenerations[d] = gen;
+    }
+    else if (seen->second != gen || raw) {
+      // Raw access means any parameter could have changed.
+      since = raw ? 0 : seen->second;
+      seen->second = gen;
+    }
+    else {
+      continue;
+    }
+
+    changed.insert(d);
+
+    if (changes != nullptr) {
+      changes->devices.push_back(d->getHandle());
+
+      params.clear();
+      d->getChangedParams(since, params);
+      for (ParamHandle p : params) {
+        ParamChange c;
+        c.device = d->getHandle();
+        c.param = p;
+        changes->params.push_back(c);
       }
     }
+  }
+}
+
+void Rig::setAllDevices(const map<string, Device*>& devices) {
+  StateBatch batch;
+  shared_ptr<const Tables> tables = getTables();
+
+  for (const auto& kvp : devices) {
+    if (tables->devicesById.count(kvp.first) > 0) {
+      batch.addDevice(kvp.second);
+    }
     else {
       stringstream ss;
       ss << "Rig does not contain a device with id: " << kvp.first;
       Logger::log(WARN, ss.str());
     }
   }
+
+  applyState(batch);
+}
+
+unsigned int Rig::applyState(const StateBatch& batch) {
+  const vector<StateBatch::Entry>& entries = batch.getEntries();
+  shared_ptr<const Tables> tables = getTables();
+  unsigned int changed = 0;
+
+  size_t first = 0;
+  while (first < entries.size()) {
+    DeviceHandle handle = entries[first].device;
+
+    size_t last = first + 1;
+    while (last < entries.size() && entries[last].device == handle)
+      last++;
+
+    Device* d = tables->getDevice(handle);
+    if (d != nullptr && d->copyParamsByValue(&entries[first], &entries[0] + last))
+      changed++;
+
+    first = last;
+  }
+
+  return changed;
 }
 
 Device* Rig::operator[](string id) {
@@ -398,7 +899,82 @@ Device* Rig::operator[](string id) {
 
 DeviceSet Rig::query(string q) {
   DeviceSet working(this);
-  return working.select(q);
+  return working.select(*getQueryPlan(q));
+}
+
+shared_ptr<const QueryPlan> Rig::getQueryPlan(const string& q) {
+  {
+    lock_guard<mutex> lock(m_queryCacheLock);
+
+    auto cached = m_queryPlansBySelector.find(q);
+    if (cached != m_queryPlansBySelector.end()) {
+      // Move to the front
+      m_queryPlans.splice(m_queryPlans.begin(), m_queryPlans, cached->second);
+      return *cached->second;
+    }
+  }
+
+  // Compiling is the slow part, so it's done outside the lock. If two threads
+  // compile the same query at once the second one's plan is just dropped.
+  shared_ptr<const QueryPlan> plan = make_shared<QueryPlan>(q);
+
+  lock_guard<mutex> lock(m_queryCacheLock);
+
+  if (m_queryCacheSize == 0 || m_queryPlansBySelector.count(q) > 0)
+    return plan;
+
+  m_queryPlans.push_front(plan);
+  m_queryPlansBySelector[q] = m_queryPlans.begin();
+
+  while (m_queryPlans.size() > m_queryCacheSize) {
+    m_queryPlansBySelector.erase(m_queryPlans.back()->getSelector());
+    m_queryPlans.pop_back();
+  }
+
+  return plan;
+}
+
+void Rig::setQueryCacheSize(size_t size) {
+  lock_guard<mutex> lock(m_queryCacheLock);
+  m_queryCacheSize = size;
+
+  while (m_queryPlans.size() > m_queryCacheSize) {
+    m_queryPlansBySelector.erase(m_queryPlans.back()->getSelector());
+    m_queryPlans.pop_back();
+  }
+}
+
+size_t Rig::getQueryCacheSize() {
+  lock_guard<mutex> lock(m_queryCacheLock);
+  return m_queryCacheSize;
+}
+
+shared_ptr<LiveView> Rig::createView(string q) {
+  shared_ptr<LiveView> view = make_shared<LiveView>(this, getQueryPlan(q));
+
+  queueChange([this, view]() {
+    view->refresh();
+    m_views.push_back(view);
+  });
+
+  return view;
+}
+
+void Rig::updateViews(const set<Device *>& changed) {
+  for (size_t i = 0; i < m_views.size(); ) {
+    shared_ptr<LiveView> view = m_views[i].lock();
+
+    if (!view) {
+      m_views[i] = m_views.back();
+      m_views.pop_back();
+      continue;
+    }
+
+    if (!changed.empty())
+      view->update(changed);
+
+    i++;
+  }
 }
 
 DeviceSet Rig::operator[](unsigned int channel) {
@@ -406,7 +982,7 @@ DeviceSet Rig::operator[](unsigned int channel) {
 }
 
 DeviceSet Rig::getAllDevices() {
-  return DeviceSet(this, m_devices);
+  return DeviceSet(this, getTables()->devices);
 }
 
 DeviceSet Rig::getChannel(unsigned int channel) {
@@ -427,7 +1003,8 @@ DeviceSet Rig::getDevices(string key, string val, bool isEqual) {
 set<string> Rig::getAllUsedParams() {
   set<string> params;
   
-  for (auto& d : m_devices) {
+  shared_ptr<const Tables> tables = getTables();
+  for (auto& d : tables->devices) {
     for (auto& s : d->getParamNames()) {
       params.insert(s);
     }
@@ -451,6 +1028,64 @@ bool Rig::save(string filename, bool overwrite) {
   return true;
 }
 
+bool Rig::saveBinary(string filename, bool overwrite) {
+  // Test if the file already exists.
+  ifstream ifile(filename);
+  if (ifile.is_open() && !overwrite) {
+    return false;
+  }
+  ifile.close();
+
+  shared_ptr<const Tables> tables = getTables();
+
+  JSONNode patches;
+  patches.set_name("patches");
+  for (auto& p : tables->patches) {
+    JSONNode patch = p.second->toJSON();
+    patch.set_name(p.first);
+    patches.push_back(patch);
+  }
+
+  JSONNode root;
+  root.push_back(patches);
+
+  return BinarySnapshot::save(filename, tables->devices, root.write(), m_refreshRate);
+}
+
+bool Rig::loadBinary(string filename) {
+  stop();
+
+  vector<Device*> devices;
+  string patches;
+  unsigned int refreshRate;
+
+  if (!BinarySnapshot::load(filename, devices, patches, refreshRate))
+    return false;
+
+  reset();
+
+  queueChange([this, devices]() {
+    for (auto d : devices) {
+      addDeviceNow(d);
+    }
+  });
+
+  stringstream ss;
+  ss << "Loaded " << devices.size() << " Devices from " << filename;
+  Logger::log(INFO, ss.str());
+
+  JSONNode root = libjson::parse(patches);
+  auto patchNode = root.find("patches");
+  if (patchNode != root.end()) {
+    loadPatches(*patchNode);
+    Logger::log(INFO, "Patch load complete");
+  }
+
+  setRefreshRate(refreshRate);
+
+  return true;
+}
+
 JSONNode Rig::toJSON() {
   JSONNode root;
 
@@ -460,16 +1095,18 @@ JSONNode Rig::toJSON() {
   root.push_back(JSONNode("version", ss.str()));
   root.push_back(JSONNode("refreshRate", m_refreshRate));
 
+  shared_ptr<const Tables> tables = getTables();
+
   JSONNode devices;
   devices.set_name("devices");
-  for (auto d : m_devices) {
+  for (auto d : tables->devices) {
     devices.push_back(d->toJSON());
   }
   root.push_back(devices);
 
   JSONNode patches;
   patches.set_name("patches");
-  for (auto& p : m_patches) {
+  for (auto& p : tables->patches) {
     JSONNode patch = p.second->toJSON();
     patch.set_name(p.first);
     patches.push_back(patch);
@@ -480,7 +1117,8 @@ JSONNode Rig::toJSON() {
 }
     
 Patch* Rig::getSimulationPatch(string type) {
-    for (pair<string, Patch*> patch : m_patches) {
+    shared_ptr<const Tables> tables = getTables();
+    for (pair<string, Patch*> patch : tables->patches) {
         if ((patch.second->getType() == "ArnoldPatch" ||
             patch.second->getType() == "ArnoldAnimationPatch") &&
             patch.second->getType() == type) {
@@ -491,64 +1129,205 @@ Patch* Rig::getSimulationPatch(string type) {
     return NULL;
 }
 
-bool Rig::addFunction(int pid, function<void()> func) {
-  // If the rig wasn't running, leave it that way.
-  bool restart = false;
-  bool success = false;
+ChangeStatus Rig::addFunction(int pid, function<void()> func) {
+  auto success = make_shared<bool>(false);
+  if (!queueChange([this, pid, func, success]() { *success = addFunctionNow(pid, func); }))
+    return CHANGE_QUEUED;
 
-  if (m_running) {
-    stop();
-    restart = true;
-  }
+  return (*success) ? CHANGE_APPLIED : CHANGE_FAILED;
+}
 
+bool Rig::addFunctionNow(int pid, function<void()> func) {
   if (m_updateFunctions.count(pid) == 0) {
     m_updateFunctions[pid] = func;
-    success = true;
+    {
+      lock_guard<mutex> lock(m_timingLock);
+      m_functionTimings[pid] = shared_ptr<TimingHistogram>(new TimingHistogram());
+    }
 
     stringstream ss;
     ss << "Adding additional function to update loop with pid " << pid;
     Logger::log(INFO, ss.str());
+
+    return true;
   }
   else {
     stringstream ss;
     ss << "Function with pid " << pid << " already exists in update loop. Cannot add new function";
     Logger::log(ERR, ss.str());
+
+    return false;
   }
+}
 
-  if (restart)
-    run();
+int Rig::addChangeCallback(ChangeCallbackFunction func) {
+  int id = m_nextChangeCallbackId++;
+  queueChange([this, id, func]() { m_changeCallbacks[id] = func; });
+  return id;
+}
 
-  return success;
+void Rig::deleteChangeCallback(int id) {
+  queueChange([this, id]() { deleteChangeCallbackNow(id); });
 }
 
-bool Rig::removeFunction(int pid) {
-  bool restart = false;
-  bool ret = false;
+void Rig::deleteChangeCallbackNow(int id) {
+  auto c = m_changeCallbacks.find(id);
+  if (c == m_changeCallbacks.end())
+    return;
 
-  if (m_running) {
-    stop();
-    restart = true;
+  // Like removed functions, the callback may own resources.
+  auto func = make_shared<ChangeCallbackFunction>(c->second);
+  m_changeCallbacks.erase(c);
+  retire([func]() mutable { func.reset(); });
+}
+
+void Rig::setChangeJournal(size_t capacity) {
+  shared_ptr<ChangeJournal> journal;
+  if (capacity > 0)
+    journal = make_shared<ChangeJournal>(capacity);
+
+  queueChange([this, journal]() {
+    // Readers may hold the old journal, it goes away with the last of them.
+    atomic_store(&m_changeJournal, journal);
+  });
+}
+
+shared_ptr<ChangeJournal> Rig::getChangeJournal() {
+  return atomic_load(&m_changeJournal);
+}
+
+void Rig::writeJournal(const ChangeSet& changes, chrono::steady_clock::time_point frameStart) {
+  ChangeJournal::Record r;
+  r.timestamp = chrono::duration_cast<chrono::nanoseconds>(frameStart.time_since_epoch()).count();
+
+  DeviceHandle lastHandle = InvalidHandle;
+  Device* front = nullptr;
+
+  for (const ParamChange& c : changes.params) {
+    // Changes are grouped by device, so the front buffer lookup happens once per device.
+    if (c.device != lastHandle) {
+      lastHandle = c.device;
+      front = nullptr;
+
+      auto f = m_frontBuffer.find(getDevice(c.device));
+      if (f != m_frontBuffer.end())
+        front = f->second;
+    }
+
+    if (front == nullptr)
+      continue;
+
+    LumiverseType* param = front->readParam(c.param);
+    if (param == nullptr)
+      continue;
+
+    r.device = c.device;
+    r.param = c.param;
+
+    switch (param->getTypeTag()) {
+      case LumiverseType::FLOAT:
+        r.value = ((LumiverseFloat*)param)->getVal();
+        break;
+      case LumiverseType::ORIENTATION:
+        r.value = ((LumiverseOrientation*)param)->getVal();
+        break;
+      default:
+        r.value = numeric_limits<float>::quiet_NaN();
+        break;
+    }
+
+    m_changeJournal->write(r);
   }
+}
+
+ChangeStatus Rig::removeFunction(int pid) {
+  auto success = make_shared<bool>(false);
+  if (!queueChange([this, pid, success]() { *success = removeFunctionNow(pid); }))
+    return CHANGE_QUEUED;
 
+  return (*success) ? CHANGE_APPLIED : CHANGE_FAILED;
+}
+
+bool Rig::removeFunctionNow(int pid) {
   if (m_updateFunctions.count(pid) > 0) {
+    // The function may own resources, free it outside the update loop.
+    auto func = make_shared<function<void()> >(m_updateFunctions[pid]);
     m_updateFunctions.erase(pid);
+    {
+      lock_guard<mutex> lock(m_timingLock);
+      m_functionTimings.erase(pid);
+    }
+    retire([func]() mutable { func.reset(); });
 
     stringstream ss;
     ss << "Removed additional function from update loop with pid " << pid;
     Logger::log(INFO, ss.str());
 
-    ret = true;
+    return true;
   }
   else {
     stringstream ss;
     ss << "Failed to remove additional function from update loop with pid " << pid << " (function does not exist)";
     Logger::log(WARN, ss.str());
+
+    return false;
   }
-  
-  if (restart)
-    run();
+}
+
+shared_ptr<const TimingHistogram> Rig::getFunctionTiming(int pid) {
+  lock_guard<mutex> lock(m_timingLock);
+  auto it = m_functionTimings.find(pid);
+  return (it != m_functionTimings.end()) ? it->second : nullptr;
+}
 
-  return ret;
+shared_ptr<const TimingHistogram> Rig::getPatchTiming(string id) {
+  lock_guard<mutex> lock(m_timingLock);
+  auto it = m_patchTimings.find(id);
+  return (it != m_patchTimings.end()) ? it->second : nullptr;
 }
 
-}
\ No newline at end of file
+void Rig::resetTimings() {
+  m_frameTiming.reset();
+
+  lock_guard<mutex> lock(m_timingLock);
+
+  for (auto& t : m_functionTimings) {
+    t.second->reset();
+  }
+
+  for (auto& t : m_patchTimings) {
+    t.second->reset();
+  }
+}
+
+JSONNode Rig::getTimingJSON() {
+  JSONNode timing;
+
+  JSONNode frame = m_frameTiming.toJSON();
+  frame.set_name("frame");
+  timing.push_back(frame);
+
+  lock_guard<mutex> lock(m_timingLock);
+
+  JSONNode functions;
+  functions.set_name("functions");
+  for (auto& t : m_functionTimings) {
+    JSONNode func = t.second->toJSON();
+    func.set_name(to_string(t.first));
+    functions.push_back(func);
+  }
+  timing.push_back(functions);
+
+  JSONNode patches;
+  patches.set_name("patches");
+  for (auto& t : m_patchTimings) {
+    JSONNode patch = t.second->toJSON();
+    patch.set_name(t.first);
+    patches.push_back(patch);
+  }
+  timing.push_back(patches);
+
+  return timing;
+}
+
+}
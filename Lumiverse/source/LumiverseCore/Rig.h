@@ -7,13 +7,18 @@
 #pragma once
 
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <set>
+#include <unordered_map>
 #include <functional>
+#include <list>
 
 #include "LumiverseCoreConfig.h"
 #include "Patch.h"
@@ -21,6 +26,14 @@
 #include "Device.h"
 #include "Logger.h"
 #include "DeviceSet.h"
+#include "TimingHistogram.h"
+#include "WorkerPool.h"
+#include "RigLoader.h"
+#include "BinarySnapshot.h"
+#include "ChangeSet.h"
+#include "ChangeJournal.h"
+#include "QueryPlan.h"
+#include "MetadataIndex.h"
 #include "lib/arnold/include/ai.h"
 #include "lib/libjson/libjson.h"
 
@@ -31,6 +44,34 @@
 
 namespace Lumiverse {
   class DeviceSet;
+  class LiveView;
+
+  /*!
+  * \brief Determines what the Rig update loop does when a frame misses its deadline.
+  *
+  * OVERRUN_SKIP drops the missed frames and waits for the next deadline on the
+  * original schedule. OVERRUN_CATCH_UP runs the missed frames back to back until
+  * the loop is on schedule again.
+  * \sa Rig::setOverrunPolicy()
+  */
+  enum OverrunPolicy {
+    OVERRUN_SKIP,
+    OVERRUN_CATCH_UP
+  };
+
+  /*!
+  * \brief Result of a change to the Rig that can be queued.
+  *
+  * CHANGE_FAILED is 0, so the result can still be tested like a bool.
+  * CHANGE_QUEUED means the change was made from inside the update loop and
+  * goes in at the next frame, so whether it will succeed isn't known yet.
+  * \sa Rig::addFunction(), Rig::removeFunction()
+  */
+  enum ChangeStatus {
+    CHANGE_FAILED = 0,
+    CHANGE_APPLIED,
+    CHANGE_QUEUED
+  };
 
   /*! 
   * \brief The Rig contains information about the state of the lighting system.
@@ -100,6 +141,9 @@ namespace Lumiverse {
     */
     void stop();
 
+    /*! \brief Checks if the update loop is running. */
+    bool isRunning() { return m_running; }
+
     /*!
     * \brief Loads a file into an existing rig
     *
@@ -109,12 +153,29 @@ namespace Lumiverse {
     */
     bool load(string filename);
 
+    /*!
+    * \brief Loads a rig from a binary snapshot.
+    *
+    * Faster than load() for large rigs because the file is memory mapped and
+    * read without any text parsing. Devices and their parameters are still
+    * allocated one by one as they are with load(), and patches are still
+    * loaded from JSON, so this removes the parsing cost only.
+    * \param filename Snapshot written by saveBinary().
+    * \return false if an error occurs, true if loaded successfully
+    * \sa saveBinary(), BinarySnapshot
+    */
+    bool loadBinary(string filename);
+
     /*!
     * \brief Adds a device to the Rig.
     *
     * Device memory is managed by the Rig. User should allocate memory,
     * and the Rig is responsible for freeing it at the end.
+    *
+    * Can be called while the Rig is running. The device is added between
+    * two frames, and this function waits for that to happen.
     * \param device Device to add to the Rig.
+    * \sa queueChange()
     */
     void addDevice(Device * device);
 
@@ -123,19 +184,32 @@ namespace Lumiverse {
     *
     * Return value can be modified to change
     * the state of the device in the rig.
+    * Safe to call from any thread.
     * \param id Device id.
     * \return Pointer to the requested Device. If the device doesn't exist in the rig,
     * a nullptr will be returned.
     */
     Device* getDevice(string id);
 
+    /*!
+    * \brief Gets a device from the rig by handle.
+    *
+    * Same as getDevice(string) but indexes straight into a table.
+    * \param handle Device handle. \sa Device::getHandle(), acquireDeviceHandle()
+    * \return Pointer to the requested Device. nullptr if the device isn't in the rig.
+    */
+    Device* getDevice(DeviceHandle handle);
+
     /*!
     * \brief Removes the device with specified id from the rig. Also deletes it.
     *
     * This operation calls the device destructor too, so just be sure you actually
     * want to completely get rid of a device before calling this.
     * If you need to save the Device for some reason, get it with getDevice() first.
-    * \sa getDevice()
+    *
+    * Can be called while the Rig is running. The device is removed between
+    * two frames, and this function waits for that to happen.
+    * \sa getDevice(), queueChange()
     */
     void deleteDevice(string id);
 
@@ -146,6 +220,7 @@ namespace Lumiverse {
     * Rig is responsible for freeing an allocated patch.
     * Expects the patch to be configured before sending it to the rig.
     * Not that it can't be edited later, but the rig only knows what you tell it.
+    * Can be called while the Rig is running, see addDevice().
     * \param id Identifier for the Patch. Used to retrieve patches from the Rig.
     * \param patch Pointer to the patch.
     * \sa Patch
@@ -174,7 +249,7 @@ namespace Lumiverse {
     * \brief Deletes an entire patch from the rig.
     * 
     * Memory is freed after delete. If you need to save it for some reason, get it with
-    * getPatch() first.
+    * getPatch() first. Can be called while the Rig is running, see addDevice().
     * \param Patch id
     * \sa getPatch()
     */
@@ -195,6 +270,74 @@ namespace Lumiverse {
     */
     unsigned int getRefreshRate() { return m_refreshRate; }
 
+    /*!
+    * \brief Sets how long the update loop busy-waits before each frame deadline.
+    *
+    * The loop sleeps until `spin` microseconds before the deadline and then spins
+    * for the remainder, which gives sub-millisecond accuracy at the cost of some CPU.
+    * Set to 0 (the default) to rely on sleeping alone.
+    * \param us Spin time in microseconds.
+    */
+    void setSpinTime(unsigned int us) { m_spinTime = chrono::microseconds(us); }
+
+    /*!
+    * \brief Gets the spin time used before each frame deadline.
+    *
+    * \return Spin time in microseconds.
+    */
+    unsigned int getSpinTime() { return (unsigned int)m_spinTime.load().count(); }
+
+    /*!
+    * \brief Sets what the update loop does when a frame overruns its deadline.
+    *
+    * \param policy Overrun policy. Default is OVERRUN_SKIP.
+    * \sa OverrunPolicy
+    */
+    void setOverrunPolicy(OverrunPolicy policy) { m_overrunPolicy = policy; }
+
+    /*!
+    * \brief Gets the overrun policy used by the update loop.
+    */
+    OverrunPolicy getOverrunPolicy() { return m_overrunPolicy; }
+
+    /*!
+    * \brief Sets whether patches are updated in parallel.
+    *
+    * When enabled, run() starts a pool of worker threads and each frame
+    * updates all patches concurrently, waiting for all of them to finish
+    * before the next frame. Patches only read device state during an update.
+    * Takes effect the next time run() is called. Default is true.
+    * \param parallel True to update patches in parallel.
+    */
+    void setParallelPatches(bool parallel) { m_parallelPatches = parallel; }
+
+    /*!
+    * \brief Indicates if patches are updated in parallel.
+    */
+    bool getParallelPatches() { return m_parallelPatches; }
+
+    /*!
+    * \brief Sets whether float and color parameters are kept in a rig-wide ParameterStore.
+    *
+    * When enabled, the values of every float parameter and the channels of
+    * every color parameter of every device in the rig live in contiguous columns, and devices added later are bound to the
+    * store as well. Disabling moves the values back into the devices.
+    * Can be called while the rig is running; the change goes in between frames.
+    * Default is false.
+    * \param enable True to use a ParameterStore.
+    * \sa getParameterStore(), Device::bindStore()
+    */
+    void setParameterStore(bool enable);
+
+    /*!
+    * \brief Gets the rig's ParameterStore.
+    *
+    * A store replaced by setParameterStore() stays valid for as long as the
+    * returned pointer is held, but no longer has the devices' values.
+    * \return The store, or nullptr if setParameterStore() isn't enabled.
+    */
+    shared_ptr<ParameterStore> getParameterStore() { return atomic_load(&m_paramStore); }
+
     /*!
     * \brief Shorthand for getDevice(string)
     *
@@ -213,6 +356,41 @@ namespace Lumiverse {
     */
     DeviceSet query(string q);
 
+    /*!
+    * \brief Gets the compiled form of a query string.
+    *
+    * Compiled queries are kept in a least recently used cache keyed by the
+    * query string, so running the same query again skips parsing it.
+    * \param q Query string
+    * \return Compiled query.
+    * \sa query(), setQueryCacheSize(), QueryPlan
+    */
+    shared_ptr<const QueryPlan> getQueryPlan(const string& q);
+
+    /*!
+    * \brief Sets how many compiled queries are cached.
+    * \param size Number of queries. 0 turns the cache off.
+    * \sa getQueryPlan()
+    */
+    void setQueryCacheSize(size_t size);
+
+    /*! \brief Gets how many compiled queries are cached. \sa setQueryCacheSize() */
+    size_t getQueryCacheSize();
+
+    /*!
+    * \brief Makes a view of a query that the Rig keeps up to date.
+    *
+    * The view is filled between two frames, and this function waits for that
+    * to happen, except when called from the update loop, where the view
+    * starts filled at the next frame. After that, devices that change are
+    * checked against the query once per frame.
+    * The view is dropped from the Rig once nothing else holds it.
+    * \param q Query string
+    * \return The view.
+    * \sa LiveView, query()
+    */
+    shared_ptr<LiveView> createView(string q);
+
     /*!
     * \brief Shorthand for getChannel(unsigned int)
     * 
@@ -273,11 +451,12 @@ namespace Lumiverse {
     /*!
     * \brief Gets the raw list of devices.
     * 
-    * Users shouldn't modify the set of devices through this method,
-    * but may read the data and modify device parameters.
+    * Users may read the data and modify device parameters. The set is a
+    * copy, so it doesn't change if devices are added or removed while it's
+    * being used.
     * \return Set of Devices maintained by this Rig
     */
-    const set<Device *>& getDeviceRaw() { return m_devices; }
+    set<Device *> getDeviceRaw();
 
     /*!
     * \brief Writes the rig out to a JSON file
@@ -290,6 +469,19 @@ namespace Lumiverse {
     */
     bool save(string filename, bool overwrite = false);
 
+    /*!
+    * \brief Writes the rig out to a binary snapshot.
+    *
+    * Snapshots hold the same devices and patches as save(), but can only be
+    * read on platforms with the same byte order.
+    * \param filename Path to file
+    * \param overwrite If the file specified by filename exists, the file will be
+    * overwritten if this variable is set to `true`
+    * \return True on success, false on failure.
+    * \sa loadBinary(), BinarySnapshot
+    */
+    bool saveBinary(string filename, bool overwrite = false);
+
     /*!
     * \brief Gets the JSON data for the rig.
     * 
@@ -301,24 +493,70 @@ namespace Lumiverse {
      * \brief Adds a function to the additional functions list.
      *
      * The added function will be updated before the patch is updated
-     * as part of Rig::update(). The update loop will be stopped during
-     * the modification of the function list.
+     * as part of Rig::update(). If the Rig is running, the function is added
+     * between two frames without stopping the update loop. When called from
+     * inside the update loop, the function is added at the next frame.
      * \param pid ID to assign to the function
      * \param func Function to execute
      * \sa m_updateFunctions
-     * \returns False if a function with specified pid already exists. True on success.
+     * \returns CHANGE_FAILED if a function with specified pid already exists,
+     * CHANGE_APPLIED if it was added, CHANGE_QUEUED if it will be added at
+     * the next frame.
      */
-    bool addFunction(int pid, function<void()> func);
+    ChangeStatus addFunction(int pid, function<void()> func);
 
     /*!
     * \brief Removes a function from the additional functions list.
     * 
-    * This function will stop the update loop while it modifies the function
-    * list, and will automatically restart it.
+    * If the Rig is running, the function is removed between two frames
+    * without stopping the update loop. When called from inside the update
+    * loop, it's removed at the next frame.
     * \param pid The function number to remove.
-    * \returns True if function removed, false otherwise.
+    * \returns CHANGE_FAILED if there's no such function, CHANGE_APPLIED if
+    * it was removed, CHANGE_QUEUED if it will be removed at the next frame.
+    */
+    ChangeStatus removeFunction(int pid);
+
+    /*!
+    * \brief Registers a function to be told what changed each frame.
+    *
+    * Instead of a call per parameter set, like Device::addParameterChangedCallback(),
+    * the function is called at most once per frame with every device and
+    * parameter that changed since the previous frame. It runs on the update loop
+    * thread after the additional functions and before the patches, and isn't
+    * called for frames where nothing changed.
+    * Like addFunction(), this is safe to call while the Rig is running.
+    * \param func Function to call.
+    * \return Id of the callback, for deleteChangeCallback().
+    * \sa ChangeSet
+    */
+    int addChangeCallback(ChangeCallbackFunction func);
+
+    /*!
+    * \brief Removes a function registered with addChangeCallback().
+    * \param id Id returned by addChangeCallback().
+    */
+    void deleteChangeCallback(int id);
+
+    /*!
+    * \brief Turns the change journal on or off.
+    *
+    * While on, the update loop writes a record for every parameter that
+    * changes to the journal, with the value patches saw that frame. Any number
+    * of readers can follow it with their own ChangeJournal::Cursor.
+    * Replacing the journal starts a new, empty one. Readers of the old one can
+    * keep using it but it won't get new records.
+    * \param capacity Number of records to keep. 0 turns the journal off.
+    * \sa getChangeJournal()
     */
-    bool removeFunction(int pid);
+    void setChangeJournal(size_t capacity);
+
+    /*!
+    * \brief Gets the change journal.
+    * \return The journal, or nullptr if it's off.
+    * \sa setChangeJournal()
+    */
+    shared_ptr<ChangeJournal> getChangeJournal();
 
     /*!
     * \brief Pushes data over the network
@@ -342,32 +580,188 @@ namespace Lumiverse {
     * \brief Updates the parameters of the devices stored in the specified map.
     *
     * This function allows you to do mass updates of devices in a Rig.
-    * This function will only update parameters not metadata
+    * This function will only update parameters not metadata.
+    * Builds a StateBatch on every call, so code that updates the same devices
+    * repeatedly should keep a batch and use applyState() instead.
     * \param devices Map of device id -> Device* containing the data to update the rig with.
     */
-    void setAllDevices(map<string, Device*> devices);
+    void setAllDevices(const map<string, Device*>& devices);
+
+    /*!
+    * \brief Copies every value in a batch into the rig's devices.
+    *
+    * Each device that changes gets one parameter changed notification, no
+    * matter how many of its parameters changed. Entries for devices that aren't
+    * in the rig are skipped.
+    * \param batch Values to write.
+    * \return Number of devices that changed.
+    * \sa StateBatch
+    */
+    unsigned int applyState(const StateBatch& batch);
+
+    /*!
+    * \brief Gets the timing histogram for whole update loop frames.
+    *
+    * A frame is counted as an overrun if it takes longer than the loop period.
+    * \sa TimingHistogram
+    */
+    const TimingHistogram& getFrameTiming() { return m_frameTiming; }
+
+    /*!
+    * \brief Gets the timing histogram for an additional update function.
+    *
+    * The histogram stays valid after the function is removed, it just stops
+    * getting new samples.
+    * \param pid ID of the function.
+    * \return The histogram. nullptr if the function doesn't exist.
+    * \sa addFunction()
+    */
+    shared_ptr<const TimingHistogram> getFunctionTiming(int pid);
+
+    /*!
+    * \brief Gets the timing histogram for a patch's update.
+    *
+    * Like getFunctionTiming(), the histogram outlives the patch.
+    * \param id Patch id.
+    * \return The histogram. nullptr if the patch doesn't exist.
+    */
+    shared_ptr<const TimingHistogram> getPatchTiming(string id);
+
+    /*!
+    * \brief Clears all recorded update loop timings.
+    */
+    void resetTimings();
+
+    /*!
+    * \brief Gets the JSON summary of the update loop timings.
+    *
+    * Contains the frame timings plus the timings for each function
+    * (by pid) and each patch (by id).
+    * \sa TimingHistogram::toJSON()
+    */
+    JSONNode getTimingJSON();
 
   private:
+    /*!
+    * \brief Frees devices and patches once no tables can lead to them.
+    *
+    * Each published Tables has one. Objects removed from the Rig are freed
+    * when the Release of the last tables that had them goes away. Older
+    * Releases keep newer ones alive, so a reader still holding an older
+    * version of the tables keeps every object it can find valid.
+    */
+    struct Release {
+      /*! \brief Frees the objects. */
+      vector<function<void()> > deleters;
+
+      /*! \brief Release of the tables that replaced these. */
+      shared_ptr<Release> next;
+
+      ~Release() {
+        for (auto& d : deleters) {
+          d();
+        }
+      }
+    };
+
+    /*!
+    * \brief Device and patch lookup tables.
+    *
+    * A published Tables is never modified. Changes are made to a working copy
+    * which replaces the published one as a whole, so readers on any thread
+    * see a consistent version for as long as they hold on to it.
+    * \sa m_tables, getTables()
+    */
+    struct Tables {
+      /*!
+      * \brief Raw list of devices for sending to the Patch->update function.
+      *
+      * This is the core list of Device objects that the Rig maintains.
+      * Indices are built off of this set as needed.
+      * \sa Device
+      */
+      set<Device *> devices;
+
+      /*!
+      * \brief Maps Patch id to at Patch object
+      *
+      * The Patch id only matters to the Rig. The Patch doesn't really care what you call it.
+      * \sa Patch
+      */
+      map<string, Patch *> patches;
+
+      /*! \brief Devices mapped by their device ID. */
+      map<string, Device *> devicesById;
+
+      /*! \brief Devices indexed by DeviceHandle. nullptr for handles not in the rig. */
+      vector<Device *> devicesByHandle;
+
+      /*! \brief Devices mapped by channel number. */
+      multimap<unsigned int, Device *> devicesByChannel;
+
+      /*! \brief Frees what was removed when these tables were replaced. */
+      shared_ptr<Release> release;
+
+      /*! \brief Looks up a device by handle. nullptr if it isn't in the rig. */
+      Device* getDevice(DeviceHandle handle) const {
+        return (handle < devicesByHandle.size()) ? devicesByHandle[handle] : nullptr;
+      }
+    };
+
+    /*!
+    * \brief Gets the current lookup tables.
+    *
+    * If changes were made since the tables were last published and no
+    * change is in progress on another thread, they're published first.
+    * Never waits on the update loop.
+    * \sa m_tables
+    */
+    shared_ptr<const Tables> getTables();
+
+    /*!
+    * \brief Gets the working copy of the tables, making it if needed.
+    *
+    * Only used by changes, with m_applyLock held.
+    */
+    Tables& editTables();
+
+    /*!
+    * \brief Replaces the published tables with the working copy, if there is one.
+    *
+    * The old tables are retired. Caller holds m_applyLock.
+    */
+    void publishTables();
+
+    /*!
+    * \brief Hands off a removed device or patch to be freed.
+    *
+    * Unlike retire(), the object is only freed once nothing holds tables
+    * that still have it. Must be called from a change.
+    * \param deleter Function freeing the object.
+    * \sa Release
+    */
+    void retireWithTables(function<void()> deleter);
+
     /*!
     * \brief Loads the rig info from the parsed JSON data.
     * \param root JSONNode containing all Rig data.
     * \sa toJSON(), save(), loadDevices(), loadPatches()
     */
-    void loadJSON(JSONNode root);
+    void loadJSON(const JSONNode& root);
 
     /*!
     * \brief Loads the devices in the JSON file.
     * \param root JSONNode containing the Devices in the Rig.
     * \sa loadJSON()
     */
-    void loadDevices(JSONNode root);
+    void loadDevices(const JSONNode& root);
 
     /*!
     * \brief Load patches in the JSON file.
     * \param root JSONNode containing the Patches in the Rig.
     * \sa loadJSON()
     */
-    void loadPatches(JSONNode root);
+    void loadPatches(const JSONNode& root);
 
     /*!
     * \brief Empties all the data from the rig.
@@ -375,15 +769,138 @@ namespace Lumiverse {
     void reset();
 
     /*!
-    * \brief Thread that runs the update loop.
+    * \brief Updates a single patch and records its timing.
+    * \param id Patch id.
+    * \param patch Patch to update.
+    * \param changed Devices that changed since the last frame.
+    */
+    void updatePatch(const string& id, Patch* patch, const set<Device *>& changed);
+
+    /*!
+    * \brief Copies the state of changed devices into the front buffer.
+    *
+    * Each copy is a consistent snapshot taken with Device::snapshot(), so
+    * writers never block and patches never see a half-written value.
+    * \param changed Devices that changed since the last frame.
+    * \param[out] changedFront Front buffer copies of the changed devices.
+    * \sa m_frontBuffer
+    */
+    void commitFrame(const set<Device *>& changed, set<Device *>& changedFront);
+
+    /*!
+    * \brief Writes a frame's parameter changes to the change journal.
+    *
+    * Values are read from the front buffer, so must run after commitFrame().
+    * \param changes Changes of the frame.
+    * \param frameStart Time the frame started.
+    */
+    void writeJournal(const ChangeSet& changes, chrono::steady_clock::time_point frameStart);
+
+    /*!
+    * \brief Finds the devices that changed since the last call.
+    *
+    * Compares each device's generation against the one seen on the previous
+    * frame. Devices that handed out raw parameter pointers since the last
+    * frame are included too, and their raw access flag is cleared.
+    * \param devices Devices in the rig.
+    * \param[out] changed Set to fill with the changed devices.
+    * \param[out] changes If not nullptr, the changed devices and parameters
+    * are added to this too.
+    * \sa Device::getGeneration(), Patch::updateChanged()
+    */
+    void collectChangedDevices(const set<Device *>& devices, set<Device *>& changed, ChangeSet* changes = nullptr);
+
+    /*!
+    * \brief Updates the live views with the devices that changed in a frame.
+    *
+    * Also drops views nobody holds anymore. Must run after commitFrame().
+    * \param changed Front buffer copies of the devices that changed.
+    */
+    void updateViews(const set<Device *>& changed);
+
+    /*!
+    * \brief Runs a change to the Rig's devices, patches or functions.
+    *
+    * If the Rig isn't running the change happens immediately. Otherwise it's
+    * queued and the update loop applies it between two frames, while the
+    * caller waits. This way patches never see a half-finished change and the
+    * loop never has to stop.
+    * \param change Function making the change.
+    * \return True if the change has been applied. False if it was queued
+    * from inside the update loop and will be applied at the next frame.
+    * \sa applyPendingChanges()
+    */
+    bool queueChange(function<void()> change);
+
+    /*!
+    * \brief Applies all queued changes. Called by the update loop between frames.
+    */
+    void applyPendingChanges();
+
+    /*!
+    * \brief Hands off an object to be freed outside of the update loop.
+    *
+    * Objects removed from the Rig may still be in use by the frame that
+    * removed them, and their destructors may be slow, so they're freed by
+    * the thread that requested the change instead.
+    * \param deleter Function freeing the object.
+    */
+    void retire(function<void()> deleter);
+
+    /*!
+    * \brief Frees everything handed to retire().
+    */
+    void collectRetired();
+
+    /*! \brief Adds a device. Must not run during a frame. \sa addDevice() */
+    void addDeviceNow(Device* device);
+
+    /*! \brief Removes a device. Must not run during a frame. \sa deleteDevice() */
+    void deleteDeviceNow(string id);
+
+    /*! \brief Adds a patch. Must not run during a frame. \sa addPatch() */
+    void addPatchNow(string id, Patch* patch);
+
+    /*! \brief Removes a patch. Must not run during a frame. \sa deletePatch() */
+    void deletePatchNow(string id);
+
+    /*! \brief Adds a function. Must not run during a frame. \sa addFunction() */
+    bool addFunctionNow(int pid, function<void()> func);
+
+    /*! \brief Removes a function. Must not run during a frame. \sa removeFunction() */
+    bool removeFunctionNow(int pid);
+
+    /*! \brief Removes a change callback. Must not run during a frame. \sa deleteChangeCallback() */
+    void deleteChangeCallbackNow(int id);
+
+#ifdef USE_ARNOLD
+    /*!
+    * \brief Tells an Arnold patch which devices changed each frame.
+    * \param id Id of the patch.
+    * \sa ArnoldPatch::onDeviceChanged()
+    */
+    void addArnoldChangeCallback(string id);
+#endif
+
+    /*!
+    * \brief Thread that runs the update loop. nullptr while stopped.
     */
     thread* m_updateLoop;
 
+    /*!
+    * \brief Id of the thread running the update loop.
+    *
+    * Set by the loop itself when it starts and cleared by stop(), so
+    * queueChange() can tell when it's called from inside the loop without
+    * touching m_updateLoop. Protected by m_changeLock.
+    */
+    thread::id m_updateThreadId;
+
     /*! \brief Indicates the status of the update loop.
     * 
     * True if running.
     */
-    bool m_running;
+    atomic<bool> m_running;
 
     /*!
     * \brief Sets the speed of the run loop in cycles/second. Default is 40.
@@ -400,29 +917,119 @@ namespace Lumiverse {
     float m_loopTime;
 
     /*!
-    * \brief Raw list of devices for sending to the Patch->update function.
+    * \brief Length of one frame of the update loop.
+    *
+    * Deadlines are computed by adding this to the previous deadline, so
+    * rounding never accumulates into drift. Set from application threads
+    * and read by the update loop once per frame.
+    * \sa m_refreshRate
+    */
+    atomic<chrono::steady_clock::duration> m_loopPeriod;
+
+    /*!
+    * \brief Time spent busy-waiting before each deadline.
+    * \sa setSpinTime()
+    */
+    atomic<chrono::microseconds> m_spinTime;
+
+    /*!
+    * \brief What the update loop does when a frame overruns.
+    * \sa setOverrunPolicy()
+    */
+    atomic<OverrunPolicy> m_overrunPolicy;
+
+    /*!
+    * \brief True if patches should be updated in parallel.
+    * \sa setParallelPatches()
+    */
+    bool m_parallelPatches;
+
+    /*!
+    * \brief Threads used to update patches in parallel.
     *
-    * This is the core list of Device objects that the Rig maintains.
-    * Indices are built off of this set as needed.
-    * \sa Device
+    * Exists only while the update loop is running with parallel patches enabled.
     */
-    set<Device *> m_devices;
+    unique_ptr<WorkerPool> m_patchPool;
 
     /*!
-    * \brief Maps Patch id to at Patch object
+    * \brief Column storage for the float and color parameters of all devices.
     *
-    * The Patch id only matters to the Rig. The Patch doesn't really care what you call it.
-    * \sa Patch
+    * Read by queries on any thread, so always accessed with atomic_load /
+    * atomic_store. Replaced stores are retired.
+    * \sa setParameterStore()
+    */
+    shared_ptr<ParameterStore> m_paramStore;
+
+    /*!
+    * \brief Published device and patch tables. Never nullptr.
+    *
+    * Read from any thread with atomic_load. Only replaced by publishTables(),
+    * so the update loop reads one version for a whole frame while application
+    * threads look devices up without locking.
+    * \sa getTables()
+    */
+    shared_ptr<const Tables> m_tables;
+
+    /*!
+    * \brief Working copy of the tables with changes not published yet.
+    *
+    * nullptr when there aren't any. Made from m_tables by the first change
+    * after a publish, so a run of changes copies the tables only once.
+    * Protected by m_applyLock.
+    */
+    shared_ptr<Tables> m_editTables;
+
+    /*! \brief True while m_editTables has changes that aren't published. */
+    atomic<bool> m_tablesDirty;
+
+    /*!
+    * \brief Deleters for objects removed since the tables were last published.
+    *
+    * Given to the Release of the published tables when they're replaced.
+    * Protected by m_applyLock.
+    */
+    vector<function<void()> > m_released;
+
+    /*!
+    * \brief Held while changes run, so only one thread changes the Rig at a time.
+    *
+    * Recursive because a change can read the tables, which may publish
+    * the working copy.
+    */
+    recursive_mutex m_applyLock;
+
+    /*!
+    * \brief Devices by metadata value, for metadata selectors.
+    *
+    * Updated by a metadata callback on every device in the rig.
+    * \sa DeviceSet::select()
+    */
+    MetadataIndex m_metadataIndex;
+
+    /*! \brief Id of the metadata callback that keeps m_metadataIndex current, by device. */
+    unordered_map<Device *, int> m_metadataCallbacks;
+
+    /*!
+    * \brief Generation of each device as of the last update loop frame.
+    *
+    * Only touched by the update loop, and cleared when devices are removed.
+    * \sa collectChangedDevices()
     */
-    map<string, Patch *> m_patches;
+    unordered_map<Device *, uint64_t> m_seenGenerations;
 
     /*!
-    * \brief Devices mapped by their device ID.
+    * \brief Front buffer of device state, mapping each device to its snapshot.
+    *
+    * Application threads write to the devices in the rig (the back buffer).
+    * At the start of each frame the update loop copies the devices that changed
+    * into these snapshots, and patches only ever read the snapshots.
+    * Owned by the Rig and only touched by the update loop.
+    * \sa commitFrame()
     */
-    map<string, Device *> m_devicesById;
+    unordered_map<Device *, Device *> m_frontBuffer;
 
-    /*! \brief Devices mapped by channel number. */
-    multimap<unsigned int, Device *> m_devicesByChannel;
+    /*! \brief Set of the snapshots in m_frontBuffer, as handed to the patches. */
+    set<Device *> m_frontDevices;
 
     /*!
     * \brief List of functions to run at the end of the update loop
@@ -441,6 +1048,85 @@ namespace Lumiverse {
     */
     map<int, function<void()> > m_updateFunctions;
 
+    /*! \brief Functions receiving the per-frame ChangeSet, by id. \sa addChangeCallback() */
+    map<int, ChangeCallbackFunction> m_changeCallbacks;
+
+    /*! \brief Id for the next change callback. */
+    atomic<int> m_nextChangeCallbackId;
+
+    /*! \brief Compiled queries, most recently used first. \sa getQueryPlan() */
+    list<shared_ptr<const QueryPlan> > m_queryPlans;
+
+    /*! \brief Index into m_queryPlans by query string. */
+    unordered_map<string, list<shared_ptr<const QueryPlan> >::iterator> m_queryPlansBySelector;
+
+    /*! \brief Maximum size of m_queryPlans. */
+    size_t m_queryCacheSize;
+
+    /*! \brief Protects the query cache. Queries can come from any thread. */
+    mutex m_queryCacheLock;
+
+    /*!
+    * \brief Live views of queries. Only touched by the update loop.
+    * \sa createView()
+    */
+    vector<weak_ptr<LiveView> > m_views;
+
+    /*!
+    * \brief Journal of parameter changes. nullptr when off.
+    *
+    * Only replaced by the update loop, but read by other threads through
+    * getChangeJournal(), so always accessed with atomic_load / atomic_store.
+    */
+    shared_ptr<ChangeJournal> m_changeJournal;
+
+    /*! \brief Changes of the current frame. Kept between frames to reuse its memory. */
+    ChangeSet m_frameChanges;
+
+    /*!
+    * \brief Changes waiting to be applied between frames.
+    * \sa queueChange()
+    */
+    vector<function<void()> > m_pendingChanges;
+
+    /*! \brief Deleters for objects removed from the Rig. \sa retire() */
+    vector<function<void()> > m_retired;
+
+    /*! \brief Number of changes ever queued. Used as a ticket by waiting callers. */
+    uint64_t m_changesQueued;
+
+    /*! \brief Number of changes ever applied. */
+    uint64_t m_changesApplied;
+
+    /*! \brief Protects the pending changes and retired objects. */
+    mutex m_changeLock;
+
+    /*! \brief Signals callers that queued changes have been applied. */
+    condition_variable m_changesDone;
+
+    /*! \brief Timing of entire update loop frames. */
+    TimingHistogram m_frameTiming;
+
+    /*!
+    * \brief Timing of each additional function, by pid.
+    *
+    * Entries are created and removed along with the functions, between
+    * frames, so the update loop reads this map without locking.
+    * \sa m_timingLock
+    */
+    map<int, shared_ptr<TimingHistogram> > m_functionTimings;
+
+    /*! \brief Timing of each patch update, by patch id. \sa m_timingLock */
+    map<string, shared_ptr<TimingHistogram> > m_patchTimings;
+
+    /*!
+    * \brief Protects m_functionTimings and m_patchTimings.
+    *
+    * Held while the maps are changed and while other threads read them.
+    * The histograms themselves are lock-free.
+    */
+    mutex m_timingLock;
+
     // May have more indicies in the future, like mapping by channel number.
   };
 }
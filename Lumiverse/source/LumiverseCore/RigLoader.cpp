@@ -0,0 +1,188 @@
+#include "RigLoader.h"
+#include "WorkerPool.h"
+
+#include <thread>
+#include <stdexcept>
+
+namespace Lumiverse {
+
+// Scanner helpers. Each takes the current position and returns the position
+// after whatever it consumed, or nullptr on a syntax error or end of text.
+
+static const char* skipSpace(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    p++;
+
+  return p;
+}
+
+// p points at the opening quote. If out isn't null the unescaped string is stored in it.
+static const char* scanString(const char* p, const char* end, string* out) {
+  p++;
+
+  while (p < end && *p != '"') {
+    char c = *p;
+
+    if (c == '\\') {
+      p++;
+      if (p >= end)
+        return nullptr;
+
+      switch (*p) {
+        case '"': c = '"'; break;
+        case '\\': c = '\\'; break;
+        case '/': c = '/'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        default:
+          // Unicode escapes in names are left to libjson.
+          if (out != nullptr)
+            return nullptr;
+      }
+    }
+
+    if (out != nullptr)
+      out->push_back(c);
+    p++;
+  }
+
+  return (p < end) ? p + 1 : nullptr;
+}
+
+static const char* skipValue(const char* p, const char* end) {
+  if (p >= end)
+    return nullptr;
+
+  if (*p == '"')
+    return scanString(p, end, nullptr);
+
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+
+    while (p < end) {
+      char c = *p;
+
+      if (c == '"') {
+        p = scanString(p, end, nullptr);
+        if (p == nullptr)
+          return nullptr;
+        continue;
+      }
+      else if (c == '{' || c == '[') {
+        depth++;
+      }
+      else if (c == '}' || c == ']') {
+        if (--depth == 0)
+          return p + 1;
+      }
+      else if (c == '/' || c == '#') {
+        // Comments. libjson allows them, we don't.
+        return nullptr;
+      }
+
+      p++;
+    }
+
+    return nullptr;
+  }
+
+  // Number, true, false or null
+  const char* start = p;
+  while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+         *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+    if (*p == '/' || *p == '#')
+      return nullptr;
+    p++;
+  }
+
+  return (p > start) ? p : nullptr;
+}
+
+bool RigLoader::split(const char* begin, const char* end, vector<Member>& members) {
+  const char* p = skipSpace(begin, end);
+  if (p >= end || *p != '{')
+    return false;
+
+  p = skipSpace(p + 1, end);
+  if (p < end && *p == '}')
+    return true;
+
+  while (p < end) {
+    if (*p != '"')
+      return false;
+
+    Member m;
+    p = scanString(p, end, &m.name);
+    if (p == nullptr)
+      return false;
+
+    p = skipSpace(p, end);
+    if (p >= end || *p != ':')
+      return false;
+
+    m.begin = skipSpace(p + 1, end);
+    m.end = skipValue(m.begin, end);
+    if (m.end == nullptr)
+      return false;
+
+    members.push_back(m);
+
+    p = skipSpace(m.end, end);
+    if (p >= end)
+      return false;
+
+    if (*p == '}')
+      return true;
+    if (*p != ',')
+      return false;
+
+    p = skipSpace(p + 1, end);
+  }
+
+  return false;
+}
+
+vector<Device*> RigLoader::loadDevices(const vector<Member>& devices) {
+  vector<Device*> loaded(devices.size(), nullptr);
+  if (devices.empty())
+    return loaded;
+
+  unsigned int cores = thread::hardware_concurrency();
+  unsigned int workers = (cores > 1) ? cores - 1 : 0;
+
+  // A few chunks per thread keeps the threads busy when devices differ in size.
+  size_t numChunks = (workers + 1) * 4;
+  size_t chunkSize = (devices.size() + numChunks - 1) / numChunks;
+
+  vector<function<void()> > jobs;
+  for (size_t start = 0; start < devices.size(); start += chunkSize) {
+    size_t stop = (start + chunkSize < devices.size()) ? start + chunkSize : devices.size();
+
+    jobs.push_back([&devices, &loaded, start, stop]() {
+      for (size_t i = start; i < stop; i++) {
+        const Member& m = devices[i];
+
+        try {
+          // Each device gets its own DOM so threads never share nodes.
+          JSONNode node = libjson::parse(string(m.begin, m.end));
+          loaded[i] = new Device(m.name, node);
+        }
+        catch (const std::exception&) {
+          stringstream ss;
+          ss << "Unable to parse Device " << m.name << ". Device not loaded.";
+          Logger::log(ERR, ss.str());
+        }
+      }
+    });
+  }
+
+  WorkerPool pool(workers);
+  pool.run(jobs);
+
+  return loaded;
+}
+
+}
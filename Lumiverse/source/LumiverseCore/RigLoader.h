@@ -0,0 +1,69 @@
+/*! \file RigLoader.h
+* \brief Fast loading path for large rig files.
+*/
+#ifndef _RIGLOADER_H_
+#define _RIGLOADER_H_
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Device.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Loads the devices of a rig file without parsing the whole file into one DOM.
+  *
+  * The file text is scanned once to find where each member of the top level
+  * object and of the `devices` object starts and ends. Nothing is parsed during
+  * the scan. Each device is then parsed and built on its own, in parallel, so
+  * no JSONNode is ever shared between threads and the DOM for the whole file
+  * never exists.
+  *
+  * The scanner only handles plain JSON. Rig::load() falls back to parsing the
+  * whole file when split() fails (comments in the file, for example).
+  * \sa Rig::load()
+  */
+  class RigLoader
+  {
+  public:
+    /*!
+    * \brief One `"name": value` member of a JSON object.
+    */
+    struct Member {
+      /*! \brief Name of the member. */
+      string name;
+
+      /*! \brief Start of the value text. */
+      const char* begin;
+
+      /*! \brief One past the end of the value text. */
+      const char* end;
+    };
+
+    /*!
+    * \brief Splits the text of a JSON object into its members.
+    *
+    * Values aren't parsed, only skipped over.
+    * \param begin Start of the text. Leading whitespace is fine.
+    * \param end One past the end of the text.
+    * \param[out] members Members of the object, in file order.
+    * \return False if the text isn't an object the scanner understands.
+    */
+    static bool split(const char* begin, const char* end, vector<Member>& members);
+
+    /*!
+    * \brief Builds devices from the members of a `devices` object.
+    *
+    * Devices are built on all available cores. A device that fails to parse
+    * is logged and left out.
+    * \param devices Members from split(). The member name is the device id.
+    * \return The devices, in the same order as `devices`.
+    */
+    static vector<Device*> loadDevices(const vector<Member>& devices);
+  };
+}
+#endif
@@ -144,6 +144,12 @@ namespace Lumiverse {
     */
 	virtual void update(set<Device *> devices) override;
 
+    /*!
+    * \brief Same as update(). Every frame sent to the worker needs a full
+    * copy of the connected devices, so the changed set isn't used.
+    */
+	virtual void updateChanged(const set<Device *>& devices, const set<Device *>& /*changed*/) override { update(devices); }
+
     /*!
     * \brief Waits for the worker thread and closes the Arnold session.
     *
@@ -118,24 +118,24 @@ void ArnoldPatch::loadLight(Device *d_ptr) {
     // Sets arnold params with device params
     // This process is after parsing metadata, so parameters here can overwrite values from metadata
     for (std::string param : d_ptr->getParamNames()) {
-        LumiverseType *raw = d_ptr->getParam(param);
+        LumiverseType *raw = d_ptr->readParam(param);
         
         // First parse lumiverse type into string. So we can reuse the function for metadata.
         // It's obviously inefficient.
-        if (raw->getTypeName() == "float") {
+        if (raw->getTypeTag() == LumiverseType::FLOAT) {
             m_interface.setParameter(light_ptr, param, ((LumiverseFloat*)raw)->asString());
         }
-        else if (raw->getTypeName() == "color") {
+        else if (raw->getTypeTag() == LumiverseType::COLOR) {
             Eigen::Vector3d rgb = ((LumiverseColor*)raw)->getRGB();
             std::stringstream ss;
             ss << rgb[0] << ", " << rgb[1] << ", " << rgb[2];
             m_interface.setParameter(light_ptr, param, ss.str());
         }
 		// Assume pan and tilt are named as "pan" and "tilt"
-		else if (raw->getTypeName() == "orientation" &&
+		else if (raw->getTypeTag() == LumiverseType::ORIENTATION &&
 				param == "tilt") {
 			LumiverseOrientation *tilt = (LumiverseOrientation*)raw;
-			LumiverseOrientation *pan = (LumiverseOrientation*)d_ptr->getParam("pan");
+			LumiverseOrientation *pan = (LumiverseOrientation*)d_ptr->readParam("pan");
 
 			if (pan == NULL)
 				continue;
@@ -257,6 +257,29 @@ void ArnoldPatch::update(set<Device *> devices) {
     m_renderloop = new std::thread(&ArnoldPatch::renderLoop, this);
 }
 
+void ArnoldPatch::updateChanged(const set<Device *>& devices, const set<Device *>& changed) {
+	set<Device *> toLoad;
+
+	for (Device* d : devices) {
+		auto light = m_lights.find(d->getId());
+		if (light == m_lights.end())
+			continue;
+
+		if (light->second.rerender_req || changed.count(d) > 0)
+			toLoad.insert(d);
+	}
+
+	if (toLoad.empty()) {
+		return ;
+	}
+	updateLight(toLoad);
+	clearUpdateFlags();
+
+	interruptRender();
+
+	m_renderloop = new std::thread(&ArnoldPatch::renderLoop, this);
+}
+
 void ArnoldPatch::init() {
     m_interface.init();
 }
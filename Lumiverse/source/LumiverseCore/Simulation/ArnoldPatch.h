@@ -74,6 +74,14 @@ namespace Lumiverse {
     */
     virtual void update(set<Device *> devices);
 
+    /*!
+    * \brief Reloads only the lights whose devices changed, then rerenders.
+    *
+    * Lights still flagged by onDeviceChanged() are reloaded as well.
+    * \sa Patch::updateChanged()
+    */
+    virtual void updateChanged(const set<Device *>& devices, const set<Device *>& changed);
+
     /*!
     * \brief Initializes Arnold with ArnoldInterface.
     */
@@ -141,9 +149,10 @@ namespace Lumiverse {
     /*!
     * \brief Callback function for devices.
     *
-    * This function is registered to all devices by the rig. Only devices in the list
-    * will change the state of patch.
-    * \param d The device which calls this function.
+    * The rig calls this once per frame for each device that changed, before
+    * the patch updates. Only devices in the list will change the state of patch.
+    * \param d The device that changed.
+    * \sa Rig::addChangeCallback()
     */
     void onDeviceChanged(Device *d);
       
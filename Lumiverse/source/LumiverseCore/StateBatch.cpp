@@ -0,0 +1,39 @@
+#include "StateBatch.h"
+#include "Device.h"
+
+#include <algorithm>
+
+namespace Lumiverse {
+
+bool StateBatch::add(DeviceHandle device, ParamHandle param, LumiverseType* value) {
+  Entry e;
+  e.device = device;
+  e.param = param;
+  e.value = value;
+
+  e.type = value->getTypeTag();
+  if (e.type == LumiverseType::OTHER)
+    return false;
+
+  // Entries are almost always added a device at a time, so this is normally a push_back.
+  auto pos = upper_bound(m_entries.begin(), m_entries.end(), e,
+    [](const Entry& lhs, const Entry& rhs) { return lhs.device < rhs.device; });
+  m_entries.insert(pos, e);
+
+  return true;
+}
+
+void StateBatch::addDevice(Device* source) {
+  for (const auto& name : source->getParamNames()) {
+    LumiverseType* value = source->readParam(name);
+
+    if (!add(source->getHandle(), getParamHandle(name), value)) {
+      stringstream ss;
+      ss << "Parameter " << name << " of " << source->getId() << " has type "
+         << value->getTypeName() << " which can't be added to a state batch.";
+      Logger::log(WARN, ss.str());
+    }
+  }
+}
+
+}
@@ -0,0 +1,73 @@
+/*! \file StateBatch.h
+* \brief Pre-resolved list of parameter values to write into a Rig.
+*/
+#ifndef _STATEBATCH_H_
+#define _STATEBATCH_H_
+
+#pragma once
+
+#include <vector>
+
+#include "Interner.h"
+#include "LumiverseType.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  class Device;
+
+  /*!
+  * \brief A list of (device, parameter, value) entries that Rig::applyState()
+  * copies into the rig in one pass.
+  *
+  * Everything that costs string work is done when the batch is built:
+  * devices and parameters are stored as handles and each value's type is
+  * recorded once. The batch doesn't own the values, it points at them, so a
+  * batch can be built once and applied every frame while the values it points
+  * to change. Entries are kept grouped by device so each device gets a single
+  * parameter changed notification per apply.
+  * \sa Rig::applyState()
+  */
+  class StateBatch
+  {
+  public:
+    /*! \brief One parameter value to write. */
+    struct Entry {
+      DeviceHandle device;
+      ParamHandle param;
+      LumiverseType::TypeTag type;
+      LumiverseType* value;
+    };
+
+    /*!
+    * \brief Adds a value to the batch.
+    * \param device Handle of the device to write to.
+    * \param param Handle of the parameter to write to.
+    * \param value Value to copy. Must outlive the batch.
+    * \return False if the value has a type the batch can't copy.
+    */
+    bool add(DeviceHandle device, ParamHandle param, LumiverseType* value);
+
+    /*!
+    * \brief Adds every parameter of a device to the batch.
+    *
+    * The values are written to the rig device with the same id as source.
+    * \param source Device holding the values. Must outlive the batch.
+    */
+    void addDevice(Device* source);
+
+    /*! \brief Removes all entries. */
+    void clear() { m_entries.clear(); }
+
+    /*! \brief Gets the entries, grouped by device handle. */
+    const vector<Entry>& getEntries() const { return m_entries; }
+
+    /*! \brief Gets the number of entries. */
+    size_t size() const { return m_entries.size(); }
+
+  private:
+    /*! \brief Entries, sorted by device handle. */
+    vector<Entry> m_entries;
+  };
+}
+#endif
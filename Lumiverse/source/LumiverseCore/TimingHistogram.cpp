@@ -0,0 +1,115 @@
+#include "TimingHistogram.h"
+
+namespace Lumiverse {
+
+TimingHistogram::TimingHistogram() {
+  reset();
+}
+
+void TimingHistogram::record(chrono::nanoseconds duration, bool overrun) {
+  uint64_t ns = (duration.count() < 0) ? 0 : (uint64_t)duration.count();
+
+  m_buckets[bucketFor(ns / 1000)].fetch_add(1, memory_order_relaxed);
+  m_count.fetch_add(1, memory_order_relaxed);
+  m_total.fetch_add(ns, memory_order_relaxed);
+
+  if (overrun)
+    m_overruns.fetch_add(1, memory_order_relaxed);
+
+  uint64_t max = m_max.load(memory_order_relaxed);
+  while (ns > max && !m_max.compare_exchange_weak(max, ns, memory_order_relaxed));
+}
+
+void TimingHistogram::reset() {
+  for (unsigned int i = 0; i < numBuckets; i++) {
+    m_buckets[i].store(0, memory_order_relaxed);
+  }
+
+  m_count.store(0, memory_order_relaxed);
+  m_overruns.store(0, memory_order_relaxed);
+  m_total.store(0, memory_order_relaxed);
+  m_max.store(0, memory_order_relaxed);
+}
+
+float TimingHistogram::getMax() const {
+  return m_max.load(memory_order_relaxed) / 1e6f;
+}
+
+float TimingHistogram::getMean() const {
+  uint64_t count = getCount();
+  if (count == 0)
+    return 0;
+
+  return (float)((double)m_total.load(memory_order_relaxed) / count / 1e6);
+}
+
+float TimingHistogram::getPercentile(float p) const {
+  // Bucket counts are read one at a time, so the total is taken from the
+  // buckets themselves to stay consistent with what we're scanning.
+  uint64_t counts[numBuckets];
+  uint64_t total = 0;
+  for (unsigned int i = 0; i < numBuckets; i++) {
+    counts[i] = m_buckets[i].load(memory_order_relaxed);
+    total += counts[i];
+  }
+
+  if (total == 0)
+    return 0;
+
+  p = (p < 0) ? 0 : ((p > 1) ? 1 : p);
+  uint64_t rank = (uint64_t)(p * (total - 1)) + 1;
+
+  uint64_t seen = 0;
+  for (unsigned int i = 0; i < numBuckets; i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      // The bucket bound can overshoot the largest actual sample.
+      float limit = bucketLimit(i) / 1000.0f;
+      float max = getMax();
+      return (limit < max) ? limit : max;
+    }
+  }
+
+  return getMax();
+}
+
+JSONNode TimingHistogram::toJSON() const {
+  JSONNode node;
+
+  node.push_back(JSONNode("count", (unsigned long)getCount()));
+  node.push_back(JSONNode("overruns", (unsigned long)getOverruns()));
+  node.push_back(JSONNode("mean", getMean()));
+  node.push_back(JSONNode("p50", getPercentile(0.5f)));
+  node.push_back(JSONNode("p99", getPercentile(0.99f)));
+  node.push_back(JSONNode("max", getMax()));
+
+  return node;
+}
+
+unsigned int TimingHistogram::bucketFor(uint64_t us) {
+  if (us < 32)
+    return (unsigned int)us;
+
+  // Position of the highest set bit. At least 5 here.
+  unsigned int msb = 0;
+  for (uint64_t v = us; v > 1; v >>= 1) {
+    msb++;
+  }
+
+  unsigned int sub = (unsigned int)((us >> (msb - 4)) & 15);
+  unsigned int bucket = 32 + (msb - 5) * 16 + sub;
+
+  return (bucket < numBuckets) ? bucket : numBuckets - 1;
+}
+
+uint64_t TimingHistogram::bucketLimit(unsigned int bucket) {
+  if (bucket < 32)
+    return bucket + 1;
+
+  unsigned int msb = (bucket - 32) / 16 + 5;
+  uint64_t sub = (bucket - 32) % 16;
+
+  return (16 + sub + 1) << (msb - 4);
+}
+
+}
@@ -0,0 +1,100 @@
+/*! \file TimingHistogram.h
+* \brief Lock-free histogram for recording update loop timings.
+*/
+#ifndef _TIMINGHISTOGRAM_H_
+#define _TIMINGHISTOGRAM_H_
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "lib/libjson/libjson.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Records durations into a fixed set of buckets.
+  *
+  * Used by the Rig to track how long each stage of the update loop takes.
+  * Recording only touches atomics, so the update thread can write samples
+  * while other threads read statistics without any locking.
+  *
+  * Buckets are 1us wide below 32us. Above that, each power of two is split
+  * into 16 buckets, so reported percentiles are within about 6% of the
+  * recorded value.
+  */
+  class TimingHistogram
+  {
+  public:
+    /*! \brief Number of buckets in the histogram. Covers up to about 2^32 us. */
+    static const unsigned int numBuckets = 32 + 27 * 16;
+
+    /*! \brief Makes an empty histogram. */
+    TimingHistogram();
+
+    /*!
+    * \brief Records a sample.
+    *
+    * \param duration Time taken by the stage.
+    * \param overrun Set to true if the sample exceeded its frame budget.
+    */
+    void record(chrono::nanoseconds duration, bool overrun = false);
+
+    /*! \brief Clears all recorded samples. */
+    void reset();
+
+    /*! \brief Gets the number of samples recorded. */
+    uint64_t getCount() const { return m_count.load(memory_order_relaxed); }
+
+    /*! \brief Gets the number of samples recorded as overruns. */
+    uint64_t getOverruns() const { return m_overruns.load(memory_order_relaxed); }
+
+    /*! \brief Gets the largest sample recorded in ms. */
+    float getMax() const;
+
+    /*! \brief Gets the mean of all samples in ms. */
+    float getMean() const;
+
+    /*!
+    * \brief Gets a percentile of the recorded samples.
+    *
+    * \param p Percentile to get, between 0 and 1.
+    * \return Upper bound of the bucket containing the percentile in ms.
+    * Returns 0 if nothing has been recorded.
+    */
+    float getPercentile(float p) const;
+
+    /*!
+    * \brief Gets the JSON summary of the histogram.
+    *
+    * Contains count, overruns, mean, p50, p99 and max. Times are in ms.
+    */
+    JSONNode toJSON() const;
+
+  private:
+    /*! \brief Gets the bucket a sample in microseconds belongs to. */
+    static unsigned int bucketFor(uint64_t us);
+
+    /*! \brief Gets the upper bound of a bucket in microseconds. */
+    static uint64_t bucketLimit(unsigned int bucket);
+
+    /*! \brief Sample counts for each bucket. */
+    atomic<uint64_t> m_buckets[numBuckets];
+
+    /*! \brief Total samples recorded. */
+    atomic<uint64_t> m_count;
+
+    /*! \brief Samples recorded as overruns. */
+    atomic<uint64_t> m_overruns;
+
+    /*! \brief Sum of all samples in ns. */
+    atomic<uint64_t> m_total;
+
+    /*! \brief Largest sample in ns. */
+    atomic<uint64_t> m_max;
+  };
+}
+#endif
@@ -0,0 +1,70 @@
+#include "WorkerPool.h"
+
+namespace Lumiverse {
+
+WorkerPool::WorkerPool(unsigned int numWorkers) {
+  m_next = 0;
+  m_remaining = 0;
+  m_shutdown = false;
+
+  for (unsigned int i = 0; i < numWorkers; i++) {
+    m_workers.push_back(thread(&WorkerPool::work, this));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    lock_guard<mutex> lock(m_lock);
+    m_shutdown = true;
+  }
+  m_wake.notify_all();
+
+  for (auto& t : m_workers) {
+    t.join();
+  }
+}
+
+void WorkerPool::run(const vector<function<void()> >& jobs) {
+  if (jobs.empty())
+    return;
+
+  unique_lock<mutex> lock(m_lock);
+  m_jobs = jobs;
+  m_next = 0;
+  m_remaining = m_jobs.size();
+  m_wake.notify_all();
+
+  // Help out instead of just waiting.
+  while (m_next < m_jobs.size()) {
+    size_t i = m_next++;
+    lock.unlock();
+    m_jobs[i]();
+    lock.lock();
+    m_remaining--;
+  }
+
+  m_done.wait(lock, [this]() { return m_remaining == 0; });
+  m_jobs.clear();
+  m_next = 0;
+}
+
+void WorkerPool::work() {
+  unique_lock<mutex> lock(m_lock);
+
+  while (true) {
+    m_wake.wait(lock, [this]() { return m_shutdown || m_next < m_jobs.size(); });
+
+    if (m_shutdown)
+      return;
+
+    size_t i = m_next++;
+    lock.unlock();
+    m_jobs[i]();
+    lock.lock();
+
+    if (--m_remaining == 0)
+      m_done.notify_all();
+  }
+}
+
+}
@@ -0,0 +1,84 @@
+/*! \file WorkerPool.h
+* \brief Fixed-size pool of threads for running batches of jobs.
+*/
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Runs batches of jobs on a fixed set of threads.
+  *
+  * Each call to run() hands out a batch of jobs to the workers and
+  * blocks until all of them are finished, so every batch acts as a barrier.
+  * The calling thread works on the batch too, so a pool with 0 workers
+  * simply runs the jobs serially.
+  *
+  * Only one thread should call run() at a time.
+  */
+  class WorkerPool
+  {
+  public:
+    /*!
+    * \brief Starts the worker threads.
+    * \param numWorkers Number of threads to start in addition to the caller.
+    */
+    WorkerPool(unsigned int numWorkers);
+
+    /*!
+    * \brief Stops and joins all worker threads.
+    */
+    ~WorkerPool();
+
+    /*!
+    * \brief Runs all jobs and waits for them to finish.
+    *
+    * Jobs may run in any order and on any thread.
+    * \param jobs Jobs to run.
+    */
+    void run(const vector<function<void()> >& jobs);
+
+    /*!
+    * \brief Gets the number of worker threads, not counting the caller.
+    */
+    unsigned int getNumWorkers() { return (unsigned int)m_workers.size(); }
+
+  private:
+    /*! \brief Loop run by each worker thread. */
+    void work();
+
+    /*! \brief Worker threads. */
+    vector<thread> m_workers;
+
+    /*! \brief Jobs in the current batch. */
+    vector<function<void()> > m_jobs;
+
+    /*! \brief Index of the next job to hand out. */
+    size_t m_next;
+
+    /*! \brief Number of jobs in the current batch that haven't finished. */
+    size_t m_remaining;
+
+    /*! \brief Set when the pool is shutting down. */
+    bool m_shutdown;
+
+    /*! \brief Protects the batch state. */
+    mutex m_lock;
+
+    /*! \brief Signals workers that jobs are available or the pool is shutting down. */
+    condition_variable m_wake;
+
+    /*! \brief Signals the caller that the batch is finished. */
+    condition_variable m_done;
+  };
+}
+#endif
@@ -0,0 +1,598 @@
+#include "ChromaSolver.h"
+#include "../Logger.h"
+#include "lib/clp/ClpSimplex.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <sstream>
+
+namespace Lumiverse {
+
+// Bounds of the lookup table grid. The spectral locus fits in
+// x in [0, 0.75] and y in [0, 0.85].
+static const double lookupMaxX = 0.75;
+static const double lookupMaxY = 0.85;
+
+// Bounds checks on dense solver weights, which are in [0, 1].
+static const double denseTolerance = 1e-9;
+
+static atomic<unsigned int>& lookupResolution() {
+  static atomic<unsigned int> resolution(0);
+  return resolution;
+}
+
+// Every solver handed out by get(). Layouts hold the only strong references.
+static mutex& solversLock() {
+  static mutex lock;
+  return lock;
+}
+
+static vector<weak_ptr<ChromaSolver> >& solvers() {
+  static vector<weak_ptr<ChromaSolver> > all;
+  return all;
+}
+
+// Inverts the top left k x k of m, k being 2 or 3.
+// Returns false if it's singular next to scale, the largest coefficient.
+static bool invertSmall(unsigned int k, const double m[3][3], double inv[3][3], double scale) {
+  if (k == 2) {
+    double det = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    if (fabs(det) <= 1e-12 * scale * scale)
+      return false;
+
+    inv[0][0] = m[1][1] / det;
+    inv[0][1] = -m[0][1] / det;
+    inv[1][0] = -m[1][0] / det;
+    inv[1][1] = m[0][0] / det;
+    return true;
+  }
+
+  double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+  double c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+  double c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+  double det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+  if (fabs(det) <= 1e-12 * scale * scale * scale)
+    return false;
+
+  inv[0][0] = c00 / det;
+  inv[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) / det;
+  inv[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) / det;
+  inv[1][0] = c01 / det;
+  inv[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / det;
+  inv[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) / det;
+  inv[2][0] = c02 / det;
+  inv[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) / det;
+  inv[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / det;
+  return true;
+}
+
+// Solves m l = (1, 1, 1) for the top left k x k of m, k being 2 or 3, by
+// Cramer's rule. Returns false if m is singular next to scale.
+static bool solveOnes(unsigned int k, const double m[3][3], double* l, double scale) {
+  if (k == 2) {
+    double det = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    if (fabs(det) <= 1e-12 * scale * scale)
+      return false;
+
+    double invDet = 1 / det;
+    l[0] = (m[1][1] - m[0][1]) * invDet;
+    l[1] = (m[0][0] - m[1][0]) * invDet;
+    return true;
+  }
+
+  double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+  double c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+  double c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+  double det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+  if (fabs(det) <= 1e-12 * scale * scale * scale)
+    return false;
+
+  // Differences of rows, shared by the three replaced determinants.
+  double d10[3] = { m[1][0] - m[0][0], m[1][1] - m[0][1], m[1][2] - m[0][2] };
+  double d20[3] = { m[2][0] - m[0][0], m[2][1] - m[0][1], m[2][2] - m[0][2] };
+
+  double invDet = 1 / det;
+  l[0] = (d10[1] * d20[2] - d10[2] * d20[1]) * invDet;
+  l[1] = (d10[2] * d20[0] - d10[0] * d20[2]) * invDet;
+  l[2] = (d10[0] * d20[1] - d10[1] * d20[0]) * invDet;
+  return true;
+}
+
+static unsigned int countBits(unsigned int v) {
+  unsigned int count = 0;
+  for (; v != 0; v &= v - 1) {
+    count++;
+  }
+  return count;
+}
+
+shared_ptr<ChromaSolver> ChromaSolver::get(const map<string, Eigen::Vector3d>& basis) {
+  lock_guard<mutex> lock(solversLock());
+  auto& all = solvers();
+
+  for (auto it = all.begin(); it != all.end();) {
+    shared_ptr<ChromaSolver> solver = it->lock();
+    if (solver == nullptr) {
+      it = all.erase(it);
+      continue;
+    }
+
+    if (solver->m_basisMap == basis)
+      return solver;
+
+    it++;
+  }
+
+  shared_ptr<ChromaSolver> solver(new ChromaSolver(basis));
+  all.push_back(solver);
+  return solver;
+}
+
+void ChromaSolver::setLookupResolution(unsigned int resolution) {
+  lookupResolution() = resolution;
+}
+
+unsigned int ChromaSolver::getLookupResolution() {
+  return lookupResolution();
+}
+
+ChromaSolver::ChromaSolver(const map<string, Eigen::Vector3d>& basis) :
+  m_basisMap(basis), m_model(nullptr), m_lookupResolution(0)
+{
+  for (const auto& kvp : m_basisMap) {
+    m_basis.push_back(kvp.second);
+  }
+}
+
+ChromaSolver::~ChromaSolver() {
+  delete m_model;
+}
+
+const unsigned int ChromaSolver::MaxDense;
+
+// Finds the best vertex of a w = b, 0 <= w <= 1 by trying all of them.
+// Returns the sum of the weights, or best if nothing beats it.
+static double searchVertices(unsigned int n, unsigned int k, const double a[3][ChromaSolver::MaxDense],
+  const double b[3], double scale, double best, double* weights)
+{
+  // Every vertex has at most k weights strictly inside (0, 1). Call those
+  // basic, pick each set of k of them, and try every 0/1 setting of the rest.
+  for (unsigned int basicMask = 0; basicMask < (1u << n); basicMask++) {
+    if (countBits(basicMask) != k)
+      continue;
+
+    unsigned int basic[3];
+    unsigned int nonbasic[ChromaSolver::MaxDense];
+    unsigned int numBasic = 0;
+    unsigned int numNonbasic = 0;
+
+    for (unsigned int i = 0; i < n; i++) {
+      if (basicMask & (1u << i))
+        basic[numBasic++] = i;
+      else
+        nonbasic[numNonbasic++] = i;
+    }
+
+    double m[3][3];
+    double inv[3][3];
+    for (unsigned int r = 0; r < k; r++) {
+      for (unsigned int c = 0; c < k; c++) {
+        m[r][c] = a[r][basic[c]];
+      }
+    }
+
+    if (!invertSmall(k, m, inv, scale))
+      continue;
+
+    // rhs[ones] = b - (columns of the nonbasic weights set to 1). Each entry
+    // is the one without its lowest bit, minus that column.
+    double rhs[1 << (ChromaSolver::MaxDense - 2)][3];
+    for (unsigned int r = 0; r < k; r++) {
+      rhs[0][r] = b[r];
+    }
+
+    for (unsigned int ones = 0; ones < (1u << numNonbasic); ones++) {
+      if (ones != 0) {
+        unsigned int prev = ones & (ones - 1);
+        unsigned int low = 0;
+        while (!(ones & (1u << low))) {
+          low++;
+        }
+
+        for (unsigned int r = 0; r < k; r++) {
+          rhs[ones][r] = rhs[prev][r] - a[r][nonbasic[low]];
+        }
+      }
+
+      double w[3];
+      double objective = countBits(ones);
+      bool feasible = true;
+
+      for (unsigned int c = 0; c < k; c++) {
+        w[c] = 0;
+        for (unsigned int r = 0; r < k; r++) {
+          w[c] += inv[c][r] * rhs[ones][r];
+        }
+
+        feasible &= (w[c] >= -denseTolerance && w[c] <= 1 + denseTolerance);
+        objective += w[c];
+      }
+
+      if (!feasible || objective <= best + denseTolerance)
+        continue;
+
+      best = objective;
+      for (unsigned int i = 0; i < numNonbasic; i++) {
+        weights[nonbasic[i]] = (ones & (1u << i)) ? 1 : 0;
+      }
+      for (unsigned int c = 0; c < k; c++) {
+        weights[basic[c]] = min(max(w[c], 0.0), 1.0);
+      }
+    }
+  }
+
+  return best;
+}
+
+// Finds the weights through the dual of the problem,
+//   min over l of  l . b + sum of max(0, 1 - l . a_i)
+// whose minimum is at a point where K of the planes l . a_i = 1 meet. There,
+// weights are 1 where 1 - l . a_i > 0 and 0 where it's < 0, and the K on the
+// planes solve the constraints. Returns false if that doesn't give a valid
+// solution, which happens when more than K planes meet at the minimum or
+// there is no solution at all.
+template <unsigned int K>
+static bool searchDual(unsigned int n, const double a[3][ChromaSolver::MaxDense],
+  const double b[3], double scale, double* weights)
+{
+  const unsigned int k = K;
+  double bestDual = DBL_MAX;
+  double bestLambda[3];
+  unsigned int bestBasic[3];
+
+  auto tryPlanes = [&](const unsigned int* basic) {
+    double m[3][3];
+    for (unsigned int r = 0; r < K; r++) {
+      for (unsigned int c = 0; c < K; c++) {
+        m[r][c] = a[c][basic[r]];
+      }
+    }
+
+    // l solves a_basic . l = 1.
+    double lambda[3];
+    if (!solveOnes(K, m, lambda, scale))
+      return;
+
+    double dual = 0;
+    for (unsigned int r = 0; r < K; r++) {
+      dual += lambda[r] * b[r];
+    }
+
+    for (unsigned int i = 0; i < n; i++) {
+      double slack = 1;
+      for (unsigned int r = 0; r < K; r++) {
+        slack -= lambda[r] * a[r][i];
+      }
+      dual += max(slack, 0.0);
+    }
+
+    if (dual < bestDual) {
+      bestDual = dual;
+      copy(lambda, lambda + K, bestLambda);
+      copy(basic, basic + K, bestBasic);
+    }
+  };
+
+  // Every set of K planes
+  for (unsigned int i = 0; i < n; i++) {
+    for (unsigned int j = i + 1; j < n; j++) {
+      if (K == 2) {
+        unsigned int basic[3] = { i, j, 0 };
+        tryPlanes(basic);
+        continue;
+      }
+
+      for (unsigned int l = j + 1; l < n; l++) {
+        unsigned int basic[3] = { i, j, l };
+        tryPlanes(basic);
+      }
+    }
+  }
+
+  if (bestDual == DBL_MAX)
+    return false;
+
+  // Weights off the planes are 0 or 1 depending on the side they're on.
+  double result[ChromaSolver::MaxDense];
+  double rhs[3];
+  copy(b, b + k, rhs);
+  unsigned int next = 0;
+
+  for (unsigned int i = 0; i < n; i++) {
+    if (next < k && bestBasic[next] == i) {
+      next++;
+      continue;
+    }
+
+    double slack = 1;
+    for (unsigned int r = 0; r < k; r++) {
+      slack -= bestLambda[r] * a[r][i];
+    }
+
+    // Another plane through the same point. Can't tell which side it belongs on.
+    if (fabs(slack) <= denseTolerance)
+      return false;
+
+    result[i] = (slack > 0) ? 1 : 0;
+    if (slack > 0) {
+      for (unsigned int r = 0; r < k; r++) {
+        rhs[r] -= a[r][i];
+      }
+    }
+  }
+
+  // The weights on the planes solve the constraints.
+  double m[3][3];
+  double inv[3][3];
+  for (unsigned int r = 0; r < k; r++) {
+    for (unsigned int c = 0; c < k; c++) {
+      m[r][c] = a[r][bestBasic[c]];
+    }
+  }
+
+  if (!invertSmall(k, m, inv, scale))
+    return false;
+
+  for (unsigned int c = 0; c < k; c++) {
+    double w = 0;
+    for (unsigned int r = 0; r < k; r++) {
+      w += inv[c][r] * rhs[r];
+    }
+
+    if (w < -denseTolerance || w > 1 + denseTolerance)
+      return false;
+
+    result[bestBasic[c]] = min(max(w, 0.0), 1.0);
+  }
+
+  copy(result, result + n, weights);
+  return true;
+}
+
+
+bool ChromaSolver::solve(double x, double y, double* weights) {
+  if (size() >= 2 && size() <= MaxDense)
+    return solveDense(x, y, 0, false, weights);
+
+  lock_guard<mutex> lock(m_lock);
+
+  unsigned int resolution = lookupResolution();
+  if (resolution == 0)
+    return solveExact(x, y, 0, false, weights);
+
+  if (resolution != m_lookupResolution)
+    buildLookup(resolution);
+
+  if (solveLookup(x, y, weights))
+    return true;
+
+  return solveExact(x, y, 0, false, weights);
+}
+
+bool ChromaSolver::solve(double x, double y, double Y, double* weights) {
+  if (size() >= 3 && size() <= MaxDense)
+    return solveDense(x, y, Y, true, weights);
+
+  lock_guard<mutex> lock(m_lock);
+  return solveExact(x, y, Y, true, weights);
+}
+
+bool ChromaSolver::solveDense(double x, double y, double Y, bool matchY, double* weights) const {
+  unsigned int n = size();
+  unsigned int k = matchY ? 3 : 2;
+
+  // Constraint rows, same as the CLP model: the x row, the y row, and the
+  // luminance row. a * w = b.
+  double a[3][MaxDense];
+  double b[3] = { 0, 0, Y };
+  double scale = 0;
+
+  for (unsigned int i = 0; i < n; i++) {
+    const Eigen::Vector3d& bv = m_basis[i];
+    a[0][i] = bv[0] - x * (bv[0] + bv[1] + bv[2]);
+    a[1][i] = bv[1] - y * (bv[0] + bv[1] + bv[2]);
+    a[2][i] = bv[1];
+
+    for (unsigned int r = 0; r < k; r++) {
+      scale = max(scale, fabs(a[r][i]));
+    }
+  }
+
+  for (unsigned int i = 0; i < n; i++) {
+    weights[i] = 0;
+  }
+
+  // Without a luminance target, everything off always matches.
+  double best = matchY ? -1 : 0;
+
+  if (!matchY && n == 3) {
+    // The weights have to lie along the cross product of the two rows. Scale
+    // it up until the first weight hits 1. Mixed signs mean the target is out
+    // of gamut, and only all zeros works.
+    double v[3] = {
+      a[0][1] * a[1][2] - a[0][2] * a[1][1],
+      a[0][2] * a[1][0] - a[0][0] * a[1][2],
+      a[0][0] * a[1][1] - a[0][1] * a[1][0]
+    };
+    double eps = 1e-12 * scale * scale;
+
+    if (v[0] + v[1] + v[2] < 0) {
+      for (double& c : v) {
+        c = -c;
+      }
+    }
+
+    // A degenerate basis doesn't give a direction. Fall through to the general case.
+    if (v[0] > eps || v[1] > eps || v[2] > eps) {
+      if (v[0] < -eps || v[1] < -eps || v[2] < -eps)
+        return true;
+
+      double t = 1 / max(v[0], max(v[1], v[2]));
+      for (unsigned int i = 0; i < 3; i++) {
+        weights[i] = min(max(t * v[i], 0.0), 1.0);
+      }
+
+      return true;
+    }
+  }
+
+  if ((matchY) ? searchDual<3>(n, a, b, scale, weights) : searchDual<2>(n, a, b, scale, weights))
+    return true;
+
+  // Degenerate, or no match for the luminance. Try every vertex.
+  return searchVertices(n, k, a, b, scale, best, weights) >= 0;
+}
+
+bool ChromaSolver::solveExact(double x, double y, double Y, bool matchY, double* weights) {
+  int numCols = (int)m_basis.size();
+
+  if (m_model == nullptr) {
+    // Set up the CLP model.
+    m_model = new ClpSimplex();
+
+    // The model is solved a lot, don't print every solve.
+    m_model->setLogLevel(0);
+
+    // Number of variables equal to number of basis vectors.
+    m_model->resize(0, numCols);
+
+    vector<int> indices;
+    vector<double> zeros(numCols, 0);
+
+    // Maximize c1 + c2 + c3... equivalent to minimize -(c1 + c2 + c3...)
+    for (int i = 0; i < numCols; i++) {
+      m_model->setObjectiveCoefficient(i, -1);
+
+      // Set objective function variable constraints. In range [0,1].
+      m_model->setColBounds(i, 0, 1);
+
+      indices.push_back(i);
+    }
+
+    // The x and y rows. Coefficients are filled in below for each target.
+    m_model->addRow(numCols, &indices[0], &zeros[0], 0, 0);
+    m_model->addRow(numCols, &indices[0], &zeros[0], 0, 0);
+
+    // The luminance row. Free unless there's a target.
+    vector<double> lum;
+    for (const auto& bv : m_basis) {
+      lum.push_back(bv[1]);
+    }
+    m_model->addRow(numCols, &indices[0], &lum[0], -COIN_DBL_MAX, COIN_DBL_MAX);
+  }
+
+  if (matchY)
+    m_model->setRowBounds(2, Y, Y);
+  else
+    m_model->setRowBounds(2, -COIN_DBL_MAX, COIN_DBL_MAX);
+
+  for (int i = 0; i < numCols; i++) {
+    const Eigen::Vector3d& bv = m_basis[i];
+
+    // Calculate X coefficients. Equal to (X1 - x(X1+Y1+Z1))
+    m_model->modifyCoefficient(0, i, bv[0] - x * (bv[0] + bv[1] + bv[2]), true);
+
+    // Calculate Y coefficients. Equal to (Y1 - y(X1+Y1+Z1))
+    m_model->modifyCoefficient(1, i, bv[1] - y * (bv[0] + bv[1] + bv[2]), true);
+  }
+
+  // The model keeps the status of each variable from the last solve, which
+  // dual() starts from. Nearby targets usually finish in a pivot or two.
+  m_model->dual();
+
+  const double* res = m_model->getColSolution();
+  for (int i = 0; i < numCols; i++) {
+    weights[i] = res[i];
+  }
+
+  return m_model->isProvenOptimal();
+}
+
+bool ChromaSolver::solveLookup(double x, double y, double* weights) {
+  unsigned int resolution = m_lookupResolution;
+  double u = x / lookupMaxX * resolution;
+  double v = y / lookupMaxY * resolution;
+
+  if (!(u >= 0 && v >= 0 && u < resolution && v < resolution))
+    return false;
+
+  unsigned int col = (unsigned int)u;
+  unsigned int row = (unsigned int)v;
+  unsigned int stride = resolution + 1;
+
+  unsigned int corners[4] = {
+    row * stride + col, row * stride + col + 1,
+    (row + 1) * stride + col, (row + 1) * stride + col + 1
+  };
+
+  // Corners that are out of gamut don't have anything to interpolate.
+  for (unsigned int c : corners) {
+    if (!m_lookupOptimal[c])
+      return false;
+  }
+
+  double fu = u - col;
+  double fv = v - row;
+  double cw[4] = { (1 - fu) * (1 - fv), fu * (1 - fv), (1 - fu) * fv, fu * fv };
+  size_t n = m_basis.size();
+
+  for (size_t i = 0; i < n; i++) {
+    weights[i] = 0;
+    for (unsigned int c = 0; c < 4; c++) {
+      weights[i] += cw[c] * m_lookup[corners[c] * n + i];
+    }
+  }
+
+  return true;
+}
+
+void ChromaSolver::buildLookup(unsigned int resolution) {
+  unsigned int stride = resolution + 1;
+  size_t n = m_basis.size();
+
+  m_lookup.assign(stride * stride * n, 0);
+  m_lookupOptimal.assign(stride * stride, 0);
+
+  // Rows are solved alternating direction so each solve starts next to the
+  // last one.
+  for (unsigned int row = 0; row < stride; row++) {
+    for (unsigned int i = 0; i < stride; i++) {
+      unsigned int col = (row % 2 == 0) ? i : resolution - i;
+      unsigned int point = row * stride + col;
+
+      double x = lookupMaxX * col / resolution;
+      double y = lookupMaxY * row / resolution;
+
+      // Out of gamut targets are still feasible with every weight at 0, which
+      // isn't something to interpolate from.
+      double* res = &m_lookup[point * n];
+      bool optimal = solveExact(x, y, 0, false, res);
+      double sum = 0;
+      for (size_t w = 0; w < n; w++) {
+        sum += res[w];
+      }
+
+      m_lookupOptimal[point] = optimal && sum > 1e-6;
+    }
+  }
+
+  m_lookupResolution = resolution;
+
+  stringstream ss;
+  ss << "Built " << stride << "x" << stride << " chromaticity lookup table for " << n << " basis vectors";
+  Logger::log(LDEBUG, ss.str());
+}
+
+}
@@ -0,0 +1,157 @@
+/*! \file ChromaSolver.h
+* \brief Cached solver for matching a chromaticity with a set of emitters.
+*/
+#ifndef _CHROMASOLVER_H_
+#define _CHROMASOLVER_H_
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "lib/Eigen/Dense"
+
+class ClpSimplex;
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Finds emitter weights that match a target xy chromaticity.
+  *
+  * This is the linear program behind LumiverseColor::matchChroma(): the weights
+  * are in [0, 1], the mix of the basis vectors must have the target x and y,
+  * and the sum of the weights is maximized.
+  *
+  * There is one solver per distinct set of basis vectors, shared through get().
+  *
+  * Fixtures with at most MaxDense emitters are solved directly, without
+  * allocating. With only two (three when matching luminance) constraints, at
+  * most that many weights of the optimum are strictly between 0 and 1. The
+  * dense solver finds them from the dual problem, whose optimum is where two
+  * (three) of its planes meet, so it only has to try each pair (triple) of
+  * emitters. Degenerate cases fall back to trying every vertex of the
+  * feasible region. With three emitters and no luminance target it's a
+  * single cross product.
+  *
+  * Larger bases use CLP. The CLP model is built once and only its constraint
+  * rows change between solves, so each solve warm starts from the basis of
+  * the previous one.
+  *
+  * Optionally, CLP solvers also keep a lookup table of solutions over a grid of xy
+  * coordinates covering the CIE 1931 gamut (see setLookupResolution()).
+  * Targets inside cells whose four corners all have exact solutions are
+  * interpolated from the table; everything else, including targets near the
+  * edge of the emitters' gamut, runs the solver.
+  * \sa LumiverseColor, ColorLayout
+  */
+  class ChromaSolver
+  {
+  public:
+    /*!
+    * \brief Gets the solver for a set of basis vectors.
+    *
+    * Colors of the same fixture share a solver, and so do fixtures with the
+    * same emitters.
+    */
+    static shared_ptr<ChromaSolver> get(const map<string, Eigen::Vector3d>& basis);
+
+    /*! \brief Most basis vectors the dense solver handles. Larger bases use CLP. */
+    static const unsigned int MaxDense = 7;
+
+    /*!
+    * \brief Sets the resolution of the xy lookup tables.
+    *
+    * Tables have resolution + 1 points along each axis, and are (re)built by
+    * each solver the next time it's used. Solvers of bases with at most
+    * MaxDense vectors are faster than the table and never use one. Building a table runs the solver
+    * once for every point, which takes most of a second at a resolution of 128.
+    * Interpolated weights match the target chromaticity only approximately,
+    * so the tables are off by default.
+    * \param resolution Cells along each axis. 0 turns the tables off.
+    */
+    static void setLookupResolution(unsigned int resolution);
+
+    /*! \brief Gets the resolution of the xy lookup tables. 0 if they're off. */
+    static unsigned int getLookupResolution();
+
+    ~ChromaSolver();
+
+    /*! \brief Number of basis vectors, which is the number of weights solve() returns. */
+    unsigned int size() const { return (unsigned int)m_basis.size(); }
+
+    /*!
+    * \brief Finds the weights of the basis vectors for a target chromaticity.
+    *
+    * May throw CoinError if CLP fails.
+    * \param x Target x coordinate (xyY color space)
+    * \param y Target y coordinate (xyY color space)
+    * \param weights Receives size() weights, in basis vector name order.
+    * \return True if the weights are an optimal solution. False usually
+    * means the target is outside of the gamut of the basis vectors.
+    */
+    bool solve(double x, double y, double* weights);
+
+    /*!
+    * \brief Finds the weights of the basis vectors for a target chromaticity
+    * and luminance.
+    *
+    * Like solve(x, y, weights), but the mix must also have luminance Y.
+    * May throw CoinError if CLP fails.
+    * \param x Target x coordinate (xyY color space)
+    * \param y Target y coordinate (xyY color space)
+    * \param Y Target luminance, in the units of the basis vectors.
+    * \param weights Receives size() weights, in basis vector name order.
+    * \return False if no mix of the basis vectors has that color.
+    */
+    bool solve(double x, double y, double Y, double* weights);
+
+  private:
+    /*! \brief Makes a solver. Use get(). */
+    ChromaSolver(const map<string, Eigen::Vector3d>& basis);
+
+    /*!
+    * \brief Runs the dense solver. Doesn't need m_lock.
+    * \param Y Target luminance. Ignored unless matchY is set.
+    */
+    bool solveDense(double x, double y, double Y, bool matchY, double* weights) const;
+
+    /*!
+    * \brief Runs the CLP model. m_lock must be held.
+    * \param Y Target luminance. Ignored unless matchY is set.
+    */
+    bool solveExact(double x, double y, double Y, bool matchY, double* weights);
+
+    /*!
+    * \brief Looks the target up in the lookup table. m_lock must be held.
+    * \return False if the target can't be interpolated from the table.
+    */
+    bool solveLookup(double x, double y, double* weights);
+
+    /*! \brief Fills the lookup table for the current resolution. m_lock must be held. */
+    void buildLookup(unsigned int resolution);
+
+    /*! \brief Basis vectors by name, as passed to get(). */
+    map<string, Eigen::Vector3d> m_basisMap;
+
+    /*! \brief Basis vectors in name order. */
+    vector<Eigen::Vector3d> m_basis;
+
+    /*! \brief The model, built on the first solve. */
+    ClpSimplex* m_model;
+
+    /*! \brief Resolution m_lookup was built with. 0 if there's no table. */
+    unsigned int m_lookupResolution;
+
+    /*! \brief size() weights for each grid point, row by row in y. */
+    vector<double> m_lookup;
+
+    /*! \brief Whether the solution at each grid point was optimal. */
+    vector<char> m_lookupOptimal;
+
+    /*! \brief Guards the model and the table. */
+    mutex m_lock;
+  };
+}
+#endif
@@ -0,0 +1,166 @@
+#include "ColorConversion.h"
+
+namespace Lumiverse {
+namespace ColorConversion {
+
+static inline double clamp01(double val) {
+  return (val < 0) ? 0 : ((val > 1) ? 1 : val);
+}
+
+static inline double sRGBtoXYZCompand(double val) {
+  // this is some black magic right here but apparently it's a standard.
+  return (val > 0.04045) ? pow(((val + 0.055) / 1.055), 2.4) : val / 12.92;
+}
+
+static inline double XYZtosRGBCompand(double val) {
+  return (val > 0.0031308) ? (1.055 * pow(val, 1 / 2.4) - 0.055) : val * 12.92;
+}
+
+// Lab f() function and its inverse.
+static inline double labf(double val) {
+  return (val > pow(6.0 / 29.0, 3)) ? pow(val, 1.0 / 3.0) : (1.0 / 3.0) * pow(29.0 / 6.0, 2) * val + (4.0 / 29.0);
+}
+
+static inline double labfInverse(double val) {
+  return (val > 6.0 / 29.0) ? val * val * val : 3 * pow(6.0 / 29.0, 2) * (val - 4.0 / 29.0);
+}
+
+// out = m * in for each color. Each color is read completely before it's
+// written, so in and out can be the same.
+static void multiply(const Eigen::Matrix3d& m, const Eigen::Vector3d* in, Eigen::Vector3d* out, size_t count) {
+  const double m00 = m(0, 0), m01 = m(0, 1), m02 = m(0, 2);
+  const double m10 = m(1, 0), m11 = m(1, 1), m12 = m(1, 2);
+  const double m20 = m(2, 0), m21 = m(2, 1), m22 = m(2, 2);
+
+  for (size_t i = 0; i < count; i++) {
+    double a = in[i][0], b = in[i][1], c = in[i][2];
+    out[i][0] = m00 * a + m01 * b + m02 * c;
+    out[i][1] = m10 * a + m11 * b + m12 * c;
+    out[i][2] = m20 * a + m21 * b + m22 * c;
+  }
+}
+
+void RGBToXYZ(const Eigen::Vector3d* rgb, Eigen::Vector3d* XYZ, size_t count, RGBColorSpace cs) {
+  for (size_t i = 0; i < count; i++) {
+    double r = clamp01(rgb[i][0]);
+    double g = clamp01(rgb[i][1]);
+    double b = clamp01(rgb[i][2]);
+
+    if (cs == sRGB) {
+      r = sRGBtoXYZCompand(r);
+      g = sRGBtoXYZCompand(g);
+      b = sRGBtoXYZCompand(b);
+    }
+
+    XYZ[i] = Eigen::Vector3d(r, g, b);
+  }
+
+  multiply(Lumiverse::RGBToXYZ[cs], XYZ, XYZ, count);
+}
+
+void XYZToRGB(const Eigen::Vector3d* XYZ, Eigen::Vector3d* rgb, size_t count, RGBColorSpace cs) {
+  // Vector is scaled by 1/100 bringing it inline withthe [0,1] range typically used by RGB.
+  Eigen::Matrix3d m = Lumiverse::RGBToXYZ[cs].inverse();
+  for (size_t i = 0; i < count; i++) {
+    rgb[i] = XYZ[i] / 100;
+  }
+
+  multiply(m, rgb, rgb, count);
+
+  if (cs == sRGB) {
+    for (size_t i = 0; i < count; i++) {
+      rgb[i][0] = clamp01(XYZtosRGBCompand(rgb[i][0]));
+      rgb[i][1] = clamp01(XYZtosRGBCompand(rgb[i][1]));
+      rgb[i][2] = clamp01(XYZtosRGBCompand(rgb[i][2]));
+    }
+  }
+}
+
+void XYZToxyY(const Eigen::Vector3d* XYZ, Eigen::Vector3d* xyY, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    double X = XYZ[i][0], Y = XYZ[i][1], Z = XYZ[i][2];
+
+    if (X == 0 && Y == 0 && Z == 0) {
+      // Not sure if actually correct, but should be fine.
+      xyY[i] = Eigen::Vector3d(0, 0, 0);
+      continue;
+    }
+
+    double sum = X + Y + Z;
+    xyY[i] = Eigen::Vector3d(X / sum, Y / sum, Y);
+  }
+}
+
+void xyYToXYZ(const Eigen::Vector3d* xyY, Eigen::Vector3d* XYZ, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    double x = xyY[i][0], y = xyY[i][1], Y = xyY[i][2];
+
+    if (y == 0) {
+      XYZ[i] = Eigen::Vector3d(0, 0, 0);
+      continue;
+    }
+
+    XYZ[i] = Eigen::Vector3d(x * Y / y, Y, (1 - x - y) * Y / y);
+  }
+}
+
+void XYZToLab(const Eigen::Vector3d* XYZ, Eigen::Vector3d* Lab, size_t count, ReferenceWhite refWhite) {
+  XYZToLab(XYZ, Lab, count, refWhites[refWhite]);
+}
+
+void XYZToLab(const Eigen::Vector3d* XYZ, Eigen::Vector3d* Lab, size_t count, const Eigen::Vector3d& refWhite) {
+  const double Xn = refWhite[0], Yn = refWhite[1], Zn = refWhite[2];
+
+  for (size_t i = 0; i < count; i++) {
+    double fx = labf(XYZ[i][0] / Xn);
+    double fy = labf(XYZ[i][1] / Yn);
+    double fz = labf(XYZ[i][2] / Zn);
+
+    Lab[i] = Eigen::Vector3d(116 * fy - 16, 500 * (fx - fy), 200 * (fy - fz));
+  }
+}
+
+void LabToXYZ(const Eigen::Vector3d* Lab, Eigen::Vector3d* XYZ, size_t count, ReferenceWhite refWhite) {
+  LabToXYZ(Lab, XYZ, count, refWhites[refWhite]);
+}
+
+void LabToXYZ(const Eigen::Vector3d* Lab, Eigen::Vector3d* XYZ, size_t count, const Eigen::Vector3d& refWhite) {
+  const double Xn = refWhite[0], Yn = refWhite[1], Zn = refWhite[2];
+
+  for (size_t i = 0; i < count; i++) {
+    double fy = (Lab[i][0] + 16) / 116;
+    double fx = fy + Lab[i][1] / 500;
+    double fz = fy - Lab[i][2] / 200;
+
+    XYZ[i] = Eigen::Vector3d(Xn * labfInverse(fx), Yn * labfInverse(fy), Zn * labfInverse(fz));
+  }
+}
+
+void LabToLCh(const Eigen::Vector3d* Lab, Eigen::Vector3d* LCh, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    double L = Lab[i][0], a = Lab[i][1], b = Lab[i][2];
+    double C = sqrt(a * a + b * b);
+    double H = atan2(b, a) * (180 / M_PI);
+
+    if (H < 0) H += 360;
+    if (H >= 360) H -= 360;
+
+    LCh[i] = Eigen::Vector3d(L, C, H);
+  }
+}
+
+void LChToLab(const Eigen::Vector3d* LCh, Eigen::Vector3d* Lab, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    double L = LCh[i][0], C = LCh[i][1], H = LCh[i][2] * (M_PI / 180);
+    Lab[i] = Eigen::Vector3d(L, C * cos(H), C * sin(H));
+  }
+}
+
+void getXYZ(LumiverseColor* const* colors, Eigen::Vector3d* XYZ, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    XYZ[i] = colors[i]->getXYZ();
+  }
+}
+
+}
+}
@@ -0,0 +1,95 @@
+/*! \file ColorConversion.h
+* \brief Color space conversions over arrays of colors.
+*/
+#ifndef _COLORCONVERSION_H_
+#define _COLORCONVERSION_H_
+
+#pragma once
+
+#include "LumiverseColor.h"
+
+namespace Lumiverse {
+  /*!
+  * \namespace Lumiverse::ColorConversion
+  * \brief Converts whole arrays of colors between color spaces.
+  *
+  * These are the conversions behind LumiverseColor::getRGB(), getxyY(),
+  * getLab() and getLCHab(), plus their inverses, written to run over many
+  * colors at once. Tables, matrices and reference whites are looked up once
+  * per call instead of once per color, so converting every color of a
+  * DeviceSet (see DeviceSet::getColorXYZ()) is a handful of tight loops.
+  *
+  * Units are the ones LumiverseColor uses: RGB is in [0, 1], XYZ from
+  * RGBToXYZ() is in [0, 1], while XYZToRGB() and the Lab conversions expect
+  * XYZ with Y = 100 for the reference white.
+  *
+  * In every function, in and out may be the same array.
+  * \sa LumiverseColor
+  */
+  namespace ColorConversion {
+    /*!
+    * \brief Converts RGB colors to XYZ.
+    *
+    * RGB values are clamped to [0, 1] first.
+    * \param rgb count RGB colors
+    * \param XYZ Receives count XYZ colors.
+    * \param cs Color space of the RGB values.
+    */
+    void RGBToXYZ(const Eigen::Vector3d* rgb, Eigen::Vector3d* XYZ, size_t count, RGBColorSpace cs = sRGB);
+
+    /*!
+    * \brief Converts XYZ colors to RGB.
+    *
+    * RGB values in sRGB are clamped to [0, 1].
+    * \param XYZ count XYZ colors
+    * \param rgb Receives count RGB colors.
+    * \param cs Color space of the RGB values.
+    */
+    void XYZToRGB(const Eigen::Vector3d* XYZ, Eigen::Vector3d* rgb, size_t count, RGBColorSpace cs = sRGB);
+
+    /*!
+    * \brief Converts XYZ colors to xyY.
+    *
+    * Black (all zeros) has chromaticity (0, 0).
+    */
+    void XYZToxyY(const Eigen::Vector3d* XYZ, Eigen::Vector3d* xyY, size_t count);
+
+    /*!
+    * \brief Converts xyY colors to XYZ.
+    *
+    * Colors with y = 0 are black.
+    */
+    void xyYToXYZ(const Eigen::Vector3d* xyY, Eigen::Vector3d* XYZ, size_t count);
+
+    /*! \brief Converts XYZ colors to L*a*b* relative to a standard reference white. */
+    void XYZToLab(const Eigen::Vector3d* XYZ, Eigen::Vector3d* Lab, size_t count, ReferenceWhite refWhite = D65);
+
+    /*! \brief Converts XYZ colors to L*a*b* relative to the XYZ coordinates of a reference white. */
+    void XYZToLab(const Eigen::Vector3d* XYZ, Eigen::Vector3d* Lab, size_t count, const Eigen::Vector3d& refWhite);
+
+    /*! \brief Converts L*a*b* colors relative to a standard reference white to XYZ. */
+    void LabToXYZ(const Eigen::Vector3d* Lab, Eigen::Vector3d* XYZ, size_t count, ReferenceWhite refWhite = D65);
+
+    /*! \brief Converts L*a*b* colors relative to the XYZ coordinates of a reference white to XYZ. */
+    void LabToXYZ(const Eigen::Vector3d* Lab, Eigen::Vector3d* XYZ, size_t count, const Eigen::Vector3d& refWhite);
+
+    /*!
+    * \brief Converts L*a*b* colors to LCh.
+    *
+    * Hue is in degrees, in [0, 360).
+    */
+    void LabToLCh(const Eigen::Vector3d* Lab, Eigen::Vector3d* LCh, size_t count);
+
+    /*! \brief Converts LCh colors, hue in degrees, to L*a*b*. */
+    void LChToLab(const Eigen::Vector3d* LCh, Eigen::Vector3d* Lab, size_t count);
+
+    /*!
+    * \brief Gets the XYZ coordinates of many colors.
+    *
+    * Same as calling LumiverseColor::getXYZ() on each, which is cached.
+    */
+    void getXYZ(LumiverseColor* const* colors, Eigen::Vector3d* XYZ, size_t count);
+  }
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "ColorLayout.h"
+#include "../Logger.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace Lumiverse {
+
+const unsigned int ColorLayout::MaxChannels;
+
+// Every layout handed out by get(). Colors hold the only strong references,
+// so layouts nobody uses anymore go away by themselves.
+static mutex& layoutsLock() {
+  static mutex lock;
+  return lock;
+}
+
+static vector<weak_ptr<const ColorLayout> >& layouts() {
+  static vector<weak_ptr<const ColorLayout> > all;
+  return all;
+}
+
+static bool sameBasis(const map<string, Eigen::Vector3d>& a, const map<string, Eigen::Vector3d>& b) {
+  if (a.size() != b.size())
+    return false;
+
+  auto it = b.begin();
+  for (const auto& kvp : a) {
+    if (kvp.first != it->first || kvp.second != it->second)
+      return false;
+    it++;
+  }
+
+  return true;
+}
+
+shared_ptr<const ColorLayout> ColorLayout::get(vector<string> channels, const map<string, Eigen::Vector3d>& basis) {
+  sort(channels.begin(), channels.end());
+  channels.erase(unique(channels.begin(), channels.end()), channels.end());
+
+  if (channels.size() > MaxChannels) {
+    stringstream ss;
+    ss << "Colors can have at most " << MaxChannels << " channels. Dropping channels from " << channels[MaxChannels] << " on.";
+    Logger::log(ERR, ss.str());
+    channels.resize(MaxChannels);
+  }
+
+  lock_guard<mutex> lock(layoutsLock());
+  auto& all = layouts();
+
+  for (auto it = all.begin(); it != all.end();) {
+    shared_ptr<const ColorLayout> layout = it->lock();
+    if (layout == nullptr) {
+      it = all.erase(it);
+      continue;
+    }
+
+    if (layout->m_names == channels && sameBasis(layout->m_basis, basis))
+      return layout;
+
+    it++;
+  }
+
+  shared_ptr<const ColorLayout> layout(new ColorLayout(channels, basis));
+  all.push_back(layout);
+  return layout;
+}
+
+ColorLayout::ColorLayout(const vector<string>& channels, const map<string, Eigen::Vector3d>& basis) :
+  m_names(channels), m_basis(basis)
+{
+  for (const auto& name : m_names) {
+    auto b = m_basis.find(name);
+    m_hasBasis.push_back(b != m_basis.end());
+    m_channelBasis.push_back((b != m_basis.end()) ? b->second : Eigen::Vector3d(0, 0, 0));
+  }
+
+  for (const auto& kvp : m_basis) {
+    m_basisChannels.push_back(find(kvp.first));
+  }
+
+  if (!m_basis.empty())
+    m_solver = ChromaSolver::get(m_basis);
+
+  m_red = find("Red");
+  m_green = find("Green");
+  m_blue = find("Blue");
+  m_white = find("White");
+}
+
+shared_ptr<const ColorLayout> ColorLayout::withChannel(const string& name) const {
+  vector<string> channels = m_names;
+  channels.push_back(name);
+  return get(channels, m_basis);
+}
+
+shared_ptr<const ColorLayout> ColorLayout::withBasisChannels() const {
+  vector<string> channels = m_names;
+  for (const auto& kvp : m_basis) {
+    channels.push_back(kvp.first);
+  }
+  return get(channels, m_basis);
+}
+
+int ColorLayout::find(const string& name) const {
+  // Names are sorted, and there are only a handful of them.
+  auto it = lower_bound(m_names.begin(), m_names.end(), name);
+  return (it != m_names.end() && *it == name) ? (int)(it - m_names.begin()) : -1;
+}
+
+}
@@ -0,0 +1,130 @@
+/*! \file ColorLayout.h
+* \brief Channel layout shared by colors of the same fixture.
+*/
+#ifndef _COLORLAYOUT_H_
+#define _COLORLAYOUT_H_
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "lib/Eigen/Dense"
+#include "ChromaSolver.h"
+
+using namespace std;
+
+namespace Lumiverse {
+  /*!
+  * \brief Names and basis vectors of the channels of a LumiverseColor.
+  *
+  * A layout gives every channel of a color a fixed index, so a color can keep
+  * its values in a small array and code that reads the same channel over and
+  * over (DMX encoding, interpolation, XYZ sums) can look the index up once.
+  * Channels are indexed in name order, which is the order the old string
+  * keyed maps iterated in.
+  *
+  * Layouts never change after they're made. get() hands out one shared
+  * instance for each distinct set of channels and basis vectors, so colors of
+  * the same fixture have the same layout pointer and comparing layouts is a
+  * pointer comparison.
+  * \sa LumiverseColor
+  */
+  class ColorLayout
+  {
+  public:
+    /*! \brief Most channels a color can have. */
+    static const unsigned int MaxChannels = 16;
+
+    /*!
+    * \brief Gets the layout for a set of channels and basis vectors.
+    *
+    * Channels past MaxChannels are dropped with an error.
+    * \param channels Channel names. Order and duplicates don't matter.
+    * \param basis Basis vectors by channel name. May name channels that
+    * aren't in channels.
+    */
+    static shared_ptr<const ColorLayout> get(vector<string> channels, const map<string, Eigen::Vector3d>& basis);
+
+    /*!
+    * \brief Gets the layout with an extra channel.
+    * \return This layout if it already has the channel.
+    */
+    shared_ptr<const ColorLayout> withChannel(const string& name) const;
+
+    /*! \brief Gets the layout that also has a channel for every basis vector. */
+    shared_ptr<const ColorLayout> withBasisChannels() const;
+
+    /*! \brief Gets the number of channels. */
+    unsigned int size() const { return (unsigned int)m_names.size(); }
+
+    /*! \brief Gets the name of a channel. */
+    const string& getName(unsigned int index) const { return m_names[index]; }
+
+    /*!
+    * \brief Finds a channel by name.
+    * \return Index of the channel, or -1 if there's no such channel.
+    */
+    int find(const string& name) const;
+
+    /*! \brief Checks if a channel has a basis vector. */
+    bool hasBasis(unsigned int index) const { return m_hasBasis[index] != 0; }
+
+    /*! \brief Gets the basis vector of a channel. Zero if it has none. */
+    const Eigen::Vector3d& getBasis(unsigned int index) const { return m_channelBasis[index]; }
+
+    /*! \brief Gets all basis vectors by name, including any that aren't channels. */
+    const map<string, Eigen::Vector3d>& getBasisVectors() const { return m_basis; }
+
+    /*!
+    * \brief Gets the channel of each basis vector, in getBasisVectors() order.
+    *
+    * -1 for basis vectors without a channel.
+    */
+    const vector<int>& getBasisChannels() const { return m_basisChannels; }
+
+    /*! \brief Gets the solver for the basis vectors. nullptr if there are none. */
+    ChromaSolver* getSolver() const { return m_solver.get(); }
+
+    /*! \brief Index of the "Red" channel, or -1. */
+    int getRed() const { return m_red; }
+
+    /*! \brief Index of the "Green" channel, or -1. */
+    int getGreen() const { return m_green; }
+
+    /*! \brief Index of the "Blue" channel, or -1. */
+    int getBlue() const { return m_blue; }
+
+    /*! \brief Index of the "White" channel, or -1. */
+    int getWhite() const { return m_white; }
+
+  private:
+    /*! \brief Makes a layout. Use get(). channels must be sorted and unique. */
+    ColorLayout(const vector<string>& channels, const map<string, Eigen::Vector3d>& basis);
+
+    /*! \brief Channel names, sorted. */
+    vector<string> m_names;
+
+    /*! \brief Basis vector of each channel. */
+    vector<Eigen::Vector3d> m_channelBasis;
+
+    /*! \brief Whether each channel has a basis vector. */
+    vector<char> m_hasBasis;
+
+    /*! \brief Basis vectors by name. */
+    map<string, Eigen::Vector3d> m_basis;
+
+    /*! \brief Channel of each entry of m_basis. */
+    vector<int> m_basisChannels;
+
+    /*! \brief Shared with every other layout that has the same basis vectors. */
+    shared_ptr<ChromaSolver> m_solver;
+
+    int m_red;
+    int m_green;
+    int m_blue;
+    int m_white;
+  };
+}
+#endif
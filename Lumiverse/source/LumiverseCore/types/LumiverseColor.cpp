@@ -1,105 +1,177 @@
 #include "LumiverseColor.h"
+#include "ColorConversion.h"
+#include "../ParameterStore.h"
 
 namespace Lumiverse {
+  static_assert(ColorLayout::MaxChannels == ParameterStore::ColorChannels, "Color slots must fit every channel of a layout");
 
-  LumiverseColor::LumiverseColor(ColorMode mode) : m_mode(mode) {
+  LumiverseColor::LumiverseColor(ColorMode mode) : LumiverseType(COLOR), m_mode(mode) {
     // Initialize color   
+    initLocal();
+    m_layout = ColorLayout::get(defaultChannels(m_mode), map<string, Eigen::Vector3d>());
     reset();
-    initMode();
   }
 
-  LumiverseColor::LumiverseColor(map<string, Eigen::Vector3d> basis, ColorMode mode) : m_mode(mode) {
+  LumiverseColor::LumiverseColor(map<string, Eigen::Vector3d> basis, ColorMode mode) : LumiverseType(COLOR), m_mode(mode) {
+    initLocal();
+    m_layout = ColorLayout::get(defaultChannels(m_mode), basis);
     reset();
-    initMode();
-    m_basisVectors = basis;
   }
 
-  LumiverseColor::LumiverseColor(map<string, double> params, map<string, Eigen::Vector3d> basis, ColorMode mode, double weight) {
+  LumiverseColor::LumiverseColor(map<string, double> params, map<string, Eigen::Vector3d> basis, ColorMode mode, double weight) : LumiverseType(COLOR) {
+    initLocal();
     m_weight = weight;
     m_mode = mode;
 
-    m_deviceChannels = params;
-    m_basisVectors = basis;
+    vector<string> channels;
+    for (const auto& kvp : params) {
+      channels.push_back(kvp.first);
+    }
+
+    m_layout = ColorLayout::get(channels, basis);
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
+      channelRef(i) = params[m_layout->getName(i)];
+    }
+    m_XYZValid = false;
   }
 
-  LumiverseColor::LumiverseColor(LumiverseType* other) {
-    if (other->getTypeName() != "color") {
+  LumiverseColor::LumiverseColor(LumiverseType* other) : LumiverseType(COLOR) {
+    initLocal();
+
+    if (other->getTypeTag() != COLOR) {
       // Initialize to basic rgb in absence of any info.
       m_mode = BASIC_RGB;
+      m_layout = ColorLayout::get(defaultChannels(m_mode), map<string, Eigen::Vector3d>());
       reset();
-      initMode();
     }
     else {
       LumiverseColor* otherColor = (LumiverseColor*)other;
       m_weight = otherColor->m_weight;
       m_mode = otherColor->m_mode;
 
-      m_mapMutex.lock();
-      m_deviceChannels = otherColor->m_deviceChannels;
-      m_basisVectors = otherColor->m_basisVectors;
-      m_mapMutex.unlock();
+      m_layout = otherColor->m_layout;
+      copyChannels(*otherColor, m_layout->size());
+      m_XYZ = otherColor->m_XYZ;
+      m_XYZValid = otherColor->m_XYZValid;
     }
   }
   
-  LumiverseColor::LumiverseColor(LumiverseColor* other) {
+  LumiverseColor::LumiverseColor(LumiverseColor* other) : LumiverseType(COLOR) {
+    initLocal();
     m_weight = other->m_weight;
     m_mode = other->m_mode;
 
-    m_mapMutex.lock();
-    m_deviceChannels = other->m_deviceChannels;
-    m_basisVectors = other->m_basisVectors;
-    m_mapMutex.unlock();
+    m_layout = other->m_layout;
+    copyChannels(*other, m_layout->size());
+    m_XYZ = other->m_XYZ;
+    m_XYZValid = other->m_XYZValid;
   }
 
-  LumiverseColor::LumiverseColor(const LumiverseColor& other) {
+  LumiverseColor::LumiverseColor(const LumiverseColor& other) : LumiverseType(COLOR) {
+    initLocal();
     m_weight = other.m_weight;
     m_mode = other.m_mode;
 
-    m_mapMutex.lock();
-    m_deviceChannels = other.m_deviceChannels;
-    m_basisVectors = other.m_basisVectors;
-    m_mapMutex.unlock();
+    m_layout = other.m_layout;
+    copyChannels(other, m_layout->size());
+    m_XYZ = other.m_XYZ;
+    m_XYZValid = other.m_XYZValid;
   }
 
-  void LumiverseColor::initMode() {
+  vector<string> LumiverseColor::defaultChannels(ColorMode mode) {
     // Create default channels for basic RGB mode
-    if (m_mode == BASIC_RGB) {
-      m_deviceChannels["Red"] = 0;
-      m_deviceChannels["Green"] = 0;
-      m_deviceChannels["Blue"] = 0;
+    if (mode == BASIC_RGB)
+      return vector<string>({ "Red", "Green", "Blue" });
+    if (mode == BASIC_CMY)
+      return vector<string>({ "Cyan", "Magenta", "Yellow" });
+
+    return vector<string>();
+  }
+
+  void LumiverseColor::setLayout(shared_ptr<const ColorLayout> layout) {
+    double channels[ColorLayout::MaxChannels];
+
+    for (unsigned int i = 0; i < layout->size(); i++) {
+      channels[i] = rawChannel(m_layout->find(layout->getName(i)));
+    }
+
+    lock_guard<mutex> lock(m_layoutMutex);
+    m_layout = layout;
+    for (unsigned int i = 0; i < layout->size(); i++) {
+      channelRef(i) = channels[i];
     }
-    if (m_mode == BASIC_CMY) {
-      m_deviceChannels["Cyan"] = 0;
-      m_deviceChannels["Magenta"] = 0;
-      m_deviceChannels["Yellow"] = 0;
+    m_XYZValid = false;
+  }
+
+  void LumiverseColor::initLocal() {
+    m_channels = m_local;
+    m_stride = 1;
+    m_store = nullptr;
+    m_slot = 0;
+    fill(m_local, m_local + ColorLayout::MaxChannels, 0.0);
+  }
+
+  void LumiverseColor::copyChannels(const LumiverseColor& other, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+      channelRef(i) = other.channelRef(i);
     }
   }
 
   LumiverseColor::~LumiverseColor() {
-    // Nothing at the moment
+    if (m_store != nullptr)
+      m_store->releaseColor(m_slot);
+  }
+
+  void LumiverseColor::bind(ParameterStore* store, ParamHandle param, DeviceHandle device) {
+    if (store == m_store)
+      return;
+
+    double channels[ColorLayout::MaxChannels];
+    for (unsigned int i = 0; i < ColorLayout::MaxChannels; i++) {
+      channels[i] = channelRef(i);
+    }
+
+    if (m_store != nullptr)
+      m_store->releaseColor(m_slot);
+
+    m_store = store;
+    if (m_store != nullptr) {
+      m_slot = m_store->acquireColor(param, device);
+      m_channels = m_store->getColorSlot(m_slot);
+      m_stride = ParameterStore::BlockSize;
+    }
+    else {
+      m_slot = 0;
+      m_channels = m_local;
+      m_stride = 1;
+    }
+
+    for (unsigned int i = 0; i < ColorLayout::MaxChannels; i++) {
+      channelRef(i) = channels[i];
+    }
   }
 
   void LumiverseColor::reset() {
     // Resets the color channels to 0.
     m_weight = 1;
-
-    for (map<string, double>::iterator it = m_deviceChannels.begin(); it != m_deviceChannels.end(); it++) {
-      it->second = 0;
+    for (unsigned int i = 0; i < ColorLayout::MaxChannels; i++) {
+      channelRef(i) = 0;
     }
+    m_XYZValid = false;
   }
 
   JSONNode LumiverseColor::toJSON(string name) {
     JSONNode channels;
     channels.set_name("channels");
 
-    for (const auto& kvp : m_deviceChannels) {
-      channels.push_back(JSONNode(kvp.first, kvp.second));
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
+      channels.push_back(JSONNode(m_layout->getName(i), channelRef(i)));
     }
 
     JSONNode basis;
     basis.set_name("basis");
 
-    for (const auto& kvp : m_basisVectors) {
+    for (const auto& kvp : m_layout->getBasisVectors()) {
       JSONNode vec;
       vec.set_name(kvp.first);
       vec.push_back(JSONNode("X", kvp.second[0]));
@@ -125,81 +197,75 @@ namespace Lumiverse {
     stringstream ss;
     ss << "(";
     bool first = true;
-    m_mapMutex.lock();
-    for (const auto& kvp : m_deviceChannels) {
+    m_layoutMutex.lock();
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
       if (!first)
         ss << ", ";
       if (first)
         first = false;
 
-      ss << kvp.first << " : " << kvp.second;
+      ss << m_layout->getName(i) << " : " << channelRef(i);
     }
-    m_mapMutex.unlock();
+    m_layoutMutex.unlock();
     ss << ")";
     return ss.str();
   }
 
-  double LumiverseColor::getX() {
+  Eigen::Vector3d LumiverseColor::getXYZ() {
+    if (m_XYZValid)
+      return m_XYZ;
+
     if (m_mode == BASIC_RGB) {
-      return RGBtoXYZ(m_deviceChannels["Red"] * m_weight, m_deviceChannels["Green"] * m_weight, m_deviceChannels["Blue"] * m_weight, sRGB)[0];
+      Eigen::Vector3d rgb(getColorChannelAt(m_layout->getRed()), getColorChannelAt(m_layout->getGreen()), getColorChannelAt(m_layout->getBlue()));
+      ColorConversion::RGBToXYZ(&rgb, &m_XYZ, 1, sRGB);
     }
     else {
-      if (m_basisVectors.size() == 0) {
-        Logger::log(ERR, "Cannot retrieve X value. No color basis defined.");
-        return -1;
+      if (m_layout->getBasisVectors().size() == 0) {
+        Logger::log(ERR, "Cannot retrieve XYZ value. No color basis defined.");
+        return Eigen::Vector3d(-1, -1, -1);
       }
 
-      return sumComponent(0);
+      m_XYZ = sumComponents();
     }
+
+    m_XYZValid = true;
+    return m_XYZ;
   }
 
-  double LumiverseColor::getY() {
-    if (m_mode == BASIC_RGB) {
-      return RGBtoXYZ(m_deviceChannels["Red"] * m_weight, m_deviceChannels["Green"] * m_weight, m_deviceChannels["Blue"] * m_weight, sRGB)[1];
-    }
-    else {
-      if (m_basisVectors.size() == 0) {
-        Logger::log(ERR, "Cannot retrieve Y value. No color basis defined.");
-        return -1;
-      }
+  double LumiverseColor::getX() {
+    return getXYZ()[0];
+  }
 
-      return sumComponent(1);
-    }
+  double LumiverseColor::getY() {
+    return getXYZ()[1];
   }
 
   double LumiverseColor::getZ() {
-    if (m_mode == BASIC_RGB) {
-      return RGBtoXYZ(m_deviceChannels["Red"] * m_weight, m_deviceChannels["Green"] * m_weight, m_deviceChannels["Blue"] * m_weight, sRGB)[2];
-    }
-    else {
-      if (m_basisVectors.size() == 0) {
-        Logger::log(ERR, "Cannot retrieve Z value. No color basis defined.");
-        return -1;
-      }
-
-      return sumComponent(2);
-    }
+    return getXYZ()[2];
   }
 
   double LumiverseColor::getx() {
-    if (getX() == 0 && getY() == 0 && getZ() == 0)
+    Eigen::Vector3d XYZ = getXYZ();
+    if (XYZ[0] == 0 && XYZ[1] == 0 && XYZ[2] == 0)
       return 0; // Not sure if actually correct, but should be fine.
 
-    return (getX() / (getX() + getY() + getZ()));
+    return (XYZ[0] / (XYZ[0] + XYZ[1] + XYZ[2]));
   }
 
   double LumiverseColor::gety() {
-    if (getX() == 0 && getY() == 0 && getZ() == 0)
+    Eigen::Vector3d XYZ = getXYZ();
+    if (XYZ[0] == 0 && XYZ[1] == 0 && XYZ[2] == 0)
       return 0; // Not sure if actually correct, but should be fine.
 
-    return (getY() / (getX() + getY() + getZ()));
+    return (XYZ[1] / (XYZ[0] + XYZ[1] + XYZ[2]));
   }
 
   double LumiverseColor::getz() {
-    if (getX() == 0 && getY() == 0 && getZ() == 0)
+    Eigen::Vector3d XYZ = getXYZ();
+    if (XYZ[0] == 0 && XYZ[1] == 0 && XYZ[2] == 0)
       return 0; // Not sure if actually correct, but should be fine.
 
-    return (getZ() / (getX() + getY() + getZ()));
+    return (XYZ[2] / (XYZ[0] + XYZ[1] + XYZ[2]));
   }
 
   void LumiverseColor::setRGB(double r, double g, double b, double weight, RGBColorSpace cs) {
@@ -208,7 +274,8 @@ namespace Lumiverse {
       setRGBRaw(r, g, b, weight);
     }
     else {
-      Eigen::Vector3d XYZ = RGBtoXYZ(r, g, b, cs);
+      Eigen::Vector3d XYZ(r, g, b);
+      ColorConversion::RGBToXYZ(&XYZ, &XYZ, 1, cs);
 
       // We have now generated the target XYZ coordinate. If basis vectors were provided,
       // we'll try to match the xyY coordinate found from this converted XYZ vector.
@@ -219,18 +286,12 @@ namespace Lumiverse {
   Eigen::Vector3d LumiverseColor::getRGB(RGBColorSpace cs) {
     if (m_mode == BASIC_RGB) {
       // BASIC_RGB is based off of the RGB channels and only the RGB channels
-      return Eigen::Vector3d(m_deviceChannels["Red"], m_deviceChannels["Green"], m_deviceChannels["Blue"]);
+      return Eigen::Vector3d(rawChannel(m_layout->getRed()), rawChannel(m_layout->getGreen()), rawChannel(m_layout->getBlue()));
     }
 
-    // Vector is scaled by 1/100 bringing it inline withthe [0,1] range typically used by RGB.
-    Eigen::Vector3d XYZvec = Eigen::Vector3d(getX(), getY(), getZ()) / 100;
-    Eigen::Vector3d rgb = RGBToXYZ[cs].inverse() * XYZvec;
-
-    if (cs == sRGB) {
-      rgb[0] = clamp(XYZtosRGBCompand(rgb[0]), 0, 1);
-      rgb[1] = clamp(XYZtosRGBCompand(rgb[1]), 0, 1);
-      rgb[2] = clamp(XYZtosRGBCompand(rgb[2]), 0, 1);
-    }
+    Eigen::Vector3d XYZ = getXYZ();
+    Eigen::Vector3d rgb;
+    ColorConversion::XYZToRGB(&XYZ, &rgb, 1, cs);
 
     return rgb;
   }
@@ -245,12 +306,16 @@ namespace Lumiverse {
   }
 
   Eigen::Vector3d LumiverseColor::getxyY() {
-    if (m_mode == ADDITIVE && m_basisVectors.size() == 0) {
+    if (m_mode == ADDITIVE && m_layout->getBasisVectors().size() == 0) {
       Logger::log(ERR, "Cannot calculate xxY coordinates. No basis vectors defined.");
       return Eigen::Vector3d(0, 0, 0);
     }
 
-    return Eigen::Vector3d(getx(), gety(), getY());
+    Eigen::Vector3d XYZ = getXYZ();
+    Eigen::Vector3d xyY;
+    ColorConversion::XYZToxyY(&XYZ, &xyY, 1);
+
+    return xyY;
   }
 
   Eigen::Vector3d LumiverseColor::getLab(ReferenceWhite refWhite) {
@@ -258,10 +323,11 @@ namespace Lumiverse {
   }
 
   Eigen::Vector3d LumiverseColor::getLab(Eigen::Vector3d refWhite) {
-    double L = 116 * labf(getY() / refWhite[1]) - 16;
-    double a = 500 * (labf(getX() / refWhite[0]) - labf(getY() / refWhite[1]));
-    double b = 200 * (labf(getY() / refWhite[1]) - labf(getZ() / refWhite[2]));
-    return Eigen::Vector3d(L, a, b);
+    Eigen::Vector3d XYZ = getXYZ();
+    Eigen::Vector3d lab;
+    ColorConversion::XYZToLab(&XYZ, &lab, 1, refWhite);
+
+    return lab;
   }
 
   Eigen::Vector3d LumiverseColor::getLCHab(ReferenceWhite refWhite) {
@@ -269,21 +335,19 @@ namespace Lumiverse {
   }
 
   Eigen::Vector3d LumiverseColor::getLCHab(Eigen::Vector3d refWhite) {
-    Eigen::Vector3d lab = getLab(refWhite);
-    double C = sqrt(lab[1] * lab[1] + lab[2] * lab[2]);
-    double H = atan2(lab[2], lab[1]) * (180 / M_PI);
+    Eigen::Vector3d lch = getLab(refWhite);
+    ColorConversion::LabToLCh(&lch, &lch, 1);
 
-    if (H < 0) H += 360;
-    if (H >= 360) H -= 360;
-
-    return Eigen::Vector3d(lab[0], C, H);
+    return lch;
   }
 
   bool LumiverseColor::setColorChannel(string name, double val) {
-    if (m_deviceChannels.count(name) > 0) {
+    int index = m_layout->find(name);
+    if (index >= 0) {
       // ??
-      //m_deviceChannels[name] = clamp(val, 0, 1);
-      m_deviceChannels[name] = val;
+      //m_channels[index] = clamp(val, 0, 1);
+      channelRef(index) = val;
+      m_XYZValid = false;
       return true;
     }
     else {
@@ -295,25 +359,48 @@ namespace Lumiverse {
   }
 
   double& LumiverseColor::operator[](string name) {
-    return m_deviceChannels[name];
+    int index = m_layout->find(name);
+    if (index < 0) {
+      setLayout(m_layout->withChannel(name));
+      index = m_layout->find(name);
+    }
+
+    if (index < 0) {
+      // Color is full, ColorLayout already logged it.
+      static double unused;
+      unused = 0;
+      return unused;
+    }
+
+    // Assume the caller writes through the reference.
+    m_XYZValid = false;
+    return channelRef(index);
+  }
+
+  map<string, double> LumiverseColor::getColorParams() {
+    map<string, double> params;
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
+      params[m_layout->getName(i)] = channelRef(i);
+    }
+    return params;
   }
 
   void LumiverseColor::setWeight(double weight) {
     m_weight = clamp(weight, 0, 1);
+    m_XYZValid = false;
   }
 
   bool LumiverseColor::setRGBRaw(double r, double g, double b, double weight) {
-    if (m_deviceChannels.count("Red") == 0 ||
-      m_deviceChannels.count("Green") == 0 ||
-      m_deviceChannels.count("Blue") == 0) {
+    if (m_layout->getRed() < 0 || m_layout->getGreen() < 0 || m_layout->getBlue() < 0) {
       Logger::log(ERR, "Color does not have required color parameters. Needs Red, Green, Blue. (in setRGBRaw)");
       return false;
     }
 
-    m_deviceChannels["Red"] = r;
-    m_deviceChannels["Green"] = g;
-    m_deviceChannels["Blue"] = b;
+    channelRef(m_layout->getRed()) = r;
+    channelRef(m_layout->getGreen()) = g;
+    channelRef(m_layout->getBlue()) = b;
     m_weight = weight;
+    m_XYZValid = false;
 
     return true;
   }
@@ -322,16 +409,21 @@ namespace Lumiverse {
     m_weight = other.m_weight;
     m_mode = other.m_mode;
     
-    m_mapMutex.lock();
-    m_deviceChannels = other.m_deviceChannels;
-    m_basisVectors = other.m_basisVectors;
-    m_mapMutex.unlock();
+    if (m_layout != other.m_layout) {
+      m_layoutMutex.lock();
+      m_layout = other.m_layout;
+      m_layoutMutex.unlock();
+    }
+    copyChannels(other, m_layout->size());
+    m_XYZ = other.m_XYZ;
+    m_XYZValid = other.m_XYZValid;
   }
 
   LumiverseColor& LumiverseColor::operator+=(double val) {
-    for (auto it = m_deviceChannels.begin(); it != m_deviceChannels.end(); it++) {
-      m_deviceChannels[it->first] = clamp(it->second + val, 0, 1);
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
+      channelRef(i) = clamp(channelRef(i) + val, 0, 1);
     }
+    m_XYZValid = false;
 
     return *this;
   }
@@ -341,9 +433,10 @@ namespace Lumiverse {
   }
 
   LumiverseColor& LumiverseColor::operator*=(double val) {
-    for (auto it = m_deviceChannels.begin(); it != m_deviceChannels.end(); it++) {
-      m_deviceChannels[it->first] = clamp(it->second * val, 0, 1);
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
+      channelRef(i) = clamp(channelRef(i) * val, 0, 1);
     }
+    m_XYZValid = false;
 
     return *this;
   }
@@ -355,20 +448,52 @@ namespace Lumiverse {
   shared_ptr<LumiverseType> LumiverseColor::lerp(LumiverseColor* rhs, float t) {
     // We lerp the weights, and then we lerp the color params of the lhs.
     LumiverseColor* newColor = new LumiverseColor(this);
+    lerpInto(newColor, rhs, t);
+    return shared_ptr<LumiverseType>((LumiverseType*)newColor);
+  }
 
-    for (const auto& kvp : m_deviceChannels) {
-      // Standard lerp for each color channel: (1 - t) * lhs + t * rhs
-      newColor->setColorChannel(kvp.first, (1 - t) * kvp.second + rhs->getColorChannel(kvp.first) * t);
+  void LumiverseColor::lerpInto(LumiverseColor* dest, LumiverseColor* rhs, float t) {
+    if (dest->m_layout != m_layout) {
+      if (dest == rhs) {
+        // rhs is still read below, so its layout can't change yet. Not the usual case.
+        LumiverseColor result(this);
+        lerpInto(&result, rhs, t);
+        *dest = result;
+        return;
+      }
+
+      // Every channel of dest is written below, so it just takes this layout.
+      lock_guard<mutex> lock(dest->m_layoutMutex);
+      dest->m_layout = m_layout;
+    }
+
+    double weight = (1 - t) * m_weight + rhs->m_weight * t;
+    double rhsWeight = rhs->m_weight;
+    unsigned int size = m_layout->size();
+
+    // Standard lerp for each color channel: (1 - t) * lhs + t * rhs, with rhs weighted.
+    // Each channel only reads its own inputs, which makes dest == rhs safe too.
+    if (rhs->m_layout == m_layout) {
+      for (unsigned int i = 0; i < size; i++) {
+        dest->channelRef(i) = (1 - t) * channelRef(i) + rhs->channelRef(i) * rhsWeight * t;
+      }
+    }
+    else {
+      for (unsigned int i = 0; i < size; i++) {
+        double rhsVal = rhs->rawChannel(rhs->m_layout->find(m_layout->getName(i))) * rhsWeight;
+        dest->channelRef(i) = (1 - t) * channelRef(i) + rhsVal * t;
+      }
     }
 
     // Lerp weights
-    newColor->setWeight((1 - t) * m_weight + rhs->getWeight() * t);
-    return shared_ptr<LumiverseType>((LumiverseType*)newColor);
+    dest->m_mode = m_mode;
+    dest->setWeight(weight);
   }
 
   bool LumiverseColor::isEqual(LumiverseColor& other) {
-    for (const auto& kvp : m_deviceChannels) {
-      if (!doubleEq(kvp.second, other.getColorChannel(kvp.first)))
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
+      int j = (other.m_layout == m_layout) ? (int)i : other.m_layout->find(m_layout->getName(i));
+      if (!doubleEq(channelRef(i), other.getColorChannelAt(j)))
         return false;
     }
 
@@ -379,8 +504,8 @@ namespace Lumiverse {
     // All channels must be 0 and weight must be 1 for default.
     bool channelsNull = true;
 
-    for (const auto& c : m_deviceChannels) {
-      channelsNull &= (c.second == 0);
+    for (unsigned int i = 0; i < m_layout->size(); i++) {
+      channelsNull &= (channelRef(i) == 0);
     }
 
     return (channelsNull && (m_weight == 1));
@@ -394,17 +519,17 @@ namespace Lumiverse {
     return (thisH < thatH) ? -1 : 1;
   }
 
-  double LumiverseColor::sumComponent(int i) {
-    double ret = 0;
+  Eigen::Vector3d LumiverseColor::sumComponents() {
+    Eigen::Vector3d ret(0, 0, 0);
 
-    for (const auto& kvp : m_deviceChannels) {
-      if (m_basisVectors.count(kvp.first) == 0) {
+    for (unsigned int c = 0; c < m_layout->size(); c++) {
+      if (!m_layout->hasBasis(c)) {
         stringstream ss;
-        ss << "No basis component named " << kvp.first << " contained in color basis. Ignoring...";
+        ss << "No basis component named " << m_layout->getName(c) << " contained in color basis. Ignoring...";
         Logger::log(WARN, ss.str());
         continue;
       }
-      ret += kvp.second * m_basisVectors[kvp.first][i] * m_weight;
+      ret += channelRef(c) * m_layout->getBasis(c) * m_weight;
     }
     return ret;
   }
@@ -417,101 +542,95 @@ namespace Lumiverse {
     return ret;
   }
 
-  Eigen::Vector3d LumiverseColor::RGBtoXYZ(double r, double g, double b, RGBColorSpace cs) {
-    r = clamp(r, 0, 1);
-    g = clamp(g, 0, 1);
-    b = clamp(b, 0, 1);
-
-    if (cs == sRGB) {
-      r = sRGBtoXYZCompand(r);
-      g = sRGBtoXYZCompand(g);
-      b = sRGBtoXYZCompand(b);
-    }
-
-    Eigen::Matrix3d M = RGBToXYZ[cs];
-    Eigen::Vector3d rgb(r, g, b);
-    Eigen::Vector3d XYZ = M * rgb;
-
-    return XYZ;
-  }
-
-  double LumiverseColor::sRGBtoXYZCompand(double val) {
-    // this is some black magic right here but apparently it's a standard.
-    return (val > 0.04045) ? pow(((val + 0.055) / 1.055), 2.4) : val / 12.92;
-  }
-
-  double LumiverseColor::XYZtosRGBCompand(double val) {
-    return (val > 0.0031308) ? (1.055 * pow(val, 1 / 2.4) - 0.055) : val * 12.92;
-  }
-
-  double LumiverseColor::labf(double val) {
-    return (val > pow(6.0 / 29.0, 3)) ? pow(val, 1.0 / 3.0) : (1.0 / 3.0) * pow(29.0 / 6.0, 2) * val + (4.0 / 29.0);
-  }
-
   void LumiverseColor::matchChroma(double x, double y, double weight) {
-    if (m_basisVectors.size() == 0) {
+    if (m_layout->getBasisVectors().size() == 0) {
       // No basis vectors, can't do this calculation
       Logger::log(ERR, "matchChroma did not run since this Color does not have any basis vectors defined.");
       return;
     }
 
     try {
-      // Set up the CLP model.
-      ClpSimplex model;
-      vector<int> indices;
+      bool optimal = matchBasis(x, y, 0, false);
+      m_weight = weight;
 
-      // Number of variables equal to number of basis vectors.
-      int numCols = m_basisVectors.size();
-      model.resize(0, numCols);
+      // Just warn if it doesn't work quite right. User can always change.
+      if (optimal)
+        Logger::log(LDEBUG, "Optimal color match found");
+      else
+        Logger::log(WARN, "Non-optimal color solution. Color may be out of gamut.");
+    }
+    catch (CoinError e) {
+      e.print();
+      if (e.lineNumber() >= 0)
+        std::cout << "This was from a CoinAssert" << std::endl;
+    }
+  }
 
-      // Maximize c1 + c2 + c3... equivalent to minimize -(c1 + c2 + c3...)
-      for (int i = 0; i < numCols; i++) {
-        model.setObjectiveCoefficient(i, -1);
+  bool LumiverseColor::setxyY(double x, double y, double Y) {
+    if (m_mode == BASIC_RGB) {
+      Logger::log(ERR, "Function setxyY() not supported in BASIC_RGB mode. Use setRGB().");
+      return false;
+    }
 
-        // Set objective function variable constraints. In range [0,1].
-        model.setColBounds(i, 0, 1);
+    if (m_layout->getBasisVectors().size() == 0) {
+      Logger::log(ERR, "setxyY did not run since this Color does not have any basis vectors defined.");
+      return false;
+    }
 
-        indices.push_back(i);
+    try {
+      if (matchBasis(x, y, Y, true)) {
+        m_weight = 1;
+        return true;
       }
+    }
+    catch (const CoinError& e) {
+      stringstream ss;
+      ss << "Color solver failed in " << e.className() << "::" << e.methodName() << ": " << e.message();
+      Logger::log(ERR, ss.str());
+      return false;
+    }
 
-      vector<double> xCoef;
-      vector<double> yCoef;
+    stringstream ss;
+    ss << "Luminance " << Y << " is out of range at (" << x << ", " << y << "). Matching chromaticity only.";
+    Logger::log(WARN, ss.str());
 
-      for (const auto& kvp : m_basisVectors) {
-        Eigen::Vector3d bv = kvp.second;
+    matchChroma(x, y);
+    return false;
+  }
 
-        // Calculate X coefficients. Equal to (X1 - x(X1+Y1+Z1))
-        xCoef.push_back(bv[0] - x * (bv[0] + bv[1] + bv[2]));
-        
-        // Calculate Y coefficients. Equal to (Y1 - y(X1+Y1+Z1))
-        yCoef.push_back(bv[1] - y * (bv[0] + bv[1] + bv[2]));
-      }
+  bool LumiverseColor::matchBasis(double x, double y, double Y, bool matchY) {
+    // Solver is shared by every color with these basis vectors.
+    ChromaSolver* solver = m_layout->getSolver();
 
-      model.addRow(numCols, &indices[0], &xCoef[0], 0, 0);
-      model.addRow(numCols, &indices[0], &yCoef[0], 0, 0);
-      
-      model.dual();
+    // Weights in basis vector order. Colors rarely have more basis vectors than channels.
+    double stackRes[ColorLayout::MaxChannels];
+    vector<double> heapRes;
+    double* res = stackRes;
+    if (solver->size() > ColorLayout::MaxChannels) {
+      heapRes.resize(solver->size());
+      res = &heapRes[0];
+    }
 
-      const double* res = model.getColSolution();
+    bool optimal = (matchY) ? solver->solve(x, y, Y, res) : solver->solve(x, y, res);
 
-      // Set value for device channels if model is optimal
-      int index = 0;
-      for (const auto& kvp : m_basisVectors) {
-        m_deviceChannels[kvp.first] = res[index];
-        index++;
-      }
-      m_weight = weight;
+    // A failed luminance match leaves the color alone.
+    if (matchY && !optimal)
+      return false;
 
-      // Just warn if it doesn't work quite right. User can always change.
-      if (model.isProvenOptimal())
-        Logger::log(LDEBUG, "Optimal color match found");
-      else
-        Logger::log(WARN, "Non-optimal color solution. Color may be out of gamut.");
+    // Every basis vector gets a channel, if it didn't have one already.
+    const vector<int>* basisChannels = &m_layout->getBasisChannels();
+    if (find(basisChannels->begin(), basisChannels->end(), -1) != basisChannels->end()) {
+      setLayout(m_layout->withBasisChannels());
+      basisChannels = &m_layout->getBasisChannels();
     }
-    catch (CoinError e) {
-      e.print();
-      if (e.lineNumber() >= 0)
-        std::cout << "This was from a CoinAssert" << std::endl;
+
+    // Set value for device channels
+    for (size_t index = 0; index < basisChannels->size(); index++) {
+      if ((*basisChannels)[index] >= 0)
+        channelRef((*basisChannels)[index]) = res[index];
     }
+    m_XYZValid = false;
+
+    return optimal;
   }
 }
\ No newline at end of file
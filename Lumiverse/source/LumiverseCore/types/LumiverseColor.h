@@ -15,10 +15,14 @@
 #include "lib/clp/ClpSimplex.hpp"
 #include "lib/clp/CoinError.hpp"
 #include "../LumiverseType.h"
+#include "../Interner.h"
+#include "ColorLayout.h"
 
 using namespace std;
 
 namespace Lumiverse {
+  class ParameterStore;
+
   /*! \brief Selects the color mode for a LumiverseColor */
   enum ColorMode {
     ADDITIVE,    /*!< Color represents a LED source light. */
@@ -89,6 +93,13 @@ namespace Lumiverse {
   *
   * When intializing BASIC* type Colors, you'll find that it's easier to create
   * them programmatically instead of defining them in a Rig file.
+  *
+  * Channel values are kept in a fixed array laid out by a ColorLayout shared
+  * with every color of the same fixture. The functions that take channel names
+  * look the name up in the layout first. Code that reads the same channels
+  * often should get the indices from getLayout() once and use
+  * getColorChannelAt() and setColorChannelAt(). A color bound to a
+  * ParameterStore keeps the array in the store's channel columns instead.
   */
   class LumiverseColor : LumiverseType {
   public:
@@ -129,6 +140,9 @@ namespace Lumiverse {
     */
     virtual string getTypeName() { return "color"; }
 
+    /*! \brief Tag of the type. Always LumiverseType::COLOR. */
+    using LumiverseType::getTypeTag;
+
     /*! \brief Resets the color to defaults.
     * Default color is Black (0, 0, 0).  
     */
@@ -172,8 +186,9 @@ namespace Lumiverse {
     * \brief Returns a vector representing the color in XYZ coordinates.
     * 
     * If there is no color basis defined, the returned vector will be (-1, -1, -1).
+    * The coordinates are cached until a channel, the weight or the mode changes.
     */
-    Eigen::Vector3d getXYZ() { return Eigen::Vector3d(getX(), getY(), getZ()); }
+    Eigen::Vector3d getXYZ();
 
     /*! \brief Gets the x value.
     *
@@ -222,6 +237,17 @@ namespace Lumiverse {
     */
     void setxy(double x, double y, double weight = 1.0);
 
+    /*!
+    * \brief Sets the color to match the specified xyY coordinate.
+    *
+    * Unlike setxy(), this also matches the luminance, so the weight is set to 1
+    * and getY() returns Y afterwards. Not every Y is reachable at every
+    * chromaticity. If it isn't, this logs a warning and falls back to setxy().
+    * \param Y Target luminance, in the same units as getY().
+    * \return False if the color couldn't be matched.
+    */
+    bool setxyY(double x, double y, double Y);
+
     /*!
     * \brief Retrieves the xyY coordinate of the current color.
     * 
@@ -263,7 +289,7 @@ namespace Lumiverse {
     * \brief Directly sets the value of a light parameter.
     *
     * Available parameters are defined by the user, though common ones will
-    * include "Red", "Green", "Blue", "Cyan", etc. This function updates m_deviceChannels
+    * include "Red", "Green", "Blue", "Cyan", etc. This function updates m_channels
     * and the value will be directly sent to the device.
     * \param name Parameter name (typically the name of a color axis, "Red", "Blue", etc.)
     * \param val Value to set the parameter to. Clamped between 0 and 1.
@@ -275,14 +301,41 @@ namespace Lumiverse {
     * \brief Gets the weighted value for the color channel.
     *
     * You should use this function when retrieving data to send over the network. 
+    * \return 0 if the color doesn't have the channel.
+    */
+    double getColorChannel(string name) { return getColorChannelAt(m_layout->find(name)); }
+
+    /*!
+    * \brief Gets the weighted value for a color channel by index.
+    * \param index Index of the channel in getLayout(). -1 gives 0.
+    */
+    double getColorChannelAt(int index) { return (index < 0) ? 0 : channelRef(index) * m_weight; }
+
+    /*!
+    * \brief Directly sets the value of a color channel by index.
+    * \param index Index of the channel in getLayout().
+    * \param val Value to set the channel to. Not clamped.
     */
-    double getColorChannel(string name) { return m_deviceChannels[name] * m_weight; }
+    void setColorChannelAt(unsigned int index, double val) { channelRef(index) = val; m_XYZValid = false; }
+
+    /*!
+    * \brief Gets the channel layout of the color.
+    *
+    * Indices from the layout stay valid until the color gets a different
+    * layout. That only happens when a channel is added with operator[],
+    * when matchChroma needs channels for basis vectors that don't have
+    * one yet, or when a color of another fixture is assigned to this one.
+    */
+    const ColorLayout& getLayout() { return *m_layout; }
       
     /*!
     * \brief Subscript overload for accessing light color parameters.
     *
     * Note that this function returns the unweighted value for a channel.
-    * Be careful when using it to send data over the network.
+    * Be careful when using it to send data over the network. Adds the
+    * channel if the color doesn't have it. Don't hold on to the reference
+    * across calls that read XYZ (getXYZ(), getRGB(), etc.), since later writes
+    * through it won't clear the cached XYZ coordinates.
     */
     double& operator[](string name);
 
@@ -301,20 +354,26 @@ namespace Lumiverse {
     * This will only work correctly if your device is specified to have RGB
     * parameters.
     *
-    * For this to work, you must define m_deviceChannels to include only "Red", "Green"
+    * For this to work, the color must have the channels "Red", "Green"
     * and "Blue". If you construct a color in the SIMPLE_RGB mode, this will be handled
     * for you. Works like a more conventional RGB set method.
     */
     bool setRGBRaw(double r, double g, double b, double weight = 1.0);
 
     /*! \brief Gets the current values for the color parameters.
-    * \return m_deviceChannels map
+    * \return Map from channel name to unweighted value.
     */
-    map<string, double> getColorParams() { return m_deviceChannels; }
+    map<string, double> getColorParams();
 
     /*! \brief Gets the weight. */
     double getWeight() { return m_weight; }
 
+    /*! \brief Gets the basis vectors of the color channels. */
+    const map<string, Eigen::Vector3d>& getBasisVectors() { return m_layout->getBasisVectors(); }
+
+    /*! \brief Gets the color mode. */
+    ColorMode getMode() { return m_mode; }
+
     // Arithmetic overrides
     void operator=(LumiverseColor& other);
 
@@ -343,6 +402,19 @@ namespace Lumiverse {
     */
     shared_ptr<LumiverseType> lerp(LumiverseColor* rhs, float t);
 
+    /*!
+    * \brief Does the same interpolation as lerp() into an existing color.
+    *
+    * dest ends up the same as it would be after `*dest = *lerp(rhs, t)`.
+    * If dest already has the same layout as this color, it is updated in
+    * place without allocating. dest may be this object or rhs.
+    * \param dest Color to write the result to.
+    * \param rhs Right hand side of the interpolation.
+    * \param t Value between 0 and 1.
+    * \sa lerp()
+    */
+    void lerpInto(LumiverseColor* dest, LumiverseColor* rhs, float t);
+
     /*!
     * \brief Compares two colors using the color channel values (device levels)
     *
@@ -363,6 +435,24 @@ namespace Lumiverse {
 
     virtual bool isDefault();
 
+    /*!
+    * \brief Moves the color's channels into a ParameterStore.
+    *
+    * The current channel values are kept. Binding to nullptr moves the
+    * values back into the color itself. Must not be called while other
+    * threads access the color.
+    * \param store Store to use. nullptr to use local storage.
+    * \param param Handle of the parameter the color is. Picks the slot.
+    * \param device Handle of the device the color belongs to. Picks the slot.
+    */
+    void bind(ParameterStore* store, ParamHandle param, DeviceHandle device);
+
+    /*! \brief Gets the store the color is bound to. nullptr if none. */
+    ParameterStore* getStore() { return m_store; }
+
+    /*! \brief Gets the slot the color uses in its store. Meaningless if unbound. */
+    unsigned int getSlot() { return m_slot; }
+
   private:
     /*! \brief Parameter that controls the overall values of the device channels.
     *
@@ -374,59 +464,97 @@ namespace Lumiverse {
     /*! \brief Color mode for this color. */
     ColorMode m_mode;
 
-    /*! \brief Protects access to the deviceChannels map */
-    mutex m_mapMutex;
+    /*! \brief Protects m_layout while it's replaced. */
+    mutex m_layoutMutex;
 
-    /*! \brief Contains a map from device channel to current value.
+    /*!
+    * \brief Names and basis vectors of the channels. Never null.
+    *
+    * Basis vectors for each LED source in the light are represented in XYZ.
+    */
+    shared_ptr<const ColorLayout> m_layout;
+
+    /*! \brief Channel values when not bound to a store. */
+    double m_local[ColorLayout::MaxChannels];
+
+    /*! \brief Current value of each channel, indexed by m_layout.
     *
     * These are the actual values that get sent to the light after converting
-    * from XYZ. Any time you change a value, this map gets recalculated.
-    * The map is automatically populated based on the specified basis vectors.
+    * from XYZ. Any time you change a value, these get recalculated.
+    * Only the first m_layout->size() values are used. Points at channel 0,
+    * either in m_local or in the store, with the others following at
+    * multiples of m_stride.
     */
-    map<string, double> m_deviceChannels;
+    double* m_channels;
 
-    /*! \brief Basis vectors for each LED source in the light. Represented in XYZ. */
-    map<string, Eigen::Vector3d> m_basisVectors;
+    /*! \brief Distance between channels in m_channels. */
+    unsigned int m_stride;
 
-    /*! \brief Intialization steps for each particular mode. */
-    void initMode();
+    /*! \brief Store holding the channels. nullptr for local storage. */
+    ParameterStore* m_store;
 
-    /*! \brief Calculates the value of the specified component at current device channel levels. */
-    double sumComponent(int i);
+    /*! \brief Slot in m_store. */
+    unsigned int m_slot;
 
-    /*! \brief Clamps a value between min and max. Returns the clamped value. */
-    double clamp(double val, double min, double max);
+    /*! \brief XYZ coordinates at the current channel values, if m_XYZValid. */
+    Eigen::Vector3d m_XYZ;
 
-    /*! \brief Helper for converting RGB to XYZ */
-    Eigen::Vector3d RGBtoXYZ(double r, double g, double b, RGBColorSpace cs);
+    /*! \brief Whether m_XYZ is up to date. Anything that changes a channel,
+    * the weight, the mode or the layout clears it.
+    */
+    bool m_XYZValid;
 
-    /*! \brief sRGB value companding function for RGB to XYZ */
-    double sRGBtoXYZCompand(double val);
+    /*! \brief Gets the channels a color of the given mode starts with. */
+    static vector<string> defaultChannels(ColorMode mode);
 
-    /*! \brief sRGB value companding cuntion for XYZ to RGB */
-    double XYZtosRGBCompand(double val);
+    /*! \brief Switches to a new layout, keeping the values of channels both layouts have. */
+    void setLayout(shared_ptr<const ColorLayout> layout);
 
-    /*! \brief Lab f() function.
-    * 
-    * Function used in the Lab color conversion.
-    */
-    double labf(double val);
+    /*! \brief Sets up empty local storage. */
+    void initLocal();
+
+    /*! \brief Gets a channel by index, wherever it's stored. */
+    inline double& channelRef(unsigned int index) const { return m_channels[index * m_stride]; }
+
+    /*! \brief Copies the first count channels of another color. */
+    void copyChannels(const LumiverseColor& other, unsigned int count);
+
+    /*! \brief Gets the unweighted value of a channel by index. 0 for -1. */
+    double rawChannel(int index) { return (index < 0) ? 0 : channelRef(index); }
+
+    /*! \brief Calculates the XYZ coordinates at current device channel levels. */
+    Eigen::Vector3d sumComponents();
+
+    /*! \brief Clamps a value between min and max. Returns the clamped value. */
+    double clamp(double val, double min, double max);
 
     /*! \brief Runs a linear optimization to find a combination of the basis vectors
     *   that will match the target chroma value.
     *
     * This function prioritizes maintaining the target chromaticity when selecting
-    * weights for the basis vectors. It runs a linear solver (CLP Simplex) over a
+    * weights for the basis vectors. It runs a linear solver over a
     * relatively small space. The weights are constrained between 0 and 1,
     * the x and y coordinates calculated from the weights must be equal
     * to the target x and y, and the solver attempts to maximize the sum of the weights.
     *
+    * The solver is the ChromaSolver of the color's basis vectors, shared with
+    * every other color that has the same ones.
+    *
     * \param x Target x coordinate to match (xyY color space)
     * \param y Target y coordinate to match (xyY color space)
     * \param weight Controls the overall brightness of the resulting color.
     */
     void matchChroma(double x, double y, double weight = 1.0);
 
+    /*!
+    * \brief Solves for the basis vector weights and stores them in the channels.
+    *
+    * Shared by matchChroma() and setxyY(). Doesn't touch the weight.
+    * \param matchY Also match luminance Y.
+    * \return Whether the solver found an optimal match.
+    */
+    bool matchBasis(double x, double y, double Y, bool matchY);
+
     inline bool doubleEq(double a, double b) {
       return (abs(a - b) < DBL_EPSILON);
     }
@@ -434,7 +562,7 @@ namespace Lumiverse {
 
   // Operators time!
   inline bool operator==(LumiverseColor& a, LumiverseColor& b) {
-    if (a.getTypeName() != "color" || b.getTypeName() != "color")
+    if (a.getTypeTag() != LumiverseType::COLOR || b.getTypeTag() != LumiverseType::COLOR)
       return false;
 
     return a.isEqual(b);
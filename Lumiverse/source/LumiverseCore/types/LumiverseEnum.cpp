@@ -1,12 +1,12 @@
 #include "LumiverseEnum.h"
 namespace Lumiverse {
 
-LumiverseEnum::LumiverseEnum(Mode mode, int rangeMax, InterpolationMode interpMode) {
+LumiverseEnum::LumiverseEnum(Mode mode, int rangeMax, InterpolationMode interpMode) : LumiverseType(ENUM) {
   init(map<string, int>(), "", mode, "", 0.5f, rangeMax, interpMode);
 }
 
 LumiverseEnum::LumiverseEnum(map<string, int> keys, Mode mode, int rangeMax, string def, InterpolationMode interpMode) :
-  m_mode(mode), m_rangeMax(rangeMax)
+  LumiverseType(ENUM), m_mode(mode), m_rangeMax(rangeMax)
 {
   init(keys, "", mode, def, 0.5f, rangeMax, interpMode);
 
@@ -18,7 +18,7 @@ LumiverseEnum::LumiverseEnum(map<string, int> keys, Mode mode, int rangeMax, str
   else m_default = def;
 }
 
-LumiverseEnum::LumiverseEnum(map<string, int> keys, string mode, string interpMode, int rangeMax, string def) {
+LumiverseEnum::LumiverseEnum(map<string, int> keys, string mode, string interpMode, int rangeMax, string def) : LumiverseType(ENUM) {
   init(keys, "", stringToMode(mode), def, 0.5f, rangeMax, stringToInterpMode(interpMode));
 
   // Set the active enumeration to the first in the range.
@@ -29,18 +29,18 @@ LumiverseEnum::LumiverseEnum(map<string, int> keys, string mode, string interpMo
   else m_default = def;
 }
 
-LumiverseEnum::LumiverseEnum(LumiverseEnum* other) {
+LumiverseEnum::LumiverseEnum(LumiverseEnum* other) : LumiverseType(ENUM) {
   init(other->m_nameToStart, other->m_active, other->m_mode, other->m_default,
     other->m_tweak, other->m_rangeMax, other->m_interpMode, other->m_startToName);
 }
 
-LumiverseEnum::LumiverseEnum(const LumiverseEnum& other) {
+LumiverseEnum::LumiverseEnum(const LumiverseEnum& other) : LumiverseType(ENUM) {
   init(other.m_nameToStart, other.m_active, other.m_mode, other.m_default,
     other.m_tweak, other.m_rangeMax, other.m_interpMode, other.m_startToName);
 }
 
-LumiverseEnum::LumiverseEnum(LumiverseType* other) {
-  if (other->getTypeName() != "enum") {
+LumiverseEnum::LumiverseEnum(LumiverseType* other) : LumiverseType(ENUM) {
+  if (other->getTypeTag() != ENUM) {
     // Initialize with defaults, which here means practically nothing
     m_active = "";
   }
@@ -177,7 +177,7 @@ bool LumiverseEnum::setVal(float val) {
     return setVal(m_startToName.begin()->second, 0.0f);
   }
   else if (val > m_rangeMax) {
-    return setVal(m_startToName.end()->second, 1.0f);
+    return setVal(m_startToName.rbegin()->second, 1.0f);
   }
 
   lock_guard<mutex> lock(m_enumMapMutex);
@@ -191,14 +191,18 @@ bool LumiverseEnum::setVal(float val) {
     start = kvp.first;
   }
 
-  string name = m_startToName[start];
   auto it = m_startToName.find(start);
-  it++;
+  auto next = it;
+  next++;
 
-  int end = (it == m_startToName.end()) ? m_rangeMax : it->first - 1;
+  int end = (next == m_startToName.end()) ? m_rangeMax : next->first - 1;
 
-  float tweak = ((float)(val - start) / (float)(end - start));
-  return setVal(name, tweak);
+  // The name comes from the map, so it exists. Assign it directly rather than
+  // through setVal(string) to avoid copying it around, and only if it changed.
+  if (m_active != it->second)
+    m_active = it->second;
+  setTweak((float)(val - start) / (float)(end - start));
+  return true;
 }
 
 void LumiverseEnum::setTweak(float tweak) {
@@ -244,28 +248,48 @@ shared_ptr<LumiverseType> LumiverseEnum::lerp(LumiverseEnum* rhs, float t) {
   return shared_ptr<LumiverseType>((LumiverseType*)newEnum);
 }
 
+void LumiverseEnum::lerpInto(LumiverseEnum* dest, LumiverseEnum* rhs, float t) {
+  // Work out everything from this and rhs first, dest may be either of them.
+  InterpolationMode interpMode = m_interpMode;
+  bool sameVal = (m_active == rhs->m_active);
+  float tweak = getTweak() * (1 - t) + rhs->getTweak() * t;
+  float rangeVal = (interpMode == SMOOTH) ? getRangeVal() * (1 - t) + rhs->getRangeVal() * t : 0;
+
+  // Start from rhs, like lerp() does.
+  if (dest != rhs)
+    *dest = *rhs;
+
+  if (interpMode == SMOOTH_WITHIN_OPTION) {
+    if (sameVal)
+      dest->setTweak(tweak);
+  }
+  else if (interpMode == SMOOTH) {
+    dest->setVal(rangeVal);
+  }
+}
+
 void LumiverseEnum::operator=(string name) {
   setVal(name);
 }
 
 void LumiverseEnum::operator=(const LumiverseEnum& val) {
-  m_active = val.m_active;
-  m_default = val.m_default;
+  if (&val == this)
+    return;
+
+  // Copying a string is a lot more than comparing it, and during playback
+  // these are usually already equal.
+  if (m_active != val.m_active)
+    m_active = val.m_active;
+  if (m_default != val.m_default)
+    m_default = val.m_default;
   m_mode = val.m_mode;
   m_rangeMax = val.m_rangeMax;
   m_tweak = val.m_tweak;
 
-  // Before we do a copy of the maps, check to see if they aren't already the same.
-  if (val.m_nameToStart.size() == m_nameToStart.size()) {
-    for (const auto& kvp : m_nameToStart) {
-      if (kvp.second != val.m_nameToStart.find(kvp.first)->second) {
-        break;
-      }
-    }
+  // Enums of the same fixture type have the same options, skip the copy then.
+  if (m_nameToStart == val.m_nameToStart)
     return;
-  }
 
-  // If they aren't the same, do the copy.
   lock_guard<mutex> lock(m_enumMapMutex);
   m_nameToStart = val.m_nameToStart;
   m_startToName = val.m_startToName;
@@ -151,6 +151,9 @@ namespace Lumiverse {
     */
     virtual string getTypeName() { return "enum"; }
 
+    /*! \brief Tag of the type. Always LumiverseType::ENUM. */
+    using LumiverseType::getTypeTag;
+
     /*!
     * \brief Resets the enum to default
     */
@@ -288,6 +291,11 @@ namespace Lumiverse {
     */
     InterpolationMode getInterpMode() { return m_interpMode; }
 
+    /*!
+    * \brief Returns the maximum value of the enumeration range
+    */
+    int getRangeMax() { return m_rangeMax; }
+
     /*!
     * \brief Does a linear interpolation based on the interpolation mode.
     *
@@ -303,6 +311,19 @@ namespace Lumiverse {
     */
     shared_ptr<LumiverseType> lerp(LumiverseEnum* rhs, float t);
 
+    /*!
+    * \brief Does the same interpolation as lerp() into an existing enum.
+    *
+    * dest ends up the same as it would be after `*dest = *lerp(rhs, t)`,
+    * but nothing is allocated as long as dest already has the same options
+    * as rhs. dest may be this object or rhs.
+    * \param dest Enum to write the result to.
+    * \param rhs Right hand side of the interpolation.
+    * \param t Value between 0 and 1.
+    * \sa lerp()
+    */
+    void lerpInto(LumiverseEnum* dest, LumiverseEnum* rhs, float t);
+
     /*!
     * \brief Returns the exact value in the range given the active parameter and
     * the tweak value
@@ -454,7 +475,7 @@ namespace Lumiverse {
   * are the same. Does not check to see if the two enums have the same options.
   */
   inline bool operator==(LumiverseEnum& a, LumiverseEnum& b) {
-    if (a.getTypeName() != "enum" || b.getTypeName() != "enum")
+    if (a.getTypeTag() != LumiverseType::ENUM || b.getTypeTag() != LumiverseType::ENUM)
       return false;
 
     return (a.getVal() == b.getVal() && a.getTweak() == b.getTweak());
@@ -471,7 +492,7 @@ namespace Lumiverse {
   * where they are in their numeric range. That's what that </> ops will compare 
   */
   inline bool operator<(LumiverseEnum& a, LumiverseEnum& b) {
-    if (a.getTypeName() != "enum" || b.getTypeName() != "enum")
+    if (a.getTypeTag() != LumiverseType::ENUM || b.getTypeTag() != LumiverseType::ENUM)
       return false;
 
     return a.getRangeVal() < b.getRangeVal();
@@ -1,41 +1,86 @@
 #include "LumiverseFloat.h"
+#include "../ParameterStore.h"
+
 namespace Lumiverse {
 // This is really not interesting huh.
+// Values live in m_local unless the float is bound to a ParameterStore.
+
+LumiverseFloat::LumiverseFloat(float val, float def, float max, float min) : LumiverseType(FLOAT) {
+  initLocal(val, def, max, min);
+}
 
-LumiverseFloat::LumiverseFloat(float val, float def, float max, float min) :
-  m_val(val), m_default(def), m_max(max), m_min(min) { }
+LumiverseFloat::LumiverseFloat(LumiverseFloat* other) : LumiverseType(FLOAT) {
+  initLocal(other->valRef(), other->defRef(), other->maxRef(), other->minRef());
+}
 
-LumiverseFloat::LumiverseFloat(LumiverseFloat* other) :
-  m_val(other->m_val), m_default(other->m_default), m_max(other->m_max), m_min(other->m_min) { }
+LumiverseFloat::LumiverseFloat(const LumiverseFloat& other) : LumiverseType(FLOAT) {
+  initLocal(other.valRef(), other.defRef(), other.maxRef(), other.minRef());
+}
 
-LumiverseFloat::LumiverseFloat(LumiverseType* other) {
-  if (other->getTypeName() != "float") {
+LumiverseFloat::LumiverseFloat(LumiverseType* other) : LumiverseType(FLOAT) {
+  if (other->getTypeTag() != FLOAT) {
     // If this isn't actually a float, use defaults.
-    m_val = 0.0f;
-    m_default = 0.0f;
-    m_max = 1.0f;
-    m_min = 0.0f;
+    initLocal(0.0f, 0.0f, 1.0f, 0.0f);
   }
   else {
     LumiverseFloat* otherFloat = (LumiverseFloat*)other;
-    m_val = otherFloat->m_val;
-    m_default = otherFloat->m_default;
-    m_max = otherFloat->m_max;
-    m_min = otherFloat->m_min;
+    initLocal(otherFloat->valRef(), otherFloat->defRef(), otherFloat->maxRef(), otherFloat->minRef());
   }
 }
 
-LumiverseFloat::~LumiverseFloat() { }
+void LumiverseFloat::initLocal(float val, float def, float max, float min) {
+  m_data = m_local;
+  m_stride = 1;
+  m_store = nullptr;
+  m_slot = 0;
+
+  m_local[0] = val;
+  m_local[1] = def;
+  m_local[2] = max;
+  m_local[3] = min;
+}
+
+LumiverseFloat::~LumiverseFloat() {
+  if (m_store != nullptr)
+    m_store->release(m_slot);
+}
+
+void LumiverseFloat::bind(ParameterStore* store, ParamHandle param, DeviceHandle device) {
+  if (store == m_store)
+    return;
+
+  float vals[4] = { valRef(), defRef(), maxRef(), minRef() };
+
+  if (m_store != nullptr)
+    m_store->release(m_slot);
+
+  m_store = store;
+  if (m_store != nullptr) {
+    m_slot = m_store->acquire(param, device);
+    m_data = m_store->getSlot(m_slot);
+    m_stride = ParameterStore::BlockSize;
+  }
+  else {
+    m_slot = 0;
+    m_data = m_local;
+    m_stride = 1;
+  }
+
+  setVal(vals[0]);
+  setDefault(vals[1]);
+  setMax(vals[2]);
+  setMin(vals[3]);
+}
 
 JSONNode LumiverseFloat::toJSON(string name) {
   JSONNode node;
   node.set_name(name);
 
   node.push_back(JSONNode("type", getTypeName()));
-  node.push_back(JSONNode("val", m_val));
-  node.push_back(JSONNode("default", m_default));
-  node.push_back(JSONNode("max", m_max));
-  node.push_back(JSONNode("min", m_min));
+  node.push_back(JSONNode("val", valRef()));
+  node.push_back(JSONNode("default", defRef()));
+  node.push_back(JSONNode("max", maxRef()));
+  node.push_back(JSONNode("min", minRef()));
 
   return node;
 }
@@ -43,52 +88,73 @@ JSONNode LumiverseFloat::toJSON(string name) {
 string LumiverseFloat::asString() {
   char buf[32];
 #ifndef _MSC_VER
-  snprintf(buf, 31, "%.2f", m_val);
+  snprintf(buf, 31, "%.2f", valRef());
 #else
-  _snprintf_s(buf, 31, "%.2f", m_val);
+  _snprintf_s(buf, 31, "%.2f", valRef());
 #endif
   return string(buf);
 }
 
 bool LumiverseFloat::isDefault() {
-  return m_val == m_default;
+  return valRef() == defRef();
+}
+
+void LumiverseFloat::lerpInto(LumiverseFloat* dest, LumiverseFloat* rhs, float t) {
+  // Each term gets clamped to the range of the float it came from, like
+  // operator* does. Read everything before writing since dest may be an input.
+  float lhsTerm = valRef() * (1 - t);
+  if (lhsTerm < minRef()) lhsTerm = minRef();
+  else if (lhsTerm > maxRef()) lhsTerm = maxRef();
+
+  float rhsTerm = rhs->valRef() * t;
+  if (rhsTerm < rhs->minRef()) rhsTerm = rhs->minRef();
+  else if (rhsTerm > rhs->maxRef()) rhsTerm = rhs->maxRef();
+
+  float def = defRef();
+  float max = maxRef();
+  float min = minRef();
+
+  dest->valRef() = lhsTerm + rhsTerm;
+  dest->defRef() = def;
+  dest->maxRef() = max;
+  dest->minRef() = min;
 }
 
 void LumiverseFloat::clamp() {
-  if (m_val < m_min) {
-    m_val = m_min;
+  if (valRef() < minRef()) {
+    valRef() = minRef();
     return;
   }
-  if (m_val > m_max) {
-    m_val = m_max;
+  if (valRef() > maxRef()) {
+    valRef() = maxRef();
     return;
   }
 }
 
 float LumiverseFloat::asPercent() {
-  return (-m_min + m_val) / (m_max - m_min);
+  return (-minRef() + valRef()) / (maxRef() - minRef());
 }
 
 // Override for =
-void LumiverseFloat::operator=(float val) { m_val = val; clamp(); }
+void LumiverseFloat::operator=(float val) { valRef() = val; clamp(); }
 void LumiverseFloat::operator=(LumiverseFloat val)
 {
-  m_val = val.m_val;
-  m_max = val.m_max;
-  m_min = val.m_min;
-  m_default = val.m_default;
+  valRef() = val.valRef();
+  maxRef() = val.maxRef();
+  minRef() = val.minRef();
+  defRef() = val.defRef();
 }
 
 // Arithmetic overrides
-LumiverseFloat& LumiverseFloat::operator+=(float val) { m_val += val; clamp(); return *this; }
-LumiverseFloat& LumiverseFloat::operator+=(LumiverseFloat& val) { m_val += val.m_val; return *this; }
+LumiverseFloat& LumiverseFloat::operator+=(float val) { valRef() += val; clamp(); return *this; }
+LumiverseFloat& LumiverseFloat::operator+=(LumiverseFloat& val) { valRef() += val.valRef(); return *this; }
 
-LumiverseFloat& LumiverseFloat::operator-=(float val) { m_val -= val; clamp();  return *this; }
-LumiverseFloat& LumiverseFloat::operator-=(LumiverseFloat& val) { m_val -= val.m_val; return *this; }
+LumiverseFloat& LumiverseFloat::operator-=(float val) { valRef() -= val; clamp();  return *this; }
+LumiverseFloat& LumiverseFloat::operator-=(LumiverseFloat& val) { valRef() -= val.valRef(); return *this; }
 
-LumiverseFloat& LumiverseFloat::operator*=(float val) { m_val *= val; clamp();  return *this; }
-LumiverseFloat& LumiverseFloat::operator*=(LumiverseFloat& val) { m_val *= val.m_val; return *this; }
+LumiverseFloat& LumiverseFloat::operator*=(float val) { valRef() *= val; clamp();  return *this; }
+LumiverseFloat& LumiverseFloat::operator*=(LumiverseFloat& val) { valRef() *= val.valRef(); return *this; }
 
-LumiverseFloat& LumiverseFloat::operator/=(float val) { m_val /= val; clamp(); return *this; }
-LumiverseFloat& LumiverseFloat::operator/=(LumiverseFloat& val) { m_val /= val.m_val; return *this; }
+LumiverseFloat& LumiverseFloat::operator/=(float val) { valRef() /= val; clamp(); return *this; }
+LumiverseFloat& LumiverseFloat::operator/=(LumiverseFloat& val) { valRef() /= val.valRef(); return *this; }
 }
\ No newline at end of file
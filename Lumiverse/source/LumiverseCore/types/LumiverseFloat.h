@@ -6,10 +6,13 @@
 #pragma once
 
 #include "../LumiverseType.h"
+#include "../Interner.h"
 #include <string>
 #include <stdio.h>
 
 namespace Lumiverse {
+  class ParameterStore;
+
   /*!
   * \brief Defines a float in Lumiverse
   *
@@ -38,6 +41,14 @@ namespace Lumiverse {
     */
     LumiverseFloat(LumiverseFloat* other);
 
+    /*!
+    * \brief Copies the values of another float.
+    *
+    * The copy always has its own storage, even if `other` is bound to a
+    * ParameterStore.
+    */
+    LumiverseFloat(const LumiverseFloat& other);
+
     /*!
     * \brief Constructs a float by copying from a generic LumiverseType
     *
@@ -57,6 +68,9 @@ namespace Lumiverse {
     */
     virtual string getTypeName() { return "float"; }
 
+    /*! \brief Tag of the type. Always LumiverseType::FLOAT. */
+    using LumiverseType::getTypeTag;
+
     // Override for =
     void operator=(float val);
     void operator=(LumiverseFloat val);
@@ -77,58 +91,58 @@ namespace Lumiverse {
     /*! \brief Gets the value of the float 
     * \return Value of the object
     */
-    float getVal() { return m_val; }
+    float getVal() { return valRef(); }
 
     /*!
     * \brief Sets the value of the float
     * \param val New value
     */
-    void setVal(float val) { m_val = val; }
+    void setVal(float val) { valRef() = val; }
 
     /*!
     * \brief Set maximum value
     * \param val New maximum value
     */
-    void setMax(float val) { m_max = val; }
+    void setMax(float val) { maxRef() = val; }
     
     /*!
     * \brief Get the maximum value
     * \return Maximum value for the float
     */
-    float getMax() { return m_max; }
+    float getMax() { return maxRef(); }
 
     /*!
     * \brief Set miniumum value
     * \param val New minimum value
     */
-    void setMin(float val) { m_min = val; }
+    void setMin(float val) { minRef() = val; }
     
     /*!
     * \brief Get the minimum value
     * \return Minimum value for the float
     */
-    float getMin() { return m_min; }
+    float getMin() { return minRef(); }
 
     /*!
     * \brief Set the default value for the float
     * \param val New default value
     */
-    void setDefault(float val) { m_default = val; }
+    void setDefault(float val) { defRef() = val; }
     
     /*!
     * \brief Gets the default value for the float
     * \return Default value
     */
-    float getDefault() { return m_default; }
+    float getDefault() { return defRef(); }
 
     /*!
     * \brief Resets the value to the default value
     */
-    virtual void reset() { m_val = m_default; }
+    virtual void reset() { valRef() = defRef(); }
 
     /*!
     * \brief Returns the value of this float as a percentage
-    * \return Returns the value: `m_val / (m_max - m_min)`
+    * \return Returns the value: `(value - min) / (max - min)`
     */
     float asPercent();
 
@@ -144,32 +158,85 @@ namespace Lumiverse {
 
     virtual bool isDefault();
 
+    /*!
+    * \brief Does a linear interpolation into an existing float.
+    *
+    * Gives the same value as `*this * (1 - t) + *rhs * t` with the arithmetic
+    * operators, including their clamping, without making any temporaries.
+    * dest takes the default, max and min of this object. dest may be this
+    * object or rhs.
+    * \param dest Float to write the result to.
+    * \param rhs Right hand side of the interpolation.
+    * \param t Value between 0 and 1. At 0 dest gets the value of this object, at 1 the value of rhs.
+    */
+    void lerpInto(LumiverseFloat* dest, LumiverseFloat* rhs, float t);
+
+    /*!
+    * \brief Moves the float's storage into a ParameterStore.
+    *
+    * The current value, default, max and min are kept. Binding to nullptr
+    * moves the values back into the float itself. Must not be called while
+    * other threads access the float.
+    * \param store Store to use. nullptr to use local storage.
+    * \param param Handle of the parameter the float is. Picks the slot.
+    * \param device Handle of the device the float belongs to. Picks the slot.
+    */
+    void bind(ParameterStore* store, ParamHandle param, DeviceHandle device);
+
+    /*! \brief Gets the store the float is bound to. nullptr if none. */
+    ParameterStore* getStore() { return m_store; }
+
+    /*! \brief Gets the slot the float uses in its store. Meaningless if unbound. */
+    unsigned int getSlot() { return m_slot; }
+
   private:
+    /*! \brief Sets up local storage with the given values. */
+    void initLocal(float val, float def, float max, float min);
+
+    /*! \brief The value of this object. */
+    inline float& valRef() const { return m_data[0]; }
+
+    /*! \brief Default value for this float. */
+    inline float& defRef() const { return m_data[m_stride]; }
+
+    /*! \brief Maximum value for the float (default 1.0) */
+    inline float& maxRef() const { return m_data[2 * m_stride]; }
+
+    /*! \brief Minimum value for the float (default 0.0) */
+    inline float& minRef() const { return m_data[3 * m_stride]; }
+
     /*!
     * \brief Ensures that the value of this float is between min and max.
     */
     inline void clamp();
 
     /*!
-    * \brief the value of this object
+    * \brief Value, default, max and min when not bound to a store.
     */
-    float m_val;
+    float m_local[4];
 
-    /*! \brief Default value for this float. */
-    float m_default;
+    /*!
+    * \brief Points at the value, either in m_local or in the store.
+    *
+    * Default, max and min follow at multiples of m_stride.
+    */
+    float* m_data;
 
-    /*! \brief Maximum value for the float (default 1.0) */
-    float m_max;
+    /*! \brief Distance between the value, default, max and min in m_data. */
+    unsigned int m_stride;
+
+    /*! \brief Store holding the values. nullptr for local storage. */
+    ParameterStore* m_store;
 
-    /*! Minimum value for the float (default 0.0) */
-    float m_min;
+    /*! \brief Slot in m_store. */
+    unsigned int m_slot;
   };
 
   // Ops ops ops all overloaded woo
 
   // Compares two LumiverseFloats. Uses normal float comparison
   inline bool operator==(LumiverseFloat& a, LumiverseFloat& b) {
-    if (a.getTypeName() != "float" || b.getTypeName() != "float")
+    if (a.getTypeTag() != LumiverseType::FLOAT || b.getTypeTag() != LumiverseType::FLOAT)
       return false;
 
     return a.getVal() == b.getVal();
@@ -181,7 +248,7 @@ namespace Lumiverse {
 
   // LumiverseFloat uses the normal < op for floats.
   inline bool operator<(LumiverseFloat& a, LumiverseFloat& b) {
-    if (a.getTypeName() != "float" || b.getTypeName() != "float")
+    if (a.getTypeTag() != LumiverseType::FLOAT || b.getTypeTag() != LumiverseType::FLOAT)
       return false;
 
     return a.getVal() < b.getVal();
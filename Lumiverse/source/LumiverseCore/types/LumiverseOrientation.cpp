@@ -3,13 +3,13 @@ namespace Lumiverse {
 // This is really not interesting huh.
 
 LumiverseOrientation::LumiverseOrientation(float val, string unit, float def, float max, float min) :
-  m_val(val), m_default(def), m_max(max), m_min(min), m_unit(unit) { }
+  LumiverseType(ORIENTATION), m_val(val), m_default(def), m_max(max), m_min(min), m_unit(unit) { }
 
 LumiverseOrientation::LumiverseOrientation(LumiverseOrientation* other) :
-  m_val(other->m_val), m_default(other->m_default), m_max(other->m_max), m_min(other->m_min), m_unit(other->m_unit) { }
+  LumiverseType(ORIENTATION), m_val(other->m_val), m_default(other->m_default), m_max(other->m_max), m_min(other->m_min), m_unit(other->m_unit) { }
 
-LumiverseOrientation::LumiverseOrientation(LumiverseType* other) {
-  if (other->getTypeName() != "orientation") {
+LumiverseOrientation::LumiverseOrientation(LumiverseType* other) : LumiverseType(ORIENTATION) {
+  if (other->getTypeTag() != ORIENTATION) {
     // If this isn't actually an orientation, use defaults.
     m_val = 0.0f;
     m_default = 0.0f;
@@ -57,6 +57,34 @@ bool LumiverseOrientation::isDefault() {
   return m_val == m_default;
 }
 
+void LumiverseOrientation::lerpInto(LumiverseOrientation* dest, LumiverseOrientation* rhs, float t) {
+  // Each term gets clamped to the range of the orientation it came from, and
+  // the sum to the range of lhs, like the operators do.
+  float lhsTerm = m_val * (1 - t);
+  if (lhsTerm < m_min) lhsTerm = m_min;
+  else if (lhsTerm > m_max) lhsTerm = m_max;
+
+  float rhsTerm = rhs->m_val * t;
+  if (rhsTerm < rhs->m_min) rhsTerm = rhs->m_min;
+  else if (rhsTerm > rhs->m_max) rhsTerm = rhs->m_max;
+
+  // Same conversion as asUnit(), without copying the unit strings.
+  if (rhs->m_unit != m_unit)
+    rhsTerm = (rhs->m_unit == "degree") ? (float)(rhsTerm * M_PI / 180.0f) : (float)(rhsTerm * 180.0f / M_PI);
+
+  float val = lhsTerm + rhsTerm;
+  if (val < m_min) val = m_min;
+  else if (val > m_max) val = m_max;
+
+  if (dest != this) {
+    dest->m_unit = m_unit;
+    dest->m_default = m_default;
+    dest->m_max = m_max;
+    dest->m_min = m_min;
+  }
+  dest->m_val = val;
+}
+
 void LumiverseOrientation::clamp() {
   if (m_val < m_min) {
     m_val = m_min;
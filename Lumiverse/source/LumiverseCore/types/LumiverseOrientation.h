@@ -59,6 +59,9 @@ namespace Lumiverse {
     */
     virtual string getTypeName() { return "orientation"; }
 
+    /*! \brief Tag of the type. Always LumiverseType::ORIENTATION. */
+    using LumiverseType::getTypeTag;
+
     // Override for =
     void operator=(float val);
     void operator=(LumiverseOrientation val);
@@ -160,6 +163,19 @@ namespace Lumiverse {
 
     virtual bool isDefault();
 
+    /*!
+    * \brief Does a linear interpolation into an existing orientation.
+    *
+    * Gives the same value as `*this * (1 - t) + *rhs * t` with the arithmetic
+    * operators, including their clamping and unit conversion, without making
+    * any temporaries. dest takes the unit, default, max and min of this
+    * object. dest may be this object or rhs.
+    * \param dest Orientation to write the result to.
+    * \param rhs Right hand side of the interpolation.
+    * \param t Value between 0 and 1. At 0 dest gets the value of this object, at 1 the value of rhs.
+    */
+    void lerpInto(LumiverseOrientation* dest, LumiverseOrientation* rhs, float t);
+
   private:
     /*!
     * \brief Ensures that the value of this float is between min and max.
@@ -187,7 +203,7 @@ namespace Lumiverse {
 
   // Compares two LumiverseOrientations. Uses normal float comparison
   inline bool operator==(LumiverseOrientation& a, LumiverseOrientation& b) {
-    if (a.getTypeName() != "orientation" || b.getTypeName() != "orientation")
+    if (a.getTypeTag() != LumiverseType::ORIENTATION || b.getTypeTag() != LumiverseType::ORIENTATION)
       return false;
 
 	if (a.getUnit() == b.getUnit())
@@ -201,7 +217,7 @@ namespace Lumiverse {
 
   // LumiverseOrientation uses the normal < op for floats.
   inline bool operator<(LumiverseOrientation& a, LumiverseOrientation& b) {
-    if (a.getTypeName() != "orientation" || b.getTypeName() != "orientation")
+    if (a.getTypeTag() != LumiverseType::ORIENTATION || b.getTypeTag() != LumiverseType::ORIENTATION)
       return false;
 
 	if (a.getUnit() == b.getUnit())
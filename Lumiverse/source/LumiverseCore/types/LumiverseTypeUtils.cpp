@@ -6,36 +6,39 @@ LumiverseType* LumiverseTypeUtils::copy(LumiverseType* data) {
   if (data == nullptr)
     return nullptr;
 
-  if (data->getTypeName() == "float")
-    return (LumiverseType*)(new LumiverseFloat(data));
-  else if (data->getTypeName() == "enum")
-    return (LumiverseType*)(new LumiverseEnum(data));
-  else if (data->getTypeName() == "color")
-    return (LumiverseType*)(new LumiverseColor(data));
-  else if (data->getTypeName() == "orientation")
-	  return (LumiverseType*)(new LumiverseOrientation(data));
-  else
-    return nullptr;
+  switch (data->getTypeTag()) {
+    case LumiverseType::FLOAT:
+      return (LumiverseType*)(new LumiverseFloat(data));
+    case LumiverseType::ENUM:
+      return (LumiverseType*)(new LumiverseEnum(data));
+    case LumiverseType::COLOR:
+      return (LumiverseType*)(new LumiverseColor(data));
+    case LumiverseType::ORIENTATION:
+      return (LumiverseType*)(new LumiverseOrientation(data));
+    default:
+      return nullptr;
+  }
 }
 
 void LumiverseTypeUtils::copyByVal(LumiverseType* source, LumiverseType* target) {
   if (!LumiverseTypeUtils::areSameType(source, target))
     return;
 
-  if (source->getTypeName() == "float") {
-    *((LumiverseFloat*)target) = *((LumiverseFloat*)source);
-  }
-  else if (source->getTypeName() == "enum") {
-    *((LumiverseEnum*)target) = *((LumiverseEnum*)source);
-  }
-  else if (source->getTypeName() == "color") {
-    *((LumiverseColor*)target) = *((LumiverseColor*)source);
-  }
-  else if (source->getTypeName() == "orientation") {
-	  *((LumiverseOrientation*)target) = *((LumiverseOrientation*)source);
-  }
-  else {
-    return;
+  switch (source->getTypeTag()) {
+    case LumiverseType::FLOAT:
+      *((LumiverseFloat*)target) = *((LumiverseFloat*)source);
+      break;
+    case LumiverseType::ENUM:
+      *((LumiverseEnum*)target) = *((LumiverseEnum*)source);
+      break;
+    case LumiverseType::COLOR:
+      *((LumiverseColor*)target) = *((LumiverseColor*)source);
+      break;
+    case LumiverseType::ORIENTATION:
+      *((LumiverseOrientation*)target) = *((LumiverseOrientation*)source);
+      break;
+    default:
+      break;
   }
 }
 
@@ -44,16 +47,18 @@ bool LumiverseTypeUtils::equals(LumiverseType* lhs, LumiverseType* rhs) {
     return false;
 
   // At this point we can use just the lhs to determine type
-  if (lhs->getTypeName() == "float")
-    return (*((LumiverseFloat*)lhs) == *((LumiverseFloat*)rhs));
-  else if (lhs->getTypeName() == "enum")
-    return (*((LumiverseEnum*)lhs) == *((LumiverseEnum*)rhs));
-  else if (lhs->getTypeName() == "color")
-    return (*((LumiverseColor*)lhs) == *((LumiverseColor*)rhs));
-  else if (lhs->getTypeName() == "orientation")
-	  return (*((LumiverseOrientation*)lhs) == *((LumiverseOrientation*)rhs));
-  else
-    return false;
+  switch (lhs->getTypeTag()) {
+    case LumiverseType::FLOAT:
+      return (*((LumiverseFloat*)lhs) == *((LumiverseFloat*)rhs));
+    case LumiverseType::ENUM:
+      return (*((LumiverseEnum*)lhs) == *((LumiverseEnum*)rhs));
+    case LumiverseType::COLOR:
+      return (*((LumiverseColor*)lhs) == *((LumiverseColor*)rhs));
+    case LumiverseType::ORIENTATION:
+      return (*((LumiverseOrientation*)lhs) == *((LumiverseOrientation*)rhs));
+    default:
+      return false;
+  }
 }
 
 int LumiverseTypeUtils::cmp(LumiverseType* lhs, LumiverseType* rhs) {
@@ -61,71 +66,96 @@ int LumiverseTypeUtils::cmp(LumiverseType* lhs, LumiverseType* rhs) {
     return -2;
 
   // At this point we can use just the lhs to determine type
-  if (lhs->getTypeName() == "float")
-  {
-    if (*((LumiverseFloat*)lhs) == *((LumiverseFloat*)rhs))
-      return 0;
-    else if (*((LumiverseFloat*)lhs) < *((LumiverseFloat*)rhs))
-      return -1;
-    else
-      return 1;
-  }
-  else if (lhs->getTypeName() == "enum") {
-    if (*((LumiverseEnum*)lhs) == *((LumiverseEnum*)rhs))
-      return 0;
-    else if (*((LumiverseEnum*)lhs) < *((LumiverseEnum*)rhs))
-      return -1;
-    else
-      return 1;
-  }
-  else if (lhs->getTypeName() == "color") {
-    return (*((LumiverseColor*)lhs)).cmpHue(*((LumiverseColor*)rhs));
-  }
-  else if (lhs->getTypeName() == "orientation")
-  {
-	  if (*((LumiverseOrientation*)lhs) == *((LumiverseOrientation*)rhs))
-		  return 0;
-	  else if (*((LumiverseOrientation*)lhs) < *((LumiverseOrientation*)rhs))
-		  return -1;
-	  else
-		  return 1;
+  switch (lhs->getTypeTag()) {
+    case LumiverseType::FLOAT: {
+      if (*((LumiverseFloat*)lhs) == *((LumiverseFloat*)rhs))
+        return 0;
+      else if (*((LumiverseFloat*)lhs) < *((LumiverseFloat*)rhs))
+        return -1;
+      else
+        return 1;
+    }
+    case LumiverseType::ENUM: {
+      if (*((LumiverseEnum*)lhs) == *((LumiverseEnum*)rhs))
+        return 0;
+      else if (*((LumiverseEnum*)lhs) < *((LumiverseEnum*)rhs))
+        return -1;
+      else
+        return 1;
+    }
+    case LumiverseType::COLOR:
+      return (*((LumiverseColor*)lhs)).cmpHue(*((LumiverseColor*)rhs));
+    case LumiverseType::ORIENTATION: {
+      if (*((LumiverseOrientation*)lhs) == *((LumiverseOrientation*)rhs))
+        return 0;
+      else if (*((LumiverseOrientation*)lhs) < *((LumiverseOrientation*)rhs))
+        return -1;
+      else
+        return 1;
+    }
+    default:
+      return -2;
   }
-  else
-    return -2;
 }
 
 shared_ptr<LumiverseType> LumiverseTypeUtils::lerp(LumiverseType* lhs, LumiverseType* rhs, float t) {
   if (!LumiverseTypeUtils::areSameType(lhs, rhs))
     return nullptr;
 
-  if (lhs->getTypeName() == "float") {
-    // Defaults and other meta-stuff are taken from lhs. Generally you should lerp
-    // things that have the same defaults, etc.
-    LumiverseFloat* ret = new LumiverseFloat();
-    *ret = ((*(LumiverseFloat*)lhs) * (1 - t)) + ((*(LumiverseFloat*)rhs) * t);
-    return shared_ptr<LumiverseType>((LumiverseType *)ret);
-  }
-  else if (lhs->getTypeName() == "enum") {
-    // Redirect to lerp function within LumiverseEnum
-    return ((LumiverseEnum*)lhs)->lerp((LumiverseEnum*)rhs, t);
-  }
-  else if (lhs->getTypeName() == "color") {
-    // Redirect to lerp function within LumiverseColor
-    return ((LumiverseColor*)lhs)->lerp((LumiverseColor*)rhs, t);
+  switch (lhs->getTypeTag()) {
+    case LumiverseType::FLOAT: {
+      // Defaults and other meta-stuff are taken from lhs. Generally you should lerp
+      // things that have the same defaults, etc.
+      LumiverseFloat* ret = new LumiverseFloat();
+      *ret = ((*(LumiverseFloat*)lhs) * (1 - t)) + ((*(LumiverseFloat*)rhs) * t);
+      return shared_ptr<LumiverseType>((LumiverseType *)ret);
+    }
+    case LumiverseType::ENUM:
+      // Redirect to lerp function within LumiverseEnum
+      return ((LumiverseEnum*)lhs)->lerp((LumiverseEnum*)rhs, t);
+    case LumiverseType::COLOR:
+      // Redirect to lerp function within LumiverseColor
+      return ((LumiverseColor*)lhs)->lerp((LumiverseColor*)rhs, t);
+    case LumiverseType::ORIENTATION: {
+      LumiverseOrientation* ret = new LumiverseOrientation();
+      *ret = ((*(LumiverseOrientation*)lhs) * (1 - t)) + ((*(LumiverseOrientation*)rhs) * t);
+      return shared_ptr<LumiverseType>((LumiverseType *)ret);
+    }
+    default:
+      return nullptr;
   }
-  else if (lhs->getTypeName() == "orientation") {
-	  LumiverseOrientation* ret = new LumiverseOrientation();
-	  *ret = ((*(LumiverseOrientation*)lhs) * (1 - t)) + ((*(LumiverseOrientation*)rhs) * t);
-	  return shared_ptr<LumiverseType>((LumiverseType *)ret);
+}
+
+bool LumiverseTypeUtils::lerpInto(LumiverseType* dest, LumiverseType* lhs, LumiverseType* rhs, float t) {
+  if (!LumiverseTypeUtils::areSameType(lhs, rhs) || !LumiverseTypeUtils::areSameType(lhs, dest))
+    return false;
+
+  switch (lhs->getTypeTag()) {
+    case LumiverseType::FLOAT:
+      ((LumiverseFloat*)lhs)->lerpInto((LumiverseFloat*)dest, (LumiverseFloat*)rhs, t);
+      return true;
+    case LumiverseType::ENUM:
+      ((LumiverseEnum*)lhs)->lerpInto((LumiverseEnum*)dest, (LumiverseEnum*)rhs, t);
+      return true;
+    case LumiverseType::COLOR:
+      ((LumiverseColor*)lhs)->lerpInto((LumiverseColor*)dest, (LumiverseColor*)rhs, t);
+      return true;
+    case LumiverseType::ORIENTATION:
+      ((LumiverseOrientation*)lhs)->lerpInto((LumiverseOrientation*)dest, (LumiverseOrientation*)rhs, t);
+      return true;
+    default:
+      return false;
   }
-  else
-    return nullptr;
 }
 
 inline bool LumiverseTypeUtils::areSameType(LumiverseType* lhs, LumiverseType* rhs) {
   if (lhs == nullptr || rhs == nullptr)
     return false;
-  if (lhs->getTypeName() != rhs->getTypeName())
+
+  // Types outside of the core all share OTHER, so only their names tell them apart.
+  if (lhs->getTypeTag() != rhs->getTypeTag())
+    return false;
+  if (lhs->getTypeTag() == LumiverseType::OTHER && lhs->getTypeName() != rhs->getTypeName())
     return false;
 
   return true;
@@ -147,12 +177,12 @@ Eigen::Matrix3f LumiverseTypeUtils::getRotationMatrix(Eigen::Vector3f lookat, Ei
 	Eigen::Vector3f def_lookat(0.0f, -1.0f, 0.0f);
 	Eigen::Vector3f def_axis = lookat.cross(def_lookat);
 	def_axis.normalize();
-	Eigen::AngleAxisf reset_rot = Eigen::AngleAxisf(std::acosf(def_lookat.dot(lookat)), def_axis);
+	Eigen::AngleAxisf reset_rot = Eigen::AngleAxisf(acosf(def_lookat.dot(lookat)), def_axis);
 
 	// Pan
 	Eigen::Vector3f pan_reset_axis = up.cross(lookat);
 	pan_reset_axis.normalize();
-	Eigen::AngleAxisf pan_reset_rot = Eigen::AngleAxisf(std::acosf(up.dot(lookat)), pan_reset_axis);
+	Eigen::AngleAxisf pan_reset_rot = Eigen::AngleAxisf(acosf(up.dot(lookat)), pan_reset_axis);
 	up = reset_rot * up;
 	Eigen::AngleAxisf pan_rot = Eigen::AngleAxisf(pan.asUnit("radian"), up);
 
@@ -173,7 +203,7 @@ bool LumiverseTypeUtils::lessThan(LumiverseType* lhs, LumiverseType* rhs) {
   return (cmp(lhs, rhs) == -1);
 }
 
-LumiverseType* LumiverseTypeUtils::loadFromJSON(JSONNode node) {
+LumiverseType* LumiverseTypeUtils::loadFromJSON(const JSONNode& node) {
   bool err = false;
 
   auto type = node.find("type");
@@ -217,7 +247,7 @@ LumiverseType* LumiverseTypeUtils::loadFromJSON(JSONNode node) {
         JSONNode::const_iterator k = keysNode->begin();
 
         while (k != keysNode->end()) {
-          JSONNode keyData = *k;
+          const JSONNode& keyData = *k;
 
           enumKeys[keyData.name()] = keyData.as_int();
           k++;
@@ -252,7 +282,7 @@ LumiverseType* LumiverseTypeUtils::loadFromJSON(JSONNode node) {
         JSONNode::const_iterator c = channelsNode->begin();
 
         while (c != channelsNode->end()) {
-          JSONNode channelData = *c;
+          const JSONNode& channelData = *c;
 
           channels[channelData.name()] = channelData.as_float();
           c++;
@@ -263,7 +293,7 @@ LumiverseType* LumiverseTypeUtils::loadFromJSON(JSONNode node) {
         JSONNode::const_iterator b = basisNode->begin();
 
         while (b != basisNode->end()) {
-          JSONNode basisData = *b;
+          const JSONNode& basisData = *b;
 
           // This is an array of three values
           Eigen::Vector3d basisVector(basisData[0].as_float(), basisData[1].as_float(), basisData[2].as_float());
@@ -271,7 +301,11 @@ LumiverseType* LumiverseTypeUtils::loadFromJSON(JSONNode node) {
           b++;
         }
 
-        LumiverseColor* color = new LumiverseColor(channels, basis, StringToColorMode[modeNode->as_string()], weightNode->as_float());
+        // find() so loading from several threads never inserts into the shared table
+        auto mode = StringToColorMode.find(modeNode->as_string());
+        ColorMode colorMode = (mode != StringToColorMode.end()) ? mode->second : ColorMode();
+
+        LumiverseColor* color = new LumiverseColor(channels, basis, colorMode, weightNode->as_float());
 
         return (LumiverseType*)color;
       }
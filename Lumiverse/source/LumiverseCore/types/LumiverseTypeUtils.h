@@ -66,6 +66,15 @@ namespace Lumiverse {
     */
     shared_ptr<LumiverseType> lerp(LumiverseType* lhs, LumiverseType* rhs, float t);
 
+    /*!
+    * \brief Lerps the values of a LumiverseType into an existing object.
+    *
+    * Same result as `copyByVal(lerp(lhs, rhs, t).get(), dest)` without
+    * allocating a new object for the result. dest may be lhs or rhs.
+    * \return False, leaving dest as it is, if lhs, rhs and dest aren't all the same type.
+    */
+    bool lerpInto(LumiverseType* dest, LumiverseType* lhs, LumiverseType* rhs, float t);
+
     /*!
     * \brief Checks the types of two LumiverseType objects
     * 
@@ -84,7 +93,7 @@ namespace Lumiverse {
     bool lessThan(LumiverseType* lhs, LumiverseType* rhs);
 
     /*! \brief Loads a LumiverseType from a JSON node. */
-    LumiverseType* loadFromJSON(JSONNode node);
+    LumiverseType* loadFromJSON(const JSONNode& node);
   }
 }
 #endif
\ No newline at end of file